@@ -0,0 +1,47 @@
+#! /bin/sh
+
+# script to build a profile-guided, link-time optimised vamp-aubio-plugins
+# for linux, with aubio statically linked from contrib/aubio-dist
+#
+# The plugin and aubio are first built with instrumentation, trained by
+# running tools/vamp-aubio-bench over a synthetic signal, then rebuilt
+# using the recorded profile. The result is a drop-in build/vamp-aubio.so;
+# the speedup over a plain build is reported at the end.
+
+set -e
+
+PGO_DIR=$PWD/build-pgo
+TRAIN_SECONDS=${TRAIN_SECONDS:-120}
+
+rm -rf $PGO_DIR
+mkdir -p $PGO_DIR
+
+# get waf
+./scripts/get_waf.sh
+
+# fetch Vamp SDK
+./scripts/get_deps_linux.sh
+
+# reference build, used to measure the speedup
+./scripts/get_aubio.sh
+./waf configure
+./waf build -v
+cp build/vamp-aubio.so $PGO_DIR/vamp-aubio-reference.so
+
+# instrumented build
+CFLAGS="-O3 -flto -ffat-lto-objects -fprofile-generate=$PGO_DIR/profile" \
+  AR=gcc-ar ./scripts/get_aubio.sh
+./waf configure --enable-lto --with-pgo=generate --pgo-dir=$PGO_DIR/profile
+./waf build -v
+
+# training run
+./build/vamp-aubio-bench -d $TRAIN_SECONDS -n 1 build/vamp-aubio.so
+
+# optimised build
+CFLAGS="-O3 -flto -ffat-lto-objects -fprofile-use=$PGO_DIR/profile -fprofile-correction -Wno-missing-profile" \
+  AR=gcc-ar ./scripts/get_aubio.sh
+./waf configure --enable-lto --with-pgo=use --pgo-dir=$PGO_DIR/profile
+./waf build -v
+
+# benchmark against the reference build
+./build/vamp-aubio-bench $PGO_DIR/vamp-aubio-reference.so build/vamp-aubio.so
@@ -34,6 +34,7 @@
 #include "plugins/Mfcc.h"
 #include "plugins/MelEnergy.h"
 #include "plugins/SpecDesc.h"
+#include "plugins/Segments.h"
 
 static Vamp::PluginAdapter<Onset> onsetAdapter;
 static Vamp::PluginAdapter<Pitch> pitchAdapter;
@@ -43,6 +44,7 @@ static Vamp::PluginAdapter<Silence> silenceAdapter;
 static Vamp::PluginAdapter<Mfcc> mfccAdapter;
 static Vamp::PluginAdapter<MelEnergy> melenergyAdapter;
 static Vamp::PluginAdapter<SpecDesc> specdescAdapter;
+static Vamp::PluginAdapter<Segments> segmentsAdapter;
 
 const VampPluginDescriptor *vampGetPluginDescriptor(unsigned int vampApiVersion,
                                                     unsigned int index)
@@ -58,6 +60,7 @@ const VampPluginDescriptor *vampGetPluginDescriptor(unsigned int vampApiVersion,
     case  5: return mfccAdapter.getDescriptor();
     case  6: return melenergyAdapter.getDescriptor();
     case  7: return specdescAdapter.getDescriptor();
+    case  8: return segmentsAdapter.getDescriptor();
     default: return 0;
     }
 }
@@ -0,0 +1,69 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "AubioLock.h"
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+// constructed while the library is loaded, before any plugin exists
+class CriticalSection
+{
+public:
+    CriticalSection() { InitializeCriticalSection(&m_section); }
+    ~CriticalSection() { DeleteCriticalSection(&m_section); }
+    CRITICAL_SECTION m_section;
+};
+
+static CriticalSection aubioSection;
+
+AubioLock::AubioLock()
+{
+    EnterCriticalSection(&aubioSection.m_section);
+}
+
+AubioLock::~AubioLock()
+{
+    LeaveCriticalSection(&aubioSection.m_section);
+}
+
+#else
+
+#include <pthread.h>
+
+static pthread_mutex_t aubioMutex = PTHREAD_MUTEX_INITIALIZER;
+
+AubioLock::AubioLock()
+{
+    pthread_mutex_lock(&aubioMutex);
+}
+
+AubioLock::~AubioLock()
+{
+    pthread_mutex_unlock(&aubioMutex);
+}
+
+#endif
@@ -0,0 +1,48 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _AUBIO_LOCK_H_
+#define _AUBIO_LOCK_H_
+
+/** Scoped lock serialising the creation and deletion of aubio objects
+
+  Objects built around an FFT may create or destroy FFTW plans, and
+  FFTW's planner is not thread-safe. Each plugin instance owns its
+  aubio objects, so once created they can be used from several threads
+  at a time; only the new_aubio_* and del_aubio_* calls, which run in
+  reset() and the destructors, need to hold this lock. It is shared by
+  every plugin in the library. */
+class AubioLock
+{
+public:
+    AubioLock();
+    ~AubioLock();
+
+private:
+    AubioLock(const AubioLock &);
+    AubioLock &operator=(const AubioLock &);
+};
+
+#endif /* _AUBIO_LOCK_H_ */
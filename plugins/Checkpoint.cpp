@@ -0,0 +1,544 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "Checkpoint.h"
+
+#include <iostream>
+#include <cstring>
+#include <cmath>
+
+using std::string;
+using std::vector;
+using std::cerr;
+using std::endl;
+
+static const char *const stateMagic = "VAST";
+static const int stateFormat = 1;
+
+StateWriter::StateWriter()
+{
+}
+
+void
+StateWriter::putWord32(unsigned int value)
+{
+    for (int i = 0; i < 4; ++i) {
+        m_data.push_back(char((value >> (8 * i)) & 0xff));
+    }
+}
+
+void
+StateWriter::putWord64(unsigned long long value)
+{
+    for (int i = 0; i < 8; ++i) {
+        m_data.push_back(char((value >> (8 * i)) & 0xff));
+    }
+}
+
+void
+StateWriter::putInt(int value)
+{
+    putWord32((unsigned int)value);
+}
+
+void
+StateWriter::putSize(size_t value)
+{
+    putWord64(value);
+}
+
+void
+StateWriter::putBool(bool value)
+{
+    m_data.push_back(value ? 1 : 0);
+}
+
+void
+StateWriter::putFloat(float value)
+{
+    unsigned int word;
+    memcpy(&word, &value, sizeof(word));
+    putWord32(word);
+}
+
+void
+StateWriter::putDouble(double value)
+{
+    unsigned long long word;
+    memcpy(&word, &value, sizeof(word));
+    putWord64(word);
+}
+
+void
+StateWriter::putRealTime(const Vamp::RealTime &value)
+{
+    putInt(value.sec);
+    putInt(value.nsec);
+}
+
+void
+StateWriter::putString(const string &value)
+{
+    putSize(value.size());
+    m_data += value;
+}
+
+void
+StateWriter::putFeature(const Vamp::Plugin::Feature &value)
+{
+    putBool(value.hasTimestamp);
+    putRealTime(value.timestamp);
+    putBool(value.hasDuration);
+    putRealTime(value.duration);
+    putFloats(value.values);
+    putString(value.label);
+}
+
+void
+StateWriter::putFloats(const vector<float> &values)
+{
+    putSize(values.size());
+    for (size_t i = 0; i < values.size(); ++i) putFloat(values[i]);
+}
+
+void
+StateWriter::putDoubles(const vector<double> &values)
+{
+    putSize(values.size());
+    for (size_t i = 0; i < values.size(); ++i) putDouble(values[i]);
+}
+
+void
+StateWriter::putInts(const vector<int> &values)
+{
+    putSize(values.size());
+    for (size_t i = 0; i < values.size(); ++i) putInt(values[i]);
+}
+
+void
+StateWriter::putSizes(const vector<size_t> &values)
+{
+    putSize(values.size());
+    for (size_t i = 0; i < values.size(); ++i) putSize(values[i]);
+}
+
+void
+StateWriter::putRealTimes(const vector<Vamp::RealTime> &values)
+{
+    putSize(values.size());
+    for (size_t i = 0; i < values.size(); ++i) putRealTime(values[i]);
+}
+
+void
+StateWriter::putSamples(const smpl_t *values, size_t count)
+{
+    putSize(count);
+    for (size_t i = 0; i < count; ++i) putDouble(values[i]);
+}
+
+StateReader::StateReader(const string &data) :
+    m_data(data),
+    m_pos(0),
+    m_ok(true)
+{
+}
+
+unsigned int
+StateReader::getWord32()
+{
+    if (!m_ok || m_data.size() - m_pos < 4) {
+        m_ok = false;
+        return 0;
+    }
+    unsigned int value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= (unsigned int)(unsigned char)m_data[m_pos++] << (8 * i);
+    }
+    return value;
+}
+
+unsigned long long
+StateReader::getWord64()
+{
+    if (!m_ok || m_data.size() - m_pos < 8) {
+        m_ok = false;
+        return 0;
+    }
+    unsigned long long value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= (unsigned long long)(unsigned char)m_data[m_pos++] << (8 * i);
+    }
+    return value;
+}
+
+int
+StateReader::getInt()
+{
+    return (int)getWord32();
+}
+
+size_t
+StateReader::getSize()
+{
+    unsigned long long value = getWord64();
+    if (value != (size_t)value) {
+        m_ok = false;
+        return 0;
+    }
+    return value;
+}
+
+bool
+StateReader::getBool()
+{
+    if (!m_ok || m_pos == m_data.size()) {
+        m_ok = false;
+        return false;
+    }
+    char value = m_data[m_pos++];
+    if (value != 0 && value != 1) m_ok = false;
+    return value == 1;
+}
+
+float
+StateReader::getFloat()
+{
+    unsigned int word = getWord32();
+    float value;
+    memcpy(&value, &word, sizeof(value));
+    return value;
+}
+
+double
+StateReader::getDouble()
+{
+    unsigned long long word = getWord64();
+    double value;
+    memcpy(&value, &word, sizeof(value));
+    return value;
+}
+
+Vamp::RealTime
+StateReader::getRealTime()
+{
+    int sec = getInt();
+    int nsec = getInt();
+    return Vamp::RealTime(sec, nsec);
+}
+
+string
+StateReader::getString()
+{
+    size_t length = getCount(m_data.size());
+    if (!m_ok || m_data.size() - m_pos < length) {
+        m_ok = false;
+        return string();
+    }
+    string value = m_data.substr(m_pos, length);
+    m_pos += length;
+    return value;
+}
+
+Vamp::Plugin::Feature
+StateReader::getFeature()
+{
+    Vamp::Plugin::Feature value;
+    value.hasTimestamp = getBool();
+    value.timestamp = getRealTime();
+    value.hasDuration = getBool();
+    value.duration = getRealTime();
+    size_t count = getCount(m_data.size() / 4);
+    value.values.resize(count);
+    for (size_t i = 0; i < count; ++i) value.values[i] = getFloat();
+    value.label = getString();
+    return value;
+}
+
+size_t
+StateReader::getCount(size_t limit)
+{
+    size_t count = getSize();
+    if (count > limit) {
+        m_ok = false;
+        return 0;
+    }
+    return count;
+}
+
+bool
+StateReader::getLength(size_t expected)
+{
+    if (getSize() != expected) m_ok = false;
+    return m_ok;
+}
+
+void
+StateReader::getFloats(vector<float> &values, size_t expected)
+{
+    values.assign(expected, 0.f);
+    if (!getLength(expected)) return;
+    for (size_t i = 0; i < expected; ++i) values[i] = getFloat();
+}
+
+void
+StateReader::getDoubles(vector<double> &values, size_t expected)
+{
+    values.assign(expected, 0.);
+    if (!getLength(expected)) return;
+    for (size_t i = 0; i < expected; ++i) values[i] = getDouble();
+}
+
+void
+StateReader::getInts(vector<int> &values, size_t expected)
+{
+    values.assign(expected, 0);
+    if (!getLength(expected)) return;
+    for (size_t i = 0; i < expected; ++i) values[i] = getInt();
+}
+
+void
+StateReader::getSizes(vector<size_t> &values, size_t expected)
+{
+    values.assign(expected, 0);
+    if (!getLength(expected)) return;
+    for (size_t i = 0; i < expected; ++i) values[i] = getSize();
+}
+
+void
+StateReader::getRealTimes(vector<Vamp::RealTime> &values, size_t expected)
+{
+    values.assign(expected, Vamp::RealTime::zeroTime);
+    if (!getLength(expected)) return;
+    for (size_t i = 0; i < expected; ++i) values[i] = getRealTime();
+}
+
+void
+StateReader::getSamples(smpl_t *values, size_t expected)
+{
+    bool ok = getLength(expected);
+    for (size_t i = 0; i < expected; ++i) {
+        values[i] = ok ? (smpl_t)getDouble() : 0;
+    }
+}
+
+void
+writeStateHeader(StateWriter &writer, const Vamp::Plugin &plugin,
+                 float sampleRate, size_t stepSize, size_t blockSize)
+{
+    writer.putString(stateMagic);
+    writer.putInt(stateFormat);
+    writer.putString(plugin.getIdentifier());
+    writer.putInt(plugin.getPluginVersion());
+    writer.putFloat(sampleRate);
+    writer.putSize(stepSize);
+    writer.putSize(blockSize);
+
+    Vamp::Plugin::ParameterList params = plugin.getParameterDescriptors();
+    writer.putSize(params.size());
+    for (size_t i = 0; i < params.size(); ++i) {
+        writer.putString(params[i].identifier);
+        writer.putFloat(plugin.getParameter(params[i].identifier));
+    }
+}
+
+bool
+readStateHeader(StateReader &reader, const Vamp::Plugin &plugin,
+                float sampleRate, size_t stepSize, size_t blockSize)
+{
+    string id = plugin.getIdentifier();
+
+    if (reader.getString() != stateMagic || reader.getInt() != stateFormat) {
+        cerr << "readStateHeader: not a state of a known format" << endl;
+        return false;
+    }
+    if (reader.getString() != id ||
+        reader.getInt() != plugin.getPluginVersion()) {
+        cerr << "readStateHeader: state is not of this version of plugin \""
+             << id << "\"" << endl;
+        return false;
+    }
+    if (reader.getFloat() != sampleRate ||
+        reader.getSize() != stepSize ||
+        reader.getSize() != blockSize) {
+        cerr << "readStateHeader: state of plugin \"" << id << "\" has a "
+             << "different sample rate, step or block size" << endl;
+        return false;
+    }
+
+    Vamp::Plugin::ParameterList params = plugin.getParameterDescriptors();
+    if (reader.getSize() != params.size()) {
+        cerr << "readStateHeader: state of plugin \"" << id << "\" has "
+             << "different parameters" << endl;
+        return false;
+    }
+    for (size_t i = 0; i < params.size(); ++i) {
+        string param = reader.getString();
+        float value = reader.getFloat();
+        if (param != params[i].identifier ||
+            value != plugin.getParameter(param)) {
+            cerr << "readStateHeader: state of plugin \"" << id << "\" has "
+                 << "a different value for parameter \"" << param << "\""
+                 << endl;
+            return false;
+        }
+    }
+
+    return reader.isOK();
+}
+
+InputHistory::InputHistory() :
+    m_hops(0),
+    m_stepSize(0),
+    m_start(0),
+    m_count(0),
+    m_total(0)
+{
+}
+
+void
+InputHistory::initialise(size_t hops, size_t stepSize)
+{
+    m_hops = hops;
+    m_stepSize = stepSize;
+    m_blocks.assign(hops * stepSize, 0.f);
+    reset();
+}
+
+void
+InputHistory::reset()
+{
+    m_start = 0;
+    m_count = 0;
+    m_total = 0;
+}
+
+void
+InputHistory::push(const fvec_t *input)
+{
+    ++m_total;
+    if (m_hops == 0) return;
+
+    size_t index;
+    if (m_count < m_hops) {
+        index = (m_start + m_count) % m_hops;
+        ++m_count;
+    } else {
+        index = m_start;
+        m_start = (m_start + 1) % m_hops;
+    }
+    float *block = &m_blocks[index * m_stepSize];
+    for (size_t i = 0; i < m_stepSize; ++i) {
+        block[i] = input->data[i];
+    }
+}
+
+void
+InputHistory::save(StateWriter &writer) const
+{
+    writer.putSize(m_total);
+    writer.putSize(m_count);
+    for (size_t i = 0; i < m_count; ++i) {
+        const float *block = &m_blocks[((m_start + i) % m_hops) * m_stepSize];
+        for (size_t j = 0; j < m_stepSize; ++j) writer.putFloat(block[j]);
+    }
+}
+
+void
+InputHistory::restore(StateReader &reader)
+{
+    reset();
+    size_t total = reader.getSize();
+    size_t count = reader.getCount(m_hops);
+    if (count > total) reader.fail();
+    if (!reader.isOK()) return;
+    for (size_t i = 0; i < count * m_stepSize; ++i) {
+        m_blocks[i] = reader.getFloat();
+    }
+    m_count = count;
+    m_total = total;
+}
+
+void
+InputHistory::replay(Vamp::Plugin &plugin, size_t blockSize,
+                     float sampleRate) const
+{
+    if (m_count == 0) return;
+
+    size_t size = (blockSize > m_stepSize ? blockSize : m_stepSize);
+    vector<float> buffer(size, 0.f);
+    const float *buffers[1] = { &buffer[0] };
+    size_t frame = getStartFrame();
+
+    for (size_t i = 0; i < m_count; ++i) {
+        const float *block = &m_blocks[((m_start + i) % m_hops) * m_stepSize];
+        memcpy(&buffer[0], block, m_stepSize * sizeof(float));
+        plugin.process(buffers, Vamp::RealTime::frame2RealTime
+                       (frame, lrintf(sampleRate)));
+        frame += m_stepSize;
+    }
+}
+
+size_t
+getPvocHistoryHops(size_t stepSize, size_t blockSize)
+{
+    return (blockSize + stepSize - 1) / stepSize;
+}
+
+size_t
+getOnsetHistoryHops(size_t stepSize, size_t blockSize,
+                    float minioi, float sampleRate)
+{
+    // two past frames for the phase based detection functions, the
+    // peak picker's window of 7 and its median buffer, and the onset
+    // delay of 4.3 hops, rounded up generously
+    size_t hops = getPvocHistoryHops(stepSize, blockSize) + 16;
+    size_t minioiFrames = (size_t)ceil(minioi * sampleRate / 1000.);
+    return hops + (minioiFrames + stepSize - 1) / stepSize;
+}
+
+bool
+isOnsetMemoryBounded(OnsetType t)
+{
+    // the detection functions aubio_onset_set_default_parameters()
+    // turns adaptive whitening on for
+    switch (t) {
+    case OnsetComplex:
+    case OnsetKL:
+    case OnsetMKL:
+    case OnsetSpecFlux:
+        return false;
+    default:
+        return true;
+    }
+}
+
+Vamp::RealTime
+getLastOnsetTime(aubio_onset_t *o, size_t frameOffset, float sampleRate)
+{
+    // as aubio_onset_get_last_s(), in single precision on the frame
+    // counted from the start of the whole input
+    uint_t frame = (uint_t)frameOffset + aubio_onset_get_last(o);
+    return Vamp::RealTime::fromSeconds(frame / (smpl_t)lrintf(sampleRate));
+}
@@ -0,0 +1,212 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include <vamp-sdk/Plugin.h>
+#include <aubio/aubio.h>
+#include <string>
+#include <vector>
+
+#include "Types.h"
+
+/** Analysis state of a plugin, saved so that a run can be stopped
+  after any process() call and resumed later, in the same or another
+  instance, with the input that follows
+
+  Plugin-level state is written out as it is. The aubio objects are
+  opaque, so instead each plugin keeps the last few hops of its input
+  and rebuilds them on restore by feeding that input to a freshly reset
+  instance. That covers everything most aubio objects remember, and a
+  restored run then gives the same results as an uninterrupted one.
+  The tempo tracker and the whitened onset detection functions remember
+  more than that and cannot be rebuilt, so restoring a plugin using
+  them fails: see isOnsetMemoryBounded(). The instance restoring must
+  have been created and initialised with the same parameters, step and
+  block sizes as the one saved. */
+class Checkpointable
+{
+public:
+    virtual ~Checkpointable() { }
+
+    /** the analysis state after the last process() call */
+    virtual std::string saveState() const = 0;
+
+    /** continue from a state returned by saveState(); on failure the
+      instance is left reset and false is returned */
+    virtual bool restoreState(const std::string &state) = 0;
+};
+
+/** Portable encoding of state values: fixed width, little-endian,
+  with vectors prefixed by their length */
+class StateWriter
+{
+public:
+    StateWriter();
+
+    void putInt(int value);
+    void putSize(size_t value);
+    void putBool(bool value);
+    void putFloat(float value);
+    void putDouble(double value);
+    void putRealTime(const Vamp::RealTime &value);
+    void putString(const std::string &value);
+    void putFeature(const Vamp::Plugin::Feature &value);
+
+    void putFloats(const std::vector<float> &values);
+    void putDoubles(const std::vector<double> &values);
+    void putInts(const std::vector<int> &values);
+    void putSizes(const std::vector<size_t> &values);
+    void putRealTimes(const std::vector<Vamp::RealTime> &values);
+    /** samples are stored as doubles, whatever the precision of aubio */
+    void putSamples(const smpl_t *values, size_t count);
+
+    const std::string &getData() const { return m_data; }
+
+private:
+    std::string m_data;
+
+    void putWord32(unsigned int value);
+    void putWord64(unsigned long long value);
+};
+
+/** Decoding of a StateWriter's output; reading past the end or finding
+  a vector of the wrong length marks the reader as failed, after which
+  every value read is zero */
+class StateReader
+{
+public:
+    StateReader(const std::string &data);
+
+    int getInt();
+    size_t getSize();
+    bool getBool();
+    float getFloat();
+    double getDouble();
+    Vamp::RealTime getRealTime();
+    std::string getString();
+    Vamp::Plugin::Feature getFeature();
+
+    /** read a vector, which must have expected elements */
+    void getFloats(std::vector<float> &values, size_t expected);
+    void getDoubles(std::vector<double> &values, size_t expected);
+    void getInts(std::vector<int> &values, size_t expected);
+    void getSizes(std::vector<size_t> &values, size_t expected);
+    void getRealTimes(std::vector<Vamp::RealTime> &values, size_t expected);
+    void getSamples(smpl_t *values, size_t expected);
+
+    /** read a length, which must not exceed limit */
+    size_t getCount(size_t limit);
+
+    void fail() { m_ok = false; }
+    bool isOK() const { return m_ok; }
+    bool isAtEnd() const { return m_ok && m_pos == m_data.size(); }
+
+private:
+    const std::string &m_data;
+    size_t m_pos;
+    bool m_ok;
+
+    unsigned int getWord32();
+    unsigned long long getWord64();
+    bool getLength(size_t expected);
+};
+
+/** Write the identity and configuration of plugin: its identifier and
+  version, input rate, step and block sizes and parameter values */
+void writeStateHeader(StateWriter &writer, const Vamp::Plugin &plugin,
+                      float sampleRate, size_t stepSize, size_t blockSize);
+
+/** Check that a state written by writeStateHeader() comes from a
+  plugin configured as this one, printing the difference if not */
+bool readStateHeader(StateReader &reader, const Vamp::Plugin &plugin,
+                     float sampleRate, size_t stepSize, size_t blockSize);
+
+/** The input of the last few calls to process(): the first stepSize
+  samples of each block, which are all the plugins pass on to aubio */
+class InputHistory
+{
+public:
+    InputHistory();
+
+    /** keep the last hops blocks of stepSize samples, and clear */
+    void initialise(size_t hops, size_t stepSize);
+    void reset();
+
+    void push(const fvec_t *input);
+
+    /** number of blocks pushed since the last reset, kept or not */
+    size_t getTotal() const { return m_total; }
+    /** first sample frame of the oldest block kept */
+    size_t getStartFrame() const { return (m_total - m_count) * m_stepSize; }
+
+    /** number of blocks kept, and block i of them, oldest first */
+    size_t getCount() const { return m_count; }
+    const float *getBlock(size_t i) const {
+        return &m_blocks[((m_start + i) % m_hops) * m_stepSize];
+    }
+
+    void save(StateWriter &writer) const;
+    void restore(StateReader &reader);
+
+    /** pass the blocks kept, oldest first, to plugin's process() as
+      blocks of blockSize samples padded with zeros, discarding the
+      features returned; timestamps follow on from getStartFrame() */
+    void replay(Vamp::Plugin &plugin, size_t blockSize, float sampleRate) const;
+
+private:
+    size_t m_hops;
+    size_t m_stepSize;
+    std::vector<float> m_blocks;   // ring of m_hops blocks
+    size_t m_start;
+    size_t m_count;
+    size_t m_total;
+};
+
+/** Hops of input covering a phase vocoder of blockSize over stepSize */
+size_t getPvocHistoryHops(size_t stepSize, size_t blockSize);
+
+/** Hops of input covering an aubio onset detector: its phase vocoder,
+  detection function and peak picker histories, the onset delay and a
+  minimum inter-onset interval of minioi ms */
+size_t getOnsetHistoryHops(size_t stepSize, size_t blockSize,
+                           float minioi, float sampleRate);
+
+/** Whether an aubio onset detector of type t remembers no more than
+  getOnsetHistoryHops() of its input, and so can be restored. aubio
+  whitens the complex, kl, mkl and specflux detection functions against
+  running spectral peaks that decay over minutes, so once rebuilt those
+  would be scaled differently for a while, and onsets close to the
+  threshold would come and go. */
+bool isOnsetMemoryBounded(OnsetType t);
+
+/** The time of the last onset found by o, whose input started at
+  frameOffset; the same value as aubio_onset_get_last_s() gives when
+  the input started at frame 0 */
+Vamp::RealTime getLastOnsetTime(aubio_onset_t *o, size_t frameOffset,
+                                float sampleRate);
+
+#endif /* _CHECKPOINT_H_ */
@@ -0,0 +1,101 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _DENORMAL_GUARD_H_
+#define _DENORMAL_GUARD_H_
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+/** Scoped switch of the floating point unit to flush denormals to zero
+
+  The recursive filters inside aubio's detectors decay into denormal
+  numbers over fades and silent tails, where every operation on them
+  can cost a hundred times more. For its lifetime, a DenormalGuard
+  sets the flush-to-zero and denormals-are-zero modes of SSE on x86,
+  or the flush-to-zero mode on ARM, and puts back the mode it found,
+  so that hosts calling the plugins see their own settings unchanged.
+  It does nothing elsewhere, and does not affect x87 arithmetic.
+
+  Each plugin holds one over the analysis in processInput(), which
+  process() calls, and over getRemainingFeatures() when that analyses
+  remaining input. Results only change where denormals occurred. */
+class DenormalGuard
+{
+public:
+    /** whether guards change the mode at all, true unless turned off,
+      as vamp-aubio-check does to measure what they save; only change
+      it while no plugin is analysing */
+    static bool isEnabled() { return enabled(); }
+    static void setEnabled(bool e) { enabled() = e; }
+
+#if defined(__SSE__) || defined(_M_X64)
+    DenormalGuard() : m_saved(_mm_getcsr()) {
+        unsigned int mode = m_saved | (enabled() ? 0x8040 : 0); // FTZ | DAZ
+        if (mode != m_saved) _mm_setcsr(mode);
+    }
+    ~DenormalGuard() {
+        if (_mm_getcsr() != m_saved) _mm_setcsr(m_saved);
+    }
+private:
+    unsigned int m_saved;
+#elif defined(__aarch64__)
+    DenormalGuard() {
+        __asm__ __volatile__ ("mrs %0, fpcr" : "=r" (m_saved));
+        unsigned long long mode = m_saved | (enabled() ? 1ULL << 24 : 0); // FZ
+        if (mode != m_saved) __asm__ __volatile__ ("msr fpcr, %0" : : "r" (mode));
+    }
+    ~DenormalGuard() {
+        __asm__ __volatile__ ("msr fpcr, %0" : : "r" (m_saved));
+    }
+private:
+    unsigned long long m_saved;
+#elif defined(__arm__) && defined(__VFP_FP__) && !defined(__SOFTFP__)
+    DenormalGuard() {
+        __asm__ __volatile__ ("vmrs %0, fpscr" : "=r" (m_saved));
+        unsigned int mode = m_saved | (enabled() ? 1U << 24 : 0); // FZ
+        if (mode != m_saved) __asm__ __volatile__ ("vmsr fpscr, %0" : : "r" (mode));
+    }
+    ~DenormalGuard() {
+        __asm__ __volatile__ ("vmsr fpscr, %0" : : "r" (m_saved));
+    }
+private:
+    unsigned int m_saved;
+#else
+    DenormalGuard() { }
+#endif
+
+private:
+    static bool &enabled() {
+        static bool e = true;
+        return e;
+    }
+
+    DenormalGuard(const DenormalGuard &);
+    DenormalGuard &operator=(const DenormalGuard &);
+};
+
+#endif /* _DENORMAL_GUARD_H_ */
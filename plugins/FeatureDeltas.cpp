@@ -0,0 +1,195 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "FeatureDeltas.h"
+
+using std::string;
+using std::vector;
+
+FeatureDeltas::FeatureDeltas() :
+    m_bins(0),
+    m_halfWidth(0),
+    m_size(0),
+    m_norm(0),
+    m_frameCount(0),
+    m_deltaCount(0),
+    m_deltaDeltaCount(0)
+{
+}
+
+void
+FeatureDeltas::initialise(size_t bins, size_t halfWidth)
+{
+    m_bins = bins;
+    m_halfWidth = halfWidth;
+    m_size = 2 * halfWidth + 1;
+    m_norm = 0;
+    for (size_t n = 1; n <= halfWidth; ++n) m_norm += 2. * n * n;
+    reset();
+}
+
+void
+FeatureDeltas::reset()
+{
+    m_frames.assign(m_size * m_bins, 0.f);
+    m_deltas.assign(m_size * m_bins, 0.f);
+    m_times.assign(m_size, Vamp::RealTime::zeroTime);
+    m_frameCount = 0;
+    m_deltaCount = 0;
+    m_deltaDeltaCount = 0;
+}
+
+void
+FeatureDeltas::save(StateWriter &writer) const
+{
+    writer.putFloats(m_frames);
+    writer.putFloats(m_deltas);
+    writer.putRealTimes(m_times);
+    writer.putSize(m_frameCount);
+    writer.putSize(m_deltaCount);
+    writer.putSize(m_deltaDeltaCount);
+}
+
+void
+FeatureDeltas::restore(StateReader &reader)
+{
+    reader.getFloats(m_frames, m_size * m_bins);
+    reader.getFloats(m_deltas, m_size * m_bins);
+    reader.getRealTimes(m_times, m_size);
+    m_frameCount = reader.getSize();
+    m_deltaCount = reader.getSize();
+    m_deltaDeltaCount = reader.getSize();
+    if (m_deltaCount > m_frameCount || m_deltaDeltaCount > m_deltaCount) {
+        reader.fail();
+    }
+}
+
+void
+FeatureDeltas::add(const smpl_t *values, const Vamp::RealTime &timestamp,
+                   Vamp::Plugin::FeatureSet &fs, int deltaOutput, int deltaDeltaOutput)
+{
+    size_t slot = m_frameCount % m_size;
+    for (size_t i = 0; i < m_bins; ++i) {
+        m_frames[slot * m_bins + i] = values[i];
+    }
+    m_times[slot] = timestamp;
+    ++m_frameCount;
+
+    update(fs, deltaOutput, deltaDeltaOutput, false);
+}
+
+void
+FeatureDeltas::flush(Vamp::Plugin::FeatureSet &fs, int deltaOutput, int deltaDeltaOutput)
+{
+    update(fs, deltaOutput, deltaDeltaOutput, true);
+}
+
+void
+FeatureDeltas::regress(const vector<float> &ring, size_t t, size_t last,
+                       float *out) const
+{
+    for (size_t i = 0; i < m_bins; ++i) out[i] = 0.f;
+    for (size_t n = 1; n <= m_halfWidth; ++n) {
+        // repeat the first and last frames beyond the edges
+        size_t next = t + n > last ? last : t + n;
+        size_t prev = t < n ? 0 : t - n;
+        const float *a = &ring[(next % m_size) * m_bins];
+        const float *b = &ring[(prev % m_size) * m_bins];
+        for (size_t i = 0; i < m_bins; ++i) {
+            out[i] += n * (a[i] - b[i]);
+        }
+    }
+    for (size_t i = 0; i < m_bins; ++i) out[i] /= m_norm;
+}
+
+void
+FeatureDeltas::update(Vamp::Plugin::FeatureSet &fs, int deltaOutput,
+                      int deltaDeltaOutput, bool final)
+{
+    if (m_frameCount == 0) return;
+
+    Vamp::Plugin::Feature feature;
+    feature.hasTimestamp = true;
+    feature.values.resize(m_bins);
+
+    size_t lastFrame = m_frameCount - 1;
+
+    // the delta of frame t needs frames up to t + N, unless the input
+    // has ended; each new delta may complete a delta-delta likewise
+    while (m_deltaCount < m_frameCount &&
+           (final || m_deltaCount + m_halfWidth <= lastFrame)) {
+
+        size_t t = m_deltaCount;
+        float *delta = &m_deltas[(t % m_size) * m_bins];
+        regress(m_frames, t, lastFrame, delta);
+        ++m_deltaCount;
+
+        if (deltaOutput >= 0) {
+            feature.timestamp = m_times[t % m_size];
+            feature.values.assign(delta, delta + m_bins);
+            fs[deltaOutput].push_back(feature);
+        }
+
+        while (m_deltaDeltaCount + m_halfWidth < m_deltaCount) {
+            size_t s = m_deltaDeltaCount++;
+            if (deltaDeltaOutput < 0) continue;
+            regress(m_deltas, s, m_deltaCount - 1, &feature.values[0]);
+            feature.timestamp = m_times[s % m_size];
+            fs[deltaDeltaOutput].push_back(feature);
+        }
+    }
+
+    while (final && m_deltaDeltaCount < m_deltaCount) {
+        size_t s = m_deltaDeltaCount++;
+        if (deltaDeltaOutput < 0) continue;
+        regress(m_deltas, s, m_deltaCount - 1, &feature.values[0]);
+        feature.timestamp = m_times[s % m_size];
+        fs[deltaDeltaOutput].push_back(feature);
+    }
+}
+
+void
+FeatureDeltas::addOutputDescriptors(Vamp::Plugin::OutputList &list,
+                                    const string &prefix,
+                                    const Vamp::Plugin::OutputDescriptor &frames,
+                                    float frameRate)
+{
+    Vamp::Plugin::OutputDescriptor d(frames);
+    d.hasKnownExtents = false;
+    d.isQuantized = false;
+    d.sampleType = Vamp::Plugin::OutputDescriptor::FixedSampleRate;
+    d.sampleRate = frameRate;
+    d.hasDuration = false;
+
+    d.identifier = prefix + "delta";
+    d.name = frames.name + " Delta";
+    d.description = "First order regression delta of each bin";
+    list.push_back(d);
+
+    d.identifier = prefix + "deltadelta";
+    d.name = frames.name + " Delta-Delta";
+    d.description = "Second order regression delta of each bin";
+    list.push_back(d);
+}
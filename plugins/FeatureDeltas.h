@@ -0,0 +1,96 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _FEATURE_DELTAS_H_
+#define _FEATURE_DELTAS_H_
+
+#include <vamp-sdk/Plugin.h>
+#include <aubio/aubio.h>
+#include <vector>
+
+#include "Checkpoint.h"
+
+/** First and second order regression deltas of a sequence of frames
+
+  The delta of frame t is sum_n n (c[t+n] - c[t-n]) / (2 sum_n n^2) for
+  n from 1 to the window half-width N, with the first and last frames
+  repeated at the edges. Deltas come out N frames late and delta-deltas
+  2N frames late, and only the last 2N+1 frames and deltas are kept.
+
+  Features carry the timestamp of the frame they belong to, on two
+  fixed-rate outputs.
+
+*/
+class FeatureDeltas
+{
+public:
+    FeatureDeltas();
+
+    /** set the number of bins and the window half-width, and clear
+      the history */
+    void initialise(size_t bins, size_t halfWidth);
+    /** clear the history */
+    void reset();
+
+    /** write or read back the frames and deltas still to be pushed */
+    void save(StateWriter &writer) const;
+    void restore(StateReader &reader);
+
+    /** add a frame starting at timestamp, pushing the deltas and
+      delta-deltas now known to fs[deltaOutput] and fs[deltaDeltaOutput];
+      a negative output index skips that output */
+    void add(const smpl_t *values, const Vamp::RealTime &timestamp,
+             Vamp::Plugin::FeatureSet &fs, int deltaOutput, int deltaDeltaOutput);
+
+    /** push the deltas and delta-deltas of the last frames */
+    void flush(Vamp::Plugin::FeatureSet &fs, int deltaOutput, int deltaDeltaOutput);
+
+    /** append the descriptors of the delta and delta-delta outputs,
+      identified by prefix and named after the per-frame output */
+    static void addOutputDescriptors(Vamp::Plugin::OutputList &list,
+                                     const std::string &prefix,
+                                     const Vamp::Plugin::OutputDescriptor &frames,
+                                     float frameRate);
+
+protected:
+    size_t m_bins;
+    size_t m_halfWidth;
+    size_t m_size;          // 2 * m_halfWidth + 1, length of the rings
+    double m_norm;
+
+    std::vector<float> m_frames;
+    std::vector<float> m_deltas;
+    std::vector<Vamp::RealTime> m_times;
+    size_t m_frameCount;
+    size_t m_deltaCount;
+    size_t m_deltaDeltaCount;
+
+    void update(Vamp::Plugin::FeatureSet &fs, int deltaOutput,
+                int deltaDeltaOutput, bool final);
+    void regress(const std::vector<float> &ring, size_t t, size_t last,
+                 float *out) const;
+};
+
+#endif /* _FEATURE_DELTAS_H_ */
@@ -0,0 +1,228 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <math.h>
+#include <stdio.h>
+#include <iostream>
+
+#include "FeatureEncoding.h"
+
+using std::string;
+
+FeatureEncoding::FeatureEncoding(float defaultMin, float defaultMax) :
+    m_defaultMin(defaultMin),
+    m_defaultMax(defaultMax),
+    m_type(EncodingFloat32),
+    m_min(defaultMin),
+    m_max(defaultMax),
+    m_levels(0),
+    m_offset(0),
+    m_scale(1)
+{
+    updateScale();
+}
+
+void
+FeatureEncoding::addParameterDescriptors(Vamp::Plugin::ParameterList &list) const
+{
+    Vamp::Plugin::ParameterDescriptor desc;
+    desc.identifier = "encoding";
+    desc.name = "Output encoding";
+    desc.description = "Encoding of the values of the per-frame output";
+    desc.minValue = 0;
+    desc.maxValue = 5;
+    desc.defaultValue = (int)EncodingFloat32;
+    desc.isQuantized = true;
+    desc.quantizeStep = 1;
+    desc.valueNames.push_back("Float 32");
+    desc.valueNames.push_back("Float 16");
+    desc.valueNames.push_back("Linear 16-bit");
+    desc.valueNames.push_back("Linear 8-bit");
+    desc.valueNames.push_back("Log 16-bit");
+    desc.valueNames.push_back("Log 8-bit");
+    list.push_back(desc);
+
+    desc = Vamp::Plugin::ParameterDescriptor();
+    desc.identifier = "encodingmin";
+    desc.name = "Encoding lowest value";
+    desc.description = "Value of the lowest linear or log code, lower values are clamped";
+    desc.minValue = -1000;
+    desc.maxValue = 1000;
+    desc.defaultValue = m_defaultMin;
+    desc.isQuantized = false;
+    list.push_back(desc);
+
+    desc = Vamp::Plugin::ParameterDescriptor();
+    desc.identifier = "encodingmax";
+    desc.name = "Encoding highest value";
+    desc.description = "Value of the highest linear or log code, higher values are clamped";
+    desc.minValue = -1000;
+    desc.maxValue = 1000;
+    desc.defaultValue = m_defaultMax;
+    desc.isQuantized = false;
+    list.push_back(desc);
+}
+
+bool
+FeatureEncoding::getParameter(const string &param, float &value) const
+{
+    if (param == "encoding") {
+        value = (int)m_type;
+    } else if (param == "encodingmin") {
+        value = m_min;
+    } else if (param == "encodingmax") {
+        value = m_max;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool
+FeatureEncoding::setParameter(const string &param, float value)
+{
+    if (param == "encoding") {
+        int type = lrintf(value);
+        if (type < 0 || type > (int)EncodingLog8) type = (int)EncodingFloat32;
+        m_type = (OutputEncoding)type;
+    } else if (param == "encodingmin") {
+        m_min = value;
+    } else if (param == "encodingmax") {
+        m_max = value;
+    } else {
+        return false;
+    }
+    updateScale();
+    return true;
+}
+
+bool
+FeatureEncoding::initialise()
+{
+    if (m_levels == 0) return true;
+
+    if (m_max <= m_min) {
+        std::cerr << "FeatureEncoding::initialise: highest value must be above lowest value" << std::endl;
+        return false;
+    }
+    if ((m_type == EncodingLog16 || m_type == EncodingLog8) && m_min <= 0) {
+        std::cerr << "FeatureEncoding::initialise: log encoding needs a positive lowest value" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void
+FeatureEncoding::updateScale()
+{
+    switch (m_type) {
+    case EncodingLinear16: case EncodingLog16: m_levels = 65535; break;
+    case EncodingLinear8: case EncodingLog8: m_levels = 255; break;
+    default: m_levels = 0; return;
+    }
+
+    if (m_type == EncodingLog16 || m_type == EncodingLog8) {
+        m_offset = m_min > 0 ? log10f(m_min) : 0;
+        m_scale = m_max > 0 ? (log10f(m_max) - m_offset) / m_levels : 0;
+    } else {
+        m_offset = m_min;
+        m_scale = (m_max - m_min) / m_levels;
+    }
+}
+
+void
+FeatureEncoding::adaptOutputDescriptor(Vamp::Plugin::OutputDescriptor &d) const
+{
+    if (m_type == EncodingFloat32) return;
+
+    if (m_type == EncodingFloat16) {
+        d.description += " (rounded to half precision floats)";
+        return;
+    }
+
+    bool log = (m_type == EncodingLog16 || m_type == EncodingLog8);
+    char text[200];
+    snprintf(text, sizeof(text),
+             " (as %d-bit %s codes, value = %s%.9g + code * %.9g%s)",
+             m_levels > 255 ? 16 : 8, log ? "log" : "linear",
+             log ? "10^(" : "", m_offset, m_scale, log ? ")" : "");
+    d.description += text;
+    d.unit = "";
+    d.hasKnownExtents = true;
+    d.minValue = 0;
+    d.maxValue = m_levels;
+    d.isQuantized = true;
+    d.quantizeStep = 1;
+}
+
+float
+FeatureEncoding::encode(float value) const
+{
+    switch (m_type) {
+    case EncodingFloat32:
+        return value;
+    case EncodingFloat16:
+        return roundToHalf(value);
+    case EncodingLog16: case EncodingLog8:
+        value = value > m_min ? log10f(value) : m_offset;
+        break;
+    default:
+        break;
+    }
+    float code = rintf((value - m_offset) / m_scale);
+    if (!(code > 0)) return 0; // also catches NaN
+    if (code > m_levels) return m_levels;
+    return code;
+}
+
+float
+FeatureEncoding::decode(float code) const
+{
+    switch (m_type) {
+    case EncodingFloat32: case EncodingFloat16:
+        return code;
+    case EncodingLog16: case EncodingLog8:
+        return powf(10.f, m_offset + code * m_scale);
+    default:
+        return m_offset + code * m_scale;
+    }
+}
+
+float
+FeatureEncoding::roundToHalf(float value)
+{
+    float magnitude = fabsf(value);
+    if (magnitude != magnitude) return value;
+    // beyond the largest half, 65504, values round to infinity
+    if (magnitude >= 65520.f) return value > 0 ? HUGE_VALF : -HUGE_VALF;
+    // below 2^-14, halves are subnormal, with a fixed step of 2^-24
+    if (magnitude < 6.103515625e-05f) {
+        return ldexpf(rintf(ldexpf(value, 24)), -24);
+    }
+    // otherwise 11 significant bits
+    int exponent;
+    float mantissa = frexpf(value, &exponent);
+    return ldexpf(rintf(ldexpf(mantissa, 11)), exponent - 11);
+}
@@ -0,0 +1,93 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _FEATURE_ENCODING_H_
+#define _FEATURE_ENCODING_H_
+
+#include <vamp-sdk/Plugin.h>
+
+// In the order of the values of the encoding parameter
+enum OutputEncoding {
+    EncodingFloat32,
+    EncodingFloat16,
+    EncodingLinear16,
+    EncodingLinear8,
+    EncodingLog16,
+    EncodingLog8
+};
+
+/** Compact encodings of feature values
+
+  Linear and log encodings map the values of a fixed range to integer
+  codes of 8 or 16 bits, clamping values outside the range. With the
+  offset and scale published in the output description, a value is
+  decoded as offset + code * scale, or 10^(offset + code * scale) for
+  log codes. The float16 encoding rounds values to the nearest half
+  precision float, so that they can be stored in 16 bits without
+  further loss.
+
+  The encoding is set by three parameters: "encoding", and the lowest
+  and highest values mapped to codes, "encodingmin" and "encodingmax".
+
+*/
+class FeatureEncoding
+{
+public:
+    FeatureEncoding(float defaultMin, float defaultMax);
+
+    /** append the descriptors of the encoding parameters */
+    void addParameterDescriptors(Vamp::Plugin::ParameterList &list) const;
+    /** get or set one of the encoding parameters, returning false if
+      param is not one of them */
+    bool getParameter(const std::string &param, float &value) const;
+    bool setParameter(const std::string &param, float value);
+
+    /** check that the range suits the encoding */
+    bool initialise();
+
+    /** describe the codes in the descriptor of an encoded output */
+    void adaptOutputDescriptor(Vamp::Plugin::OutputDescriptor &d) const;
+
+    float encode(float value) const;
+    float decode(float code) const;
+
+    static float roundToHalf(float value);
+
+protected:
+    float m_defaultMin;
+    float m_defaultMax;
+
+    OutputEncoding m_type;
+    float m_min;
+    float m_max;
+
+    float m_levels; // highest code
+    float m_offset;
+    float m_scale;
+
+    void updateScale();
+};
+
+#endif /* _FEATURE_ENCODING_H_ */
@@ -0,0 +1,170 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include "FeaturePyramid.h"
+
+using std::string;
+using std::vector;
+
+FeaturePyramid::FeaturePyramid() :
+    m_bins(0),
+    m_levels(0)
+{
+}
+
+void
+FeaturePyramid::initialise(size_t bins, size_t levels,
+                           const Vamp::RealTime &frameDuration)
+{
+    m_bins = bins;
+    m_levels = levels;
+    m_frameDuration = frameDuration;
+    reset();
+}
+
+void
+FeaturePyramid::reset()
+{
+    m_sum.assign(m_levels * m_bins, 0.);
+    m_max.assign(m_levels * m_bins, 0.f);
+    m_count.assign(m_levels, 0);
+    m_start.assign(m_levels, Vamp::RealTime::zeroTime);
+}
+
+void
+FeaturePyramid::save(StateWriter &writer) const
+{
+    writer.putDoubles(m_sum);
+    writer.putFloats(m_max);
+    writer.putSizes(m_count);
+    writer.putRealTimes(m_start);
+    writer.putRealTime(m_lastTimestamp);
+}
+
+void
+FeaturePyramid::restore(StateReader &reader)
+{
+    reader.getDoubles(m_sum, m_levels * m_bins);
+    reader.getFloats(m_max, m_levels * m_bins);
+    reader.getSizes(m_count, m_levels);
+    reader.getRealTimes(m_start, m_levels);
+    m_lastTimestamp = reader.getRealTime();
+    for (size_t k = 0; k < m_count.size(); ++k) {
+        if (m_count[k] >= ((size_t)2 << k)) reader.fail();
+    }
+}
+
+void
+FeaturePyramid::add(const smpl_t *values, const Vamp::RealTime &timestamp,
+                    Vamp::Plugin::FeatureSet &fs, int meanOutput, int maxOutput)
+{
+    for (size_t k = 0; k < m_levels; ++k) {
+        double *sum = &m_sum[k * m_bins];
+        float *max = &m_max[k * m_bins];
+        if (m_count[k] == 0) {
+            m_start[k] = timestamp;
+            for (size_t i = 0; i < m_bins; ++i) {
+                sum[i] = values[i];
+                max[i] = values[i];
+            }
+        } else {
+            for (size_t i = 0; i < m_bins; ++i) {
+                sum[i] += values[i];
+                if (values[i] > max[i]) max[i] = values[i];
+            }
+        }
+        if (++m_count[k] == ((size_t)2 << k)) {
+            pushBlock(k, timestamp + m_frameDuration, fs, meanOutput, maxOutput);
+        }
+    }
+    m_lastTimestamp = timestamp;
+}
+
+void
+FeaturePyramid::flush(Vamp::Plugin::FeatureSet &fs, int meanOutput, int maxOutput)
+{
+    for (size_t k = 0; k < m_levels; ++k) {
+        if (m_count[k] > 0) {
+            pushBlock(k, m_lastTimestamp + m_frameDuration,
+                      fs, meanOutput, maxOutput);
+        }
+    }
+}
+
+void
+FeaturePyramid::pushBlock(size_t level, const Vamp::RealTime &endTime,
+                          Vamp::Plugin::FeatureSet &fs, int meanOutput, int maxOutput)
+{
+    char label[32];
+    snprintf(label, sizeof(label), "x%lu", (unsigned long)(2ul << level));
+
+    Vamp::Plugin::Feature feature;
+    feature.hasTimestamp = true;
+    feature.timestamp = m_start[level];
+    feature.hasDuration = true;
+    feature.duration = endTime - m_start[level];
+    feature.label = label;
+
+    if (meanOutput >= 0) {
+        const double *sum = &m_sum[level * m_bins];
+        feature.values.resize(m_bins);
+        for (size_t i = 0; i < m_bins; ++i) {
+            feature.values[i] = sum[i] / m_count[level];
+        }
+        fs[meanOutput].push_back(feature);
+    }
+
+    if (maxOutput >= 0) {
+        const float *max = &m_max[level * m_bins];
+        feature.values.assign(max, max + m_bins);
+        fs[maxOutput].push_back(feature);
+    }
+
+    m_count[level] = 0;
+}
+
+void
+FeaturePyramid::addOutputDescriptors(Vamp::Plugin::OutputList &list,
+                                     const string &prefix,
+                                     const Vamp::Plugin::OutputDescriptor &frames)
+{
+    Vamp::Plugin::OutputDescriptor d(frames);
+    d.hasKnownExtents = false;
+    d.isQuantized = false;
+    d.sampleType = Vamp::Plugin::OutputDescriptor::VariableSampleRate;
+    d.sampleRate = 0;
+    d.hasDuration = true;
+
+    d.identifier = prefix + "pyramidmean";
+    d.name = frames.name + " Pyramid Mean";
+    d.description = "Mean of each bin over blocks of 2, 4, 8, ... frames, labelled with their decimation factor";
+    list.push_back(d);
+
+    d.identifier = prefix + "pyramidmax";
+    d.name = frames.name + " Pyramid Maximum";
+    d.description = "Maximum of each bin over blocks of 2, 4, 8, ... frames, labelled with their decimation factor";
+    list.push_back(d);
+}
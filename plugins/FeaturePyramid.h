@@ -0,0 +1,91 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _FEATURE_PYRAMID_H_
+#define _FEATURE_PYRAMID_H_
+
+#include <vamp-sdk/Plugin.h>
+#include <aubio/aubio.h>
+#include <vector>
+
+#include "Checkpoint.h"
+
+/** Multi-resolution mean and maximum of a sequence of feature vectors
+
+  Level k covers blocks of 2^k consecutive frames, for k from 1 to the
+  number of levels. Each level keeps one running sum and maximum, and a
+  block is returned as soon as its last frame has been added, so that
+  all levels come out of a single pass in constant memory.
+
+  Blocks are returned on two sparse outputs, one for means and one for
+  maxima, labelled with their decimation factor ("x2", "x4", ...).
+
+*/
+class FeaturePyramid
+{
+public:
+    FeaturePyramid();
+
+    /** set the number of bins and levels, the duration of one frame,
+      and clear all blocks */
+    void initialise(size_t bins, size_t levels, const Vamp::RealTime &frameDuration);
+    /** clear all blocks */
+    void reset();
+
+    /** write or read back the incomplete blocks of all levels */
+    void save(StateWriter &writer) const;
+    void restore(StateReader &reader);
+
+    /** add a frame starting at timestamp, pushing any completed block
+      to fs[meanOutput] and fs[maxOutput]; a negative output index skips
+      that output */
+    void add(const smpl_t *values, const Vamp::RealTime &timestamp,
+             Vamp::Plugin::FeatureSet &fs, int meanOutput, int maxOutput);
+
+    /** push the incomplete blocks of all levels */
+    void flush(Vamp::Plugin::FeatureSet &fs, int meanOutput, int maxOutput);
+
+    /** append the descriptors of the mean and max outputs, identified
+      by prefix and named after the per-frame output they decimate */
+    static void addOutputDescriptors(Vamp::Plugin::OutputList &list,
+                                     const std::string &prefix,
+                                     const Vamp::Plugin::OutputDescriptor &frames);
+
+protected:
+    size_t m_bins;
+    size_t m_levels;
+    Vamp::RealTime m_frameDuration;
+
+    std::vector<double> m_sum;      // m_levels * m_bins
+    std::vector<float> m_max;       // m_levels * m_bins
+    std::vector<size_t> m_count;    // frames in the current block of each level
+    std::vector<Vamp::RealTime> m_start;
+    Vamp::RealTime m_lastTimestamp;
+
+    void pushBlock(size_t level, const Vamp::RealTime &endTime,
+                   Vamp::Plugin::FeatureSet &fs, int meanOutput, int maxOutput);
+};
+
+#endif /* _FEATURE_PYRAMID_H_ */
@@ -0,0 +1,253 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <math.h>
+#include <algorithm>
+#include "FeatureStats.h"
+
+using std::string;
+using std::vector;
+
+// Quantiles estimated when enabled, and their feature labels
+static const double quantiles[] = { 0.1, 0.25, 0.5, 0.75, 0.9 };
+static const char *const quantileNames[] = { "10%", "25%", "50%", "75%", "90%" };
+static const size_t nquantiles = sizeof(quantiles) / sizeof(quantiles[0]);
+
+FeatureStats::FeatureStats() :
+    m_bins(0),
+    m_count(0),
+    m_withQuantiles(false)
+{
+}
+
+void
+FeatureStats::initialise(size_t bins, bool withQuantiles)
+{
+    m_bins = bins;
+    m_withQuantiles = withQuantiles;
+    reset();
+}
+
+void
+FeatureStats::reset()
+{
+    m_count = 0;
+    m_mean.assign(m_bins, 0.);
+    m_m2.assign(m_bins, 0.);
+    m_min.assign(m_bins, 0.f);
+    m_max.assign(m_bins, 0.f);
+    size_t markers = m_withQuantiles ? m_bins * nquantiles * 5 : 0;
+    m_heights.assign(markers, 0.);
+    m_desired.assign(markers, 0.);
+    m_positions.assign(markers, 0);
+}
+
+void
+FeatureStats::save(StateWriter &writer) const
+{
+    writer.putSize(m_count);
+    writer.putRealTime(m_start);
+    writer.putDoubles(m_mean);
+    writer.putDoubles(m_m2);
+    writer.putFloats(m_min);
+    writer.putFloats(m_max);
+    writer.putDoubles(m_heights);
+    writer.putDoubles(m_desired);
+    writer.putInts(m_positions);
+}
+
+void
+FeatureStats::restore(StateReader &reader)
+{
+    m_count = reader.getSize();
+    m_start = reader.getRealTime();
+    reader.getDoubles(m_mean, m_bins);
+    reader.getDoubles(m_m2, m_bins);
+    reader.getFloats(m_min, m_bins);
+    reader.getFloats(m_max, m_bins);
+    reader.getDoubles(m_heights, m_heights.size());
+    reader.getDoubles(m_desired, m_desired.size());
+    reader.getInts(m_positions, m_positions.size());
+}
+
+void
+FeatureStats::add(const smpl_t *values, const Vamp::RealTime &timestamp)
+{
+    if (m_count == 0) m_start = timestamp;
+    ++m_count;
+
+    for (size_t i = 0; i < m_bins; ++i) {
+        double x = values[i];
+        double delta = x - m_mean[i];
+        m_mean[i] += delta / m_count;
+        m_m2[i] += delta * (x - m_mean[i]);
+        if (m_count == 1 || values[i] < m_min[i]) m_min[i] = values[i];
+        if (m_count == 1 || values[i] > m_max[i]) m_max[i] = values[i];
+        if (m_withQuantiles) {
+            for (size_t q = 0; q < nquantiles; ++q) {
+                addQuantile((i * nquantiles + q) * 5, quantiles[q], x);
+            }
+        }
+    }
+}
+
+void
+FeatureStats::addQuantile(size_t marker, double p, double x)
+{
+    double *h = &m_heights[marker];
+    double *d = &m_desired[marker];
+    int *n = &m_positions[marker];
+
+    // the first five observations initialise the markers
+    if (m_count <= 5) {
+        h[m_count - 1] = x;
+        if (m_count == 5) {
+            std::sort(h, h + 5);
+            for (int i = 0; i < 5; ++i) n[i] = i;
+            d[0] = 0;
+            d[1] = 2 * p;
+            d[2] = 4 * p;
+            d[3] = 2 + 2 * p;
+            d[4] = 4;
+        }
+        return;
+    }
+
+    int k;
+    if (x < h[0]) {
+        h[0] = x;
+        k = 0;
+    } else if (x >= h[4]) {
+        h[4] = x;
+        k = 3;
+    } else {
+        k = 0;
+        while (x >= h[k + 1]) ++k;
+    }
+
+    for (int i = k + 1; i < 5; ++i) ++n[i];
+    d[1] += p / 2;
+    d[2] += p;
+    d[3] += (1 + p) / 2;
+    d[4] += 1;
+
+    // move the middle markers towards their desired positions
+    for (int i = 1; i < 4; ++i) {
+        double delta = d[i] - n[i];
+        if ((delta >= 1 && n[i + 1] - n[i] > 1) ||
+            (delta <= -1 && n[i - 1] - n[i] < -1)) {
+            int s = delta > 0 ? 1 : -1;
+            double hp = h[i] + (double)s / (n[i + 1] - n[i - 1]) *
+                ((n[i] - n[i - 1] + s) * (h[i + 1] - h[i]) / (n[i + 1] - n[i]) +
+                 (n[i + 1] - n[i] - s) * (h[i] - h[i - 1]) / (n[i] - n[i - 1]));
+            if (h[i - 1] < hp && hp < h[i + 1]) {
+                h[i] = hp;
+            } else {
+                h[i] += s * (h[i + s] - h[i]) / (n[i + s] - n[i]);
+            }
+            n[i] += s;
+        }
+    }
+}
+
+double
+FeatureStats::getQuantile(size_t marker, double p) const
+{
+    const double *h = &m_heights[marker];
+    if (m_count >= 5) return h[2];
+    // fewer than five observations: exact quantile of what we have
+    vector<double> sorted(h, h + m_count);
+    std::sort(sorted.begin(), sorted.end());
+    return sorted[(size_t)floor(p * (m_count - 1) + 0.5)];
+}
+
+void
+FeatureStats::getFeatures(Vamp::Plugin::FeatureSet &fs,
+                          int momentsOutput, int quantilesOutput,
+                          const Vamp::RealTime &endTime) const
+{
+    if (m_count == 0) return;
+
+    Vamp::Plugin::Feature feature;
+    feature.hasTimestamp = true;
+    feature.timestamp = m_start;
+    feature.hasDuration = true;
+    feature.duration = endTime - m_start;
+
+    if (momentsOutput >= 0) {
+        feature.label = "mean";
+        feature.values.assign(m_mean.begin(), m_mean.end());
+        fs[momentsOutput].push_back(feature);
+
+        feature.label = "variance";
+        for (size_t i = 0; i < m_bins; ++i) {
+            feature.values[i] = m_count > 1 ? m_m2[i] / (m_count - 1) : 0.;
+        }
+        fs[momentsOutput].push_back(feature);
+
+        feature.label = "min";
+        feature.values.assign(m_min.begin(), m_min.end());
+        fs[momentsOutput].push_back(feature);
+
+        feature.label = "max";
+        feature.values.assign(m_max.begin(), m_max.end());
+        fs[momentsOutput].push_back(feature);
+    }
+
+    if (quantilesOutput >= 0 && m_withQuantiles) {
+        feature.values.resize(m_bins);
+        for (size_t q = 0; q < nquantiles; ++q) {
+            feature.label = quantileNames[q];
+            for (size_t i = 0; i < m_bins; ++i) {
+                feature.values[i] =
+                    getQuantile((i * nquantiles + q) * 5, quantiles[q]);
+            }
+            fs[quantilesOutput].push_back(feature);
+        }
+    }
+}
+
+void
+FeatureStats::addOutputDescriptors(Vamp::Plugin::OutputList &list,
+                                   const string &prefix,
+                                   const Vamp::Plugin::OutputDescriptor &frames)
+{
+    Vamp::Plugin::OutputDescriptor d(frames);
+    d.hasKnownExtents = false;
+    d.isQuantized = false;
+    d.sampleType = Vamp::Plugin::OutputDescriptor::VariableSampleRate;
+    d.sampleRate = 0;
+    d.hasDuration = true;
+
+    d.identifier = prefix + "stats";
+    d.name = frames.name + " Statistics";
+    d.description = "Mean, variance, minimum and maximum of each bin over the whole input, one feature per statistic";
+    list.push_back(d);
+
+    d.identifier = prefix + "quantiles";
+    d.name = frames.name + " Quantiles";
+    d.description = "Estimated 10%, 25%, 50%, 75% and 90% quantiles of each bin over the whole input, one feature per quantile";
+    list.push_back(d);
+}
@@ -0,0 +1,100 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _FEATURE_STATS_H_
+#define _FEATURE_STATS_H_
+
+#include <vamp-sdk/Plugin.h>
+#include <aubio/aubio.h>
+#include <vector>
+
+#include "Checkpoint.h"
+
+/** Running summary statistics over a sequence of feature vectors
+
+  Accumulates, for each bin, the mean and variance (Welford's method),
+  the minimum and maximum, and optionally a few quantiles estimated with
+  the P-square algorithm of Jain and Chlamtac, which keeps five markers
+  per quantile instead of the whole history. Memory use is independent
+  of the number of frames added.
+
+  The statistics are returned as two sparse outputs, one feature per
+  statistic labelled with its name, covering the whole input.
+
+*/
+class FeatureStats
+{
+public:
+    FeatureStats();
+
+    /** set the number of bins and clear the statistics */
+    void initialise(size_t bins, bool withQuantiles);
+    /** clear the statistics */
+    void reset();
+
+    /** write or read back the statistics gathered so far */
+    void save(StateWriter &writer) const;
+    void restore(StateReader &reader);
+
+    /** add a frame of bins values, starting at timestamp */
+    void add(const smpl_t *values, const Vamp::RealTime &timestamp);
+
+    size_t getCount() const { return m_count; }
+
+    /** push moments features to fs[momentsOutput] and quantile
+      features to fs[quantilesOutput], ending at endTime; a negative
+      output index skips that output */
+    void getFeatures(Vamp::Plugin::FeatureSet &fs,
+                     int momentsOutput, int quantilesOutput,
+                     const Vamp::RealTime &endTime) const;
+
+    /** append the descriptors of the moments and quantiles outputs,
+      identified by prefix and named after the per-frame output they
+      summarise */
+    static void addOutputDescriptors(Vamp::Plugin::OutputList &list,
+                                     const std::string &prefix,
+                                     const Vamp::Plugin::OutputDescriptor &frames);
+
+protected:
+    size_t m_bins;
+    size_t m_count;
+    bool m_withQuantiles;
+    Vamp::RealTime m_start;
+
+    std::vector<double> m_mean;
+    std::vector<double> m_m2;
+    std::vector<float> m_min;
+    std::vector<float> m_max;
+
+    // P-square markers, 5 per (bin, quantile)
+    std::vector<double> m_heights;
+    std::vector<double> m_desired;
+    std::vector<int> m_positions;
+
+    void addQuantile(size_t marker, double p, double x);
+    double getQuantile(size_t marker, double p) const;
+};
+
+#endif /* _FEATURE_STATS_H_ */
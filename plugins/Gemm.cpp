@@ -0,0 +1,163 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "Gemm.h"
+
+#ifdef HAVE_CBLAS
+#include <cblas.h>
+
+static inline void
+blasGemm(size_t m, size_t n, size_t k, const float *a, size_t lda,
+         const float *b, size_t ldb, float *c, size_t ldc)
+{
+    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, m, n, k,
+                1.f, a, lda, b, ldb, 0.f, c, ldc);
+}
+
+static inline void
+blasGemm(size_t m, size_t n, size_t k, const double *a, size_t lda,
+         const double *b, size_t ldb, double *c, size_t ldc)
+{
+    cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasTrans, m, n, k,
+                1., a, lda, b, ldb, 0., c, ldc);
+}
+
+void
+gemmTransposed(size_t m, size_t n, size_t k,
+               const smpl_t *a, size_t lda,
+               const smpl_t *b, size_t ldb,
+               smpl_t *c, size_t ldc)
+{
+    blasGemm(m, n, k, a, lda, b, ldb, c, ldc);
+}
+
+#else
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+// Results are computed in tiles of 2 rows of A by 4 rows of B, each
+// accumulated over the whole of k so that every value loaded from A is
+// used four times and every value loaded from B twice.
+static const size_t tileRows = 2;
+static const size_t tileCols = 4;
+
+template <typename T>
+static inline void
+tile(size_t k, const T *a, size_t lda, const T *b, size_t ldb, T *c, size_t ldc)
+{
+    T acc[tileRows][tileCols] = { { 0 } };
+    for (size_t p = 0; p < k; ++p) {
+        for (size_t i = 0; i < tileRows; ++i) {
+            T x = a[i * lda + p];
+            for (size_t j = 0; j < tileCols; ++j) {
+                acc[i][j] += x * b[j * ldb + p];
+            }
+        }
+    }
+    for (size_t i = 0; i < tileRows; ++i) {
+        for (size_t j = 0; j < tileCols; ++j) {
+            c[i * ldc + j] = acc[i][j];
+        }
+    }
+}
+
+#ifdef __SSE__
+static inline float
+sum(__m128 v)
+{
+    float part[4];
+    _mm_storeu_ps(part, v);
+    return (part[0] + part[1]) + (part[2] + part[3]);
+}
+
+// single precision tiles, vectorised along k
+static inline void
+tile(size_t k, const float *a, size_t lda, const float *b, size_t ldb,
+     float *c, size_t ldc)
+{
+    const float *a0 = a, *a1 = a + lda;
+    const float *b0 = b, *b1 = b0 + ldb, *b2 = b1 + ldb, *b3 = b2 + ldb;
+    __m128 c00 = _mm_setzero_ps(), c01 = c00, c02 = c00, c03 = c00;
+    __m128 c10 = c00, c11 = c00, c12 = c00, c13 = c00;
+    size_t p = 0;
+    for (; p + 4 <= k; p += 4) {
+        __m128 x0 = _mm_loadu_ps(a0 + p), x1 = _mm_loadu_ps(a1 + p);
+        __m128 y = _mm_loadu_ps(b0 + p);
+        c00 = _mm_add_ps(c00, _mm_mul_ps(x0, y));
+        c10 = _mm_add_ps(c10, _mm_mul_ps(x1, y));
+        y = _mm_loadu_ps(b1 + p);
+        c01 = _mm_add_ps(c01, _mm_mul_ps(x0, y));
+        c11 = _mm_add_ps(c11, _mm_mul_ps(x1, y));
+        y = _mm_loadu_ps(b2 + p);
+        c02 = _mm_add_ps(c02, _mm_mul_ps(x0, y));
+        c12 = _mm_add_ps(c12, _mm_mul_ps(x1, y));
+        y = _mm_loadu_ps(b3 + p);
+        c03 = _mm_add_ps(c03, _mm_mul_ps(x0, y));
+        c13 = _mm_add_ps(c13, _mm_mul_ps(x1, y));
+    }
+    float acc[tileRows][tileCols] = {
+        { sum(c00), sum(c01), sum(c02), sum(c03) },
+        { sum(c10), sum(c11), sum(c12), sum(c13) }
+    };
+    for (; p < k; ++p) {
+        acc[0][0] += a0[p] * b0[p]; acc[0][1] += a0[p] * b1[p];
+        acc[0][2] += a0[p] * b2[p]; acc[0][3] += a0[p] * b3[p];
+        acc[1][0] += a1[p] * b0[p]; acc[1][1] += a1[p] * b1[p];
+        acc[1][2] += a1[p] * b2[p]; acc[1][3] += a1[p] * b3[p];
+    }
+    for (size_t i = 0; i < tileRows; ++i) {
+        for (size_t j = 0; j < tileCols; ++j) {
+            c[i * ldc + j] = acc[i][j];
+        }
+    }
+}
+#endif
+
+void
+gemmTransposed(size_t m, size_t n, size_t k,
+               const smpl_t *a, size_t lda,
+               const smpl_t *b, size_t ldb,
+               smpl_t *c, size_t ldc)
+{
+    size_t mt = m - m % tileRows, nt = n - n % tileCols;
+    for (size_t i = 0; i < mt; i += tileRows) {
+        for (size_t j = 0; j < nt; j += tileCols) {
+            tile(k, a + i * lda, lda, b + j * ldb, ldb, c + i * ldc + j, ldc);
+        }
+    }
+    // remaining rows and columns, one dot product at a time
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t j = (i < mt ? nt : 0); j < n; ++j) {
+            const smpl_t *ai = a + i * lda, *bj = b + j * ldb;
+            smpl_t acc = 0;
+            for (size_t p = 0; p < k; ++p) acc += ai[p] * bj[p];
+            c[i * ldc + j] = acc;
+        }
+    }
+}
+
+#endif
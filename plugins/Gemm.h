@@ -0,0 +1,44 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _GEMM_H_
+#define _GEMM_H_
+
+#include <aubio/aubio.h>
+#include <cstddef>
+
+/** C = A B^T, for row-major A (m rows of k), B (n rows of k) and C (m
+  rows of n), with lda, ldb and ldc the distance between rows
+
+  Uses cblas_sgemm or cblas_dgemm when built with HAVE_CBLAS, and a
+  register-blocked kernel otherwise.
+
+*/
+void gemmTransposed(size_t m, size_t n, size_t k,
+                    const smpl_t *a, size_t lda,
+                    const smpl_t *b, size_t ldb,
+                    smpl_t *c, size_t ldc);
+
+#endif /* _GEMM_H_ */
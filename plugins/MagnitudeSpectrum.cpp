@@ -0,0 +1,71 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "MagnitudeSpectrum.h"
+
+#include <cstring>
+
+MagnitudeSpectrum::MagnitudeSpectrum(size_t blockSize, size_t stepSize) :
+    m_blockSize(blockSize),
+    m_stepSize(stepSize),
+    m_fft(new_aubio_fft(blockSize)),
+    m_window(new_aubio_window(const_cast<char *>("hanningz"), blockSize)),
+    m_frame(new_fvec(blockSize)),
+    m_compspec(new_fvec(blockSize)),
+    m_overlap(blockSize > stepSize ? blockSize - stepSize : 0, 0)
+{
+}
+
+MagnitudeSpectrum::~MagnitudeSpectrum()
+{
+    del_aubio_fft(m_fft);
+    del_fvec(m_window);
+    del_fvec(m_frame);
+    del_fvec(m_compspec);
+}
+
+void
+MagnitudeSpectrum::process(const fvec_t *input, cvec_t *spectrum)
+{
+    // slide, as aubio_pvoc_do(); with hops longer than the window,
+    // only the start of each hop is seen
+    smpl_t *frame = m_frame->data;
+    size_t overlap = m_overlap.size();
+    if (overlap > 0) {
+        memcpy(frame, &m_overlap[0], overlap * sizeof(smpl_t));
+    }
+    memcpy(frame + overlap, input->data,
+           (m_blockSize - overlap) * sizeof(smpl_t));
+    if (overlap > 0) {
+        memcpy(&m_overlap[0], frame + m_blockSize - overlap,
+               overlap * sizeof(smpl_t));
+    }
+
+    fvec_weight(m_frame, m_window);
+    fvec_shift(m_frame);
+
+    aubio_fft_do_complex(m_fft, m_frame, m_compspec);
+    aubio_fft_get_norm(m_compspec, spectrum);
+}
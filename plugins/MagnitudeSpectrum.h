@@ -0,0 +1,67 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _MAGNITUDE_SPECTRUM_H_
+#define _MAGNITUDE_SPECTRUM_H_
+
+#include <aubio/aubio.h>
+#include <vector>
+#include <cstddef>
+
+/** Magnitude spectra of overlapping windows of the input
+
+  Does what aubio_pvoc_do() does to the norm of its output and nothing
+  more: each hop is slid into a window of blockSize samples, weighted
+  by the same Hann window, rotated by half a window and transformed,
+  but only the norms are taken from the FFT, saving the atan2 per bin
+  and hop that computes the phases. The norms are the same as those of
+  aubio_pvoc_do(); the phases of the output are left untouched.
+
+  The constructor and destructor create and delete an aubio FFT, so
+  they must be called with an AubioLock held. */
+class MagnitudeSpectrum
+{
+public:
+    MagnitudeSpectrum(size_t blockSize, size_t stepSize);
+    ~MagnitudeSpectrum();
+
+    /** take the stepSize samples of a hop, and write the norms of the
+      spectrum of the last blockSize samples to spectrum */
+    void process(const fvec_t *input, cvec_t *spectrum);
+
+private:
+    size_t m_blockSize;
+    size_t m_stepSize;
+    aubio_fft_t *m_fft;
+    fvec_t *m_window;
+    fvec_t *m_frame;
+    fvec_t *m_compspec;
+    std::vector<smpl_t> m_overlap;  // last blockSize - stepSize samples
+
+    MagnitudeSpectrum(const MagnitudeSpectrum &);
+    MagnitudeSpectrum &operator=(const MagnitudeSpectrum &);
+};
+
+#endif /* _MAGNITUDE_SPECTRUM_H_ */
@@ -0,0 +1,75 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <math.h>
+
+#include "MelCepstrum.h"
+
+MelCepstrum::MelCepstrum() :
+    m_nfilters(0),
+    m_ncoeffs(0)
+{
+}
+
+void
+MelCepstrum::initialise(size_t nfilters, size_t ncoeffs)
+{
+    m_nfilters = nfilters;
+    m_ncoeffs = ncoeffs;
+
+    // orthonormal DCT-II, scaled as in aubio_mfcc
+    float scaling = 1. / sqrt(m_nfilters / 2.);
+    m_dct.resize(m_ncoeffs * m_nfilters);
+    for (size_t j = 0; j < m_ncoeffs; ++j) {
+        for (size_t i = 0; i < m_nfilters; ++i) {
+            m_dct[j * m_nfilters + i] =
+                scaling * cos(j * (i + 0.5) * M_PI / m_nfilters);
+            if (j == 0) m_dct[i] *= sqrt(2.) / 2.;
+        }
+    }
+}
+
+void
+MelCepstrum::logEnergies(smpl_t *values, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        smpl_t v = values[i];
+        values[i] = log10(v > 1e-37 ? v : 1e-37);
+    }
+}
+
+void
+MelCepstrum::process(smpl_t *bands, smpl_t *out) const
+{
+    logEnergies(bands, m_nfilters);
+    for (size_t j = 0; j < m_ncoeffs; ++j) {
+        const smpl_t *row = &m_dct[j * m_nfilters];
+        smpl_t sum = 0;
+        for (size_t i = 0; i < m_nfilters; ++i) {
+            sum += row[i] * bands[i];
+        }
+        out[j] = sum;
+    }
+}
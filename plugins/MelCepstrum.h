@@ -0,0 +1,68 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _MEL_CEPSTRUM_H_
+#define _MEL_CEPSTRUM_H_
+
+#include <aubio/aubio.h>
+#include <vector>
+#include <cstddef>
+
+/** Cepstrum coefficients of mel band energies
+
+  Takes the log10 of each band energy, floored at 1e-37, and the first
+  coefficients of their orthonormal DCT-II, scaled as in aubio_mfcc.
+  Shared by the plugins computing MFCCs from a MelFilterbank, so that
+  they all return the same coefficients for the same bands.
+
+*/
+class MelCepstrum
+{
+public:
+    MelCepstrum();
+
+    /** compute the DCT of nfilters bands to ncoeffs coefficients */
+    void initialise(size_t nfilters, size_t ncoeffs);
+
+    size_t getFilterCount() const { return m_nfilters; }
+    size_t getCoefficientCount() const { return m_ncoeffs; }
+
+    /** the DCT, as getCoefficientCount() rows of getFilterCount() */
+    const smpl_t *getMatrix() const { return &m_dct[0]; }
+
+    /** replace n band energies by their log */
+    static void logEnergies(smpl_t *values, size_t n);
+
+    /** take the log of the energies in bands, in place, and write the
+      coefficients of their DCT to out */
+    void process(smpl_t *bands, smpl_t *out) const;
+
+protected:
+    size_t m_nfilters;
+    size_t m_ncoeffs;
+    std::vector<smpl_t> m_dct;
+};
+
+#endif /* _MEL_CEPSTRUM_H_ */
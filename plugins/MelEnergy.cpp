@@ -24,6 +24,8 @@
 
 #include <math.h>
 #include "MelEnergy.h"
+#include "AubioLock.h"
+#include "DenormalGuard.h"
 
 using std::string;
 using std::vector;
@@ -33,20 +35,25 @@ using std::endl;
 MelEnergy::MelEnergy(float inputSampleRate) :
     Plugin(inputSampleRate),
     m_ibuf(0),      // input fvec_t, set in initialise
-    m_pvoc(0),      // aubio_pvoc_t, set in reset
+    m_spectrum(0),  // MagnitudeSpectrum, set in reset
     m_ispec(0),     // cvec_t, set in initialise
-    m_melbank(0),   // aubio_filterbank_t, set in reset
     m_ovec(0),      // output fvec_t, set in initialise
     m_nfilters(40), // parameter
+    m_minFreq(MelFilterbank::defaultMinFreq), // parameter
+    m_maxFreq(MelFilterbank::defaultMaxFreq), // parameter
+    m_normalise(true), // parameter
+    m_pyramidLevels(10), // parameter
     m_stepSize(0),  // host parameter
-    m_blockSize(0)  // host parameter
+    m_blockSize(0), // host parameter
+    m_enabledOutputs(1), // parameter
+    m_encoding(1e-6, 100) // parameters
 {
 }
 
 MelEnergy::~MelEnergy()
 {
-    if (m_melbank) del_aubio_filterbank(m_melbank);
-    if (m_pvoc) del_aubio_pvoc(m_pvoc);
+    AubioLock lock;
+    delete m_spectrum;
     if (m_ibuf) del_fvec(m_ibuf);
     if (m_ispec) del_cvec(m_ispec);
     if (m_ovec) del_fvec(m_ovec);
@@ -79,7 +86,7 @@ MelEnergy::getMaker() const
 int
 MelEnergy::getPluginVersion() const
 {
-    return 3;
+    return 5;
 }
 
 string
@@ -96,8 +103,12 @@ MelEnergy::initialise(size_t channels, size_t stepSize, size_t blockSize)
         return false;
     }
 
-    if (m_nfilters != 40) {
-        std::cerr << "MelEnergy::initialise: number of filters must be 40" << std::endl;
+    if (!m_melbank.initialise(m_nfilters, blockSize, m_inputSampleRate,
+                              m_minFreq, m_maxFreq, m_normalise)) {
+        return false;
+    }
+
+    if (!m_encoding.initialise()) {
         return false;
     }
 
@@ -108,6 +119,14 @@ MelEnergy::initialise(size_t channels, size_t stepSize, size_t blockSize)
     m_ispec = new_cvec(blockSize);
     m_ovec = new_fvec(m_nfilters);
 
+    m_stats.initialise(m_nfilters, isOutputEnabled(m_enabledOutputs, 2));
+    m_pyramid.initialise(m_nfilters, m_pyramidLevels,
+                         Vamp::RealTime::frame2RealTime
+                         (stepSize, lrintf(m_inputSampleRate)));
+
+    m_history.initialise(getPvocHistoryHops(stepSize, blockSize),
+                         stepSize);
+
     reset();
 
     return true;
@@ -116,14 +135,15 @@ MelEnergy::initialise(size_t channels, size_t stepSize, size_t blockSize)
 void
 MelEnergy::reset()
 {
-    if (m_pvoc) del_aubio_pvoc(m_pvoc);
-    if (m_melbank) del_aubio_filterbank(m_melbank);
+    AubioLock lock;
+    delete m_spectrum;
 
-    m_pvoc = new_aubio_pvoc(m_blockSize, m_stepSize);
+    m_spectrum = new MagnitudeSpectrum(m_blockSize, m_stepSize);
 
-    m_melbank = new_aubio_filterbank(m_nfilters, m_blockSize);
-    aubio_filterbank_set_mel_coeffs_slaney(m_melbank, lrintf(m_inputSampleRate));
+    m_stats.reset();
+    m_pyramid.reset();
 
+    m_history.reset();
 }
 
 size_t
@@ -146,22 +166,85 @@ MelEnergy::getParameterDescriptors() const
     ParameterDescriptor desc;
     desc.identifier = "nfilters";
     desc.name = "Number of filters";
-    desc.description = "Size of filterbank used to compute mel bands (fixed to 40 for now)";
-    desc.minValue = 40;
-    desc.maxValue = 40;
+    desc.description = "Size of filterbank used to compute mel bands";
+    desc.minValue = 1;
+    desc.maxValue = 256;
     desc.defaultValue = 40;
     desc.isQuantized = true;
     desc.quantizeStep = 1;
     list.push_back(desc);
 
+    desc = ParameterDescriptor();
+    desc.identifier = "minfreq";
+    desc.name = "Lowest Frequency";
+    desc.description = "Lower edge of the first mel band";
+    desc.minValue = 0;
+    desc.maxValue = m_inputSampleRate/2;
+    desc.defaultValue = MelFilterbank::defaultMinFreq;
+    desc.unit = "Hz";
+    desc.isQuantized = false;
+    list.push_back(desc);
+
+    desc = ParameterDescriptor();
+    desc.identifier = "maxfreq";
+    desc.name = "Highest Frequency";
+    desc.description = "Upper edge of the last mel band";
+    desc.minValue = 0;
+    desc.maxValue = m_inputSampleRate/2;
+    desc.defaultValue = MelFilterbank::defaultMaxFreq;
+    desc.unit = "Hz";
+    desc.isQuantized = false;
+    list.push_back(desc);
+
+    desc = ParameterDescriptor();
+    desc.identifier = "melnorm";
+    desc.name = "Filter normalisation";
+    desc.description = "Scale each filter to unit area, as in the Slaney filterbank, or to unit peak";
+    desc.minValue = 0;
+    desc.maxValue = 1;
+    desc.defaultValue = 1;
+    desc.isQuantized = true;
+    desc.quantizeStep = 1;
+    desc.valueNames.push_back("Unit Peak");
+    desc.valueNames.push_back("Unit Area");
+    list.push_back(desc);
+
+    desc = ParameterDescriptor();
+    desc.identifier = "pyramidlevels";
+    desc.name = "Number of pyramid levels";
+    desc.description = "Number of levels of the mean and maximum pyramids, level k decimating by 2^k";
+    desc.minValue = 1;
+    desc.maxValue = 10;
+    desc.defaultValue = 10;
+    desc.isQuantized = true;
+    desc.quantizeStep = 1;
+    list.push_back(desc);
+
+    m_encoding.addParameterDescriptors(list);
+
+    list.push_back(getEnabledOutputsDescriptor(getOutputDescriptors(), 1));
+
     return list;
 }
 
 float
 MelEnergy::getParameter(std::string param) const
 {
-    if (param == "nfilters") {
+    float value = 0.0;
+    if (m_encoding.getParameter(param, value)) {
+        return value;
+    } else if (param == "nfilters") {
         return m_nfilters;
+    } else if (param == "minfreq") {
+        return m_minFreq;
+    } else if (param == "maxfreq") {
+        return m_maxFreq;
+    } else if (param == "melnorm") {
+        return m_normalise ? 1.0 : 0.0;
+    } else if (param == "pyramidlevels") {
+        return m_pyramidLevels;
+    } else if (param == "enabledoutputs") {
+        return m_enabledOutputs;
     } else {
         return 0.0;
     }
@@ -170,8 +253,21 @@ MelEnergy::getParameter(std::string param) const
 void
 MelEnergy::setParameter(std::string param, float value)
 {
-    if (param == "nfilters") {
+    if (m_encoding.setParameter(param, value)) {
+        return;
+    } else if (param == "nfilters") {
         m_nfilters = lrintf(value);
+    } else if (param == "minfreq") {
+        m_minFreq = value;
+    } else if (param == "maxfreq") {
+        m_maxFreq = value;
+    } else if (param == "melnorm") {
+        m_normalise = (value > 0.5);
+    } else if (param == "pyramidlevels") {
+        m_pyramidLevels = lrintf(value);
+    } else if (param == "enabledoutputs") {
+        m_enabledOutputs = getEnabledOutputsMask
+            (value, getOutputDescriptors().size());
     }
 }
 
@@ -192,13 +288,29 @@ MelEnergy::getOutputDescriptors() const
     d.sampleType = OutputDescriptor::OneSamplePerStep;
     list.push_back(d);
 
+    FeatureStats::addOutputDescriptors(list, "melenergy", d);
+    FeaturePyramid::addOutputDescriptors(list, "melenergy", d);
+
+    // only the per-frame output is encoded
+    m_encoding.adaptOutputDescriptor(list[0]);
+
     return list;
 }
 
 MelEnergy::FeatureSet
-MelEnergy::process(const float *const *inputBuffers,
-               UNUSED Vamp::RealTime timestamp)
+MelEnergy::process(const float *const *inputBuffers, Vamp::RealTime timestamp)
 {
+    for (size_t i = 0; i < m_stepSize; ++i) {
+        fvec_set_sample(m_ibuf, inputBuffers[0][i], i);
+    }
+    return processInput(m_ibuf, timestamp);
+}
+
+MelEnergy::FeatureSet
+MelEnergy::processInput(const fvec_t *input, Vamp::RealTime timestamp)
+{
+    DenormalGuard guard;
+
     FeatureSet returnFeatures;
 
     if (m_stepSize == 0) {
@@ -210,26 +322,98 @@ MelEnergy::process(const float *const *inputBuffers,
         return returnFeatures;
     }
 
-    for (size_t i = 0; i < m_stepSize; ++i) {
-        fvec_set_sample(m_ibuf, inputBuffers[0][i], i);
+    m_history.push(input);
+
+    m_spectrum->process(input, m_ispec);
+    m_melbank.process(m_ispec, m_ovec);
+
+    if (isOutputEnabled(m_enabledOutputs, 0)) {
+        Feature feature;
+        for (uint_t i = 0; i < m_ovec->length; i++) {
+            float value = m_ovec->data[i];
+            feature.values.push_back(m_encoding.encode(value));
+        }
+        returnFeatures[0].push_back(feature);
     }
 
-    aubio_pvoc_do(m_pvoc, m_ibuf, m_ispec);
-    aubio_filterbank_do(m_melbank, m_ispec, m_ovec);
+    if (isOutputEnabled(m_enabledOutputs, 1) ||
+        isOutputEnabled(m_enabledOutputs, 2)) {
+        m_stats.add(m_ovec->data, timestamp);
+    }
 
-    Feature feature;
-    for (uint_t i = 0; i < m_ovec->length; i++) {
-        float value = m_ovec->data[i];
-        feature.values.push_back(value);
+    if (isOutputEnabled(m_enabledOutputs, 3) ||
+        isOutputEnabled(m_enabledOutputs, 4)) {
+        m_pyramid.add(m_ovec->data, timestamp, returnFeatures,
+                      isOutputEnabled(m_enabledOutputs, 3) ? 3 : -1,
+                      isOutputEnabled(m_enabledOutputs, 4) ? 4 : -1);
     }
 
-    returnFeatures[0].push_back(feature);
+    m_lastTimestamp = timestamp;
     return returnFeatures;
 }
 
 MelEnergy::FeatureSet
 MelEnergy::getRemainingFeatures()
 {
-    return FeatureSet();
+    FeatureSet returnFeatures;
+    m_stats.getFeatures(returnFeatures,
+                        isOutputEnabled(m_enabledOutputs, 1) ? 1 : -1,
+                        isOutputEnabled(m_enabledOutputs, 2) ? 2 : -1,
+                        m_lastTimestamp + Vamp::RealTime::frame2RealTime
+                        (m_stepSize, lrintf(m_inputSampleRate)));
+    m_pyramid.flush(returnFeatures,
+                    isOutputEnabled(m_enabledOutputs, 3) ? 3 : -1,
+                    isOutputEnabled(m_enabledOutputs, 4) ? 4 : -1);
+    return returnFeatures;
 }
 
+string
+MelEnergy::saveState() const
+{
+    StateWriter writer;
+    writeStateHeader(writer, *this, m_inputSampleRate, m_stepSize, m_blockSize);
+    m_history.save(writer);
+    m_stats.save(writer);
+    m_pyramid.save(writer);
+    writer.putRealTime(m_lastTimestamp);
+    return writer.getData();
+}
+
+bool
+MelEnergy::restoreState(const string &state)
+{
+    if (!m_ibuf) {
+        cerr << "MelEnergy::restoreState: MelEnergy plugin not initialised" << endl;
+        return false;
+    }
+
+    reset();
+
+    StateReader reader(state);
+    if (!readStateHeader(reader, *this, m_inputSampleRate,
+                         m_stepSize, m_blockSize)) {
+        return false;
+    }
+
+    InputHistory history(m_history);
+    history.restore(reader);
+    if (!reader.isOK()) {
+        cerr << "MelEnergy::restoreState: invalid state" << endl;
+        return false;
+    }
+
+    history.replay(*this, m_blockSize, m_inputSampleRate);
+    m_history = history;
+
+    m_stats.restore(reader);
+    m_pyramid.restore(reader);
+    m_lastTimestamp = reader.getRealTime();
+
+    if (!reader.isAtEnd()) {
+        cerr << "MelEnergy::restoreState: invalid state" << endl;
+        reset();
+        return false;
+    }
+
+    return true;
+}
@@ -29,8 +29,15 @@
 #include <aubio/aubio.h>
 
 #include "Types.h"
-
-class MelEnergy : public Vamp::Plugin
+#include "Checkpoint.h"
+#include "PcmInput.h"
+#include "FeatureStats.h"
+#include "FeaturePyramid.h"
+#include "MelFilterbank.h"
+#include "FeatureEncoding.h"
+#include "MagnitudeSpectrum.h"
+
+class MelEnergy : public Vamp::Plugin, public Checkpointable, public PcmInput
 {
 public:
     MelEnergy(float inputSampleRate);
@@ -59,20 +66,37 @@ public:
 
     FeatureSet process(const float *const *inputBuffers,
                        Vamp::RealTime timestamp);
+    FeatureSet processInput(const fvec_t *input, Vamp::RealTime timestamp);
 
     FeatureSet getRemainingFeatures();
 
+    std::string saveState() const;
+    bool restoreState(const std::string &state);
+
 protected:
     fvec_t *m_ibuf;
-    aubio_pvoc_t *m_pvoc;
+    MagnitudeSpectrum *m_spectrum;
     cvec_t *m_ispec;
-    aubio_filterbank_t *m_melbank;
+    MelFilterbank m_melbank;
     fvec_t *m_ovec;
 
     size_t m_nfilters;
+    float m_minFreq;
+    float m_maxFreq;
+    bool m_normalise;
+    size_t m_pyramidLevels;
 
     size_t m_stepSize;
     size_t m_blockSize;
+
+    // input kept for rebuilding the aubio objects in restoreState()
+    InputHistory m_history;
+
+    unsigned int m_enabledOutputs;
+    FeatureStats m_stats;
+    FeaturePyramid m_pyramid;
+    Vamp::RealTime m_lastTimestamp;
+    FeatureEncoding m_encoding;
 };
 
 
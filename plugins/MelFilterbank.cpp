@@ -0,0 +1,178 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <math.h>
+#include <iostream>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "MelFilterbank.h"
+
+using std::vector;
+
+const float MelFilterbank::defaultMinFreq = 400.f / 3.f;
+const float MelFilterbank::defaultMaxFreq = 6855.49f;
+
+// Slaney mel scale: 200/3Hz per mel up to 1kHz (15 mels), then
+// logarithmic with 27 mels per factor of 6.4
+static const float linearStep = 200.f / 3.f;
+static const float logStart = 1000.f;
+static const float logStartMel = 15.f;
+static const float logStep = 0.068751777f; // log(6.4) / 27
+
+float
+MelFilterbank::hzToMel(float hz)
+{
+    if (hz < logStart) return hz / linearStep;
+    return logStartMel + logf(hz / logStart) / logStep;
+}
+
+float
+MelFilterbank::melToHz(float mel)
+{
+    if (mel < logStartMel) return mel * linearStep;
+    return logStart * expf((mel - logStartMel) * logStep);
+}
+
+MelFilterbank::MelFilterbank()
+{
+}
+
+bool
+MelFilterbank::initialise(size_t nfilters, size_t blockSize, float sampleRate,
+                          float minFreq, float maxFreq, bool normalise)
+{
+    if (nfilters == 0 || blockSize == 0) {
+        std::cerr << "MelFilterbank::initialise: no filters or empty blocks" << std::endl;
+        return false;
+    }
+    if (minFreq < 0 || maxFreq <= minFreq) {
+        std::cerr << "MelFilterbank::initialise: invalid frequency range "
+                  << minFreq << " to " << maxFreq << std::endl;
+        return false;
+    }
+
+    m_start.clear();
+    m_length.clear();
+    m_offset.clear();
+    m_weights.clear();
+
+    // nfilters + 2 edge frequencies, equally spaced in mels
+    vector<float> edges(nfilters + 2);
+    float minMel = hzToMel(minFreq);
+    float maxMel = hzToMel(maxFreq);
+    for (size_t i = 0; i < nfilters + 2; ++i) {
+        edges[i] = melToHz(minMel + (maxMel - minMel) * i / (nfilters + 1));
+    }
+
+    size_t bins = blockSize / 2 + 1;
+    float binWidth = sampleRate / blockSize;
+
+    for (size_t b = 0; b < nfilters; ++b) {
+
+        float lower = edges[b], centre = edges[b+1], upper = edges[b+2];
+        float height = normalise ? 2.f / (upper - lower) : 1.f;
+
+        size_t start = (size_t)floorf(lower / binWidth) + 1;
+        size_t end = (size_t)ceilf(upper / binWidth);
+        if (end > bins) end = bins;
+        if (start > end) start = end;
+
+        m_start.push_back(start);
+        m_length.push_back(end - start);
+        m_offset.push_back(m_weights.size());
+
+        for (size_t i = start; i < end; ++i) {
+            float f = i * binWidth;
+            float w = 0.f;
+            if (f > lower && f <= centre) {
+                w = height * (f - lower) / (centre - lower);
+            } else if (f > centre && f < upper) {
+                w = height * (upper - f) / (upper - centre);
+            }
+            m_weights.push_back(w);
+        }
+    }
+
+    return true;
+}
+
+static inline float
+dot(const float *w, const float *x, size_t n)
+{
+    size_t i = 0;
+    float sum = 0.f;
+#ifdef __SSE__
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(w + i),
+                                           _mm_loadu_ps(x + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(w + i + 4),
+                                           _mm_loadu_ps(x + i + 4)));
+    }
+    acc0 = _mm_add_ps(acc0, acc1);
+    float part[4];
+    _mm_storeu_ps(part, acc0);
+    sum = (part[0] + part[1]) + (part[2] + part[3]);
+#endif
+    for (; i < n; ++i) sum += w[i] * x[i];
+    return sum;
+}
+
+static inline double
+dot(const double *w, const double *x, size_t n)
+{
+    double sum = 0.;
+    for (size_t i = 0; i < n; ++i) sum += w[i] * x[i];
+    return sum;
+}
+
+void
+MelFilterbank::process(const cvec_t *spectrum, fvec_t *out) const
+{
+    const smpl_t *norm = spectrum->norm;
+    size_t n = m_start.size();
+    for (size_t b = 0; b < n; ++b) {
+        out->data[b] = dot(&m_weights[m_offset[b]], norm + m_start[b],
+                           m_length[b]);
+    }
+}
+
+void
+MelFilterbank::processBatch(const smpl_t *spectra, size_t stride,
+                            size_t frames, smpl_t *out) const
+{
+    size_t n = m_start.size();
+    for (size_t f = 0; f < frames; ++f) {
+        const smpl_t *norm = spectra + f * stride;
+        for (size_t b = 0; b < n; ++b) {
+            out[f * n + b] = dot(&m_weights[m_offset[b]], norm + m_start[b],
+                                 m_length[b]);
+        }
+    }
+}
@@ -0,0 +1,87 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _MEL_FILTERBANK_H_
+#define _MEL_FILTERBANK_H_
+
+#include <aubio/aubio.h>
+#include <vector>
+#include <cstddef>
+
+/** Triangular mel filterbank stored as sparse bands
+
+  The filters are equally spaced on the Slaney mel scale (linear below
+  1kHz, logarithmic above) between a minimum and a maximum frequency,
+  each filter spanning its two neighbours' centres. The defaults of
+  133.33Hz to 6855.5Hz with 40 filters match the bands of
+  aubio_filterbank_set_mel_coeffs_slaney to within a fraction of a
+  percent.
+
+  Each band only keeps the weights of the spectrum bins it covers,
+  so applying the filterbank costs one short dot product per band
+  instead of a full row of mostly zero coefficients.
+
+*/
+class MelFilterbank
+{
+public:
+    MelFilterbank();
+
+    static const float defaultMinFreq;
+    static const float defaultMaxFreq;
+
+    /** compute the bands of nfilters filters for spectra of blockSize
+      points at sampleRate; with normalise, each filter has unit area
+      as in the Slaney filterbank, otherwise a unit peak */
+    bool initialise(size_t nfilters, size_t blockSize, float sampleRate,
+                    float minFreq, float maxFreq, bool normalise);
+
+    size_t getFilterCount() const { return m_start.size(); }
+
+    /** first spectrum bin, number of bins and weights of band b */
+    size_t getStart(size_t b) const { return m_start[b]; }
+    size_t getLength(size_t b) const { return m_length[b]; }
+    const smpl_t *getWeights(size_t b) const { return &m_weights[m_offset[b]]; }
+
+    /** apply the filterbank to the norm of spectrum, writing one energy
+      per filter to out */
+    void process(const cvec_t *spectrum, fvec_t *out) const;
+
+    /** apply the filterbank to frames norm spectra stored in rows of
+      stride values, writing frames rows of energies to out */
+    void processBatch(const smpl_t *spectra, size_t stride, size_t frames,
+                      smpl_t *out) const;
+
+    static float hzToMel(float hz);
+    static float melToHz(float mel);
+
+protected:
+    std::vector<size_t> m_start;
+    std::vector<size_t> m_length;
+    std::vector<size_t> m_offset;
+    std::vector<smpl_t> m_weights;
+};
+
+#endif /* _MEL_FILTERBANK_H_ */
@@ -24,6 +24,9 @@
 
 #include <math.h>
 #include "Mfcc.h"
+#include "AubioLock.h"
+#include "DenormalGuard.h"
+#include "Gemm.h"
 
 using std::string;
 using std::vector;
@@ -33,23 +36,32 @@ using std::endl;
 Mfcc::Mfcc(float inputSampleRate) :
     Plugin(inputSampleRate),
     m_ibuf(0),      // input fvec_t, set in initialise
-    m_pvoc(0),      // aubio_pvoc_t, set in reset
+    m_spectrum(0),  // MagnitudeSpectrum, set in reset
     m_ispec(0),     // cvec_t, set in initialise
-    m_mfcc(0),      // aubio_mfcc_t, set in reset
+    m_bands(0),     // filterbank output fvec_t, set in initialise
     m_ovec(0),      // output fvec_t, set in initialise
     m_nfilters(40), // parameter
+    m_minFreq(MelFilterbank::defaultMinFreq), // parameter
+    m_maxFreq(MelFilterbank::defaultMaxFreq), // parameter
+    m_normalise(true), // parameter
     m_ncoeffs(13),  // parameter
+    m_deltaWidth(2), // parameter
+    m_batchSize(1), // parameter
+    m_batchCount(0),
     m_stepSize(0),  // host parameter
-    m_blockSize(0)  // host parameter
+    m_blockSize(0), // host parameter
+    m_enabledOutputs(1), // parameter
+    m_encoding(-100, 100) // parameters
 {
 }
 
 Mfcc::~Mfcc()
 {
-    if (m_mfcc) del_aubio_mfcc(m_mfcc);
-    if (m_pvoc) del_aubio_pvoc(m_pvoc);
+    AubioLock lock;
+    delete m_spectrum;
     if (m_ibuf) del_fvec(m_ibuf);
     if (m_ispec) del_cvec(m_ispec);
+    if (m_bands) del_fvec(m_bands);
     if (m_ovec) del_fvec(m_ovec);
 }
 
@@ -80,7 +92,7 @@ Mfcc::getMaker() const
 int
 Mfcc::getPluginVersion() const
 {
-    return 3;
+    return 5;
 }
 
 string
@@ -97,13 +109,43 @@ Mfcc::initialise(size_t channels, size_t stepSize, size_t blockSize)
         return false;
     }
 
+    if (m_ncoeffs > m_nfilters) {
+        std::cerr << "Mfcc::initialise: number of coefficients must not exceed number of filters" << std::endl;
+        return false;
+    }
+
+    if (!m_melbank.initialise(m_nfilters, blockSize, m_inputSampleRate,
+                              m_minFreq, m_maxFreq, m_normalise)) {
+        return false;
+    }
+
+    if (!m_encoding.initialise()) {
+        return false;
+    }
+
     m_stepSize = stepSize;
     m_blockSize = blockSize;
 
     m_ibuf = new_fvec(stepSize);
     m_ispec = new_cvec(blockSize);
+    m_bands = new_fvec(m_nfilters);
     m_ovec = new_fvec(m_ncoeffs);
 
+    m_cepstrum.initialise(m_nfilters, m_ncoeffs);
+
+    if (m_batchSize > 1) {
+        m_batchSpectra.assign(m_batchSize * (blockSize / 2 + 1), 0);
+        m_batchBands.assign(m_batchSize * m_nfilters, 0);
+        m_batchCoeffs.assign(m_batchSize * m_ncoeffs, 0);
+        m_batchTimes.assign(m_batchSize, Vamp::RealTime::zeroTime);
+    }
+
+    m_stats.initialise(m_ncoeffs, isOutputEnabled(m_enabledOutputs, 2));
+    m_deltas.initialise(m_ncoeffs, m_deltaWidth);
+
+    m_history.initialise(getPvocHistoryHops(stepSize, blockSize),
+                         stepSize);
+
     reset();
 
     return true;
@@ -112,14 +154,16 @@ Mfcc::initialise(size_t channels, size_t stepSize, size_t blockSize)
 void
 Mfcc::reset()
 {
-    if (m_pvoc) del_aubio_pvoc(m_pvoc);
-    if (m_mfcc) del_aubio_mfcc(m_mfcc);
+    AubioLock lock;
+    delete m_spectrum;
 
-    m_pvoc = new_aubio_pvoc(m_blockSize, m_stepSize);
+    m_spectrum = new MagnitudeSpectrum(m_blockSize, m_stepSize);
 
-    m_mfcc = new_aubio_mfcc(m_blockSize, m_nfilters, m_ncoeffs,
-            lrintf(m_inputSampleRate));
+    m_batchCount = 0;
+    m_stats.reset();
+    m_deltas.reset();
 
+    m_history.reset();
 }
 
 size_t
@@ -142,14 +186,49 @@ Mfcc::getParameterDescriptors() const
     ParameterDescriptor desc;
     desc.identifier = "nfilters";
     desc.name = "Number of filters";
-    desc.description = "Size of mel filterbank used to compute MFCCs (fixed to 40 for now)";
-    desc.minValue = 40;
-    desc.maxValue = 40;
+    desc.description = "Size of mel filterbank used to compute MFCCs";
+    desc.minValue = 1;
+    desc.maxValue = 256;
     desc.defaultValue = 40;
     desc.isQuantized = true;
     desc.quantizeStep = 1;
     list.push_back(desc);
 
+    desc = ParameterDescriptor();
+    desc.identifier = "minfreq";
+    desc.name = "Lowest Frequency";
+    desc.description = "Lower edge of the first mel band";
+    desc.minValue = 0;
+    desc.maxValue = m_inputSampleRate/2;
+    desc.defaultValue = MelFilterbank::defaultMinFreq;
+    desc.unit = "Hz";
+    desc.isQuantized = false;
+    list.push_back(desc);
+
+    desc = ParameterDescriptor();
+    desc.identifier = "maxfreq";
+    desc.name = "Highest Frequency";
+    desc.description = "Upper edge of the last mel band";
+    desc.minValue = 0;
+    desc.maxValue = m_inputSampleRate/2;
+    desc.defaultValue = MelFilterbank::defaultMaxFreq;
+    desc.unit = "Hz";
+    desc.isQuantized = false;
+    list.push_back(desc);
+
+    desc = ParameterDescriptor();
+    desc.identifier = "melnorm";
+    desc.name = "Filter normalisation";
+    desc.description = "Scale each filter to unit area, as in the Slaney filterbank, or to unit peak";
+    desc.minValue = 0;
+    desc.maxValue = 1;
+    desc.defaultValue = 1;
+    desc.isQuantized = true;
+    desc.quantizeStep = 1;
+    desc.valueNames.push_back("Unit Peak");
+    desc.valueNames.push_back("Unit Area");
+    list.push_back(desc);
+
     desc = ParameterDescriptor();
     desc.identifier = "ncoeffs";
     desc.name = "Number of coefficients";
@@ -161,16 +240,57 @@ Mfcc::getParameterDescriptors() const
     desc.quantizeStep = 1;
     list.push_back(desc);
 
+    desc = ParameterDescriptor();
+    desc.identifier = "deltawindow";
+    desc.name = "Delta regression window";
+    desc.description = "Half-width of the regression window of the delta outputs, in frames";
+    desc.minValue = 1;
+    desc.maxValue = 10;
+    desc.defaultValue = 2;
+    desc.isQuantized = true;
+    desc.quantizeStep = 1;
+    list.push_back(desc);
+
+    desc = ParameterDescriptor();
+    desc.identifier = "batchsize";
+    desc.name = "Batch size";
+    desc.description = "Number of frames gathered before computing their DCTs as one matrix product, or 1 to compute each frame as it comes";
+    desc.minValue = 1;
+    desc.maxValue = 1024;
+    desc.defaultValue = 1;
+    desc.isQuantized = true;
+    desc.quantizeStep = 1;
+    list.push_back(desc);
+
+    m_encoding.addParameterDescriptors(list);
+
+    list.push_back(getEnabledOutputsDescriptor(getOutputDescriptors(), 1));
+
     return list;
 }
 
 float
 Mfcc::getParameter(std::string param) const
 {
-    if (param == "ncoeffs") {
+    float value = 0.0;
+    if (m_encoding.getParameter(param, value)) {
+        return value;
+    } else if (param == "ncoeffs") {
         return m_ncoeffs;
     } else if (param == "nfilters") {
         return m_nfilters;
+    } else if (param == "minfreq") {
+        return m_minFreq;
+    } else if (param == "maxfreq") {
+        return m_maxFreq;
+    } else if (param == "melnorm") {
+        return m_normalise ? 1.0 : 0.0;
+    } else if (param == "deltawindow") {
+        return m_deltaWidth;
+    } else if (param == "batchsize") {
+        return m_batchSize;
+    } else if (param == "enabledoutputs") {
+        return m_enabledOutputs;
     } else {
         return 0.0;
     }
@@ -179,10 +299,25 @@ Mfcc::getParameter(std::string param) const
 void
 Mfcc::setParameter(std::string param, float value)
 {
-    if (param == "nfilters") {
+    if (m_encoding.setParameter(param, value)) {
+        return;
+    } else if (param == "nfilters") {
         m_nfilters = lrintf(value);
+    } else if (param == "minfreq") {
+        m_minFreq = value;
+    } else if (param == "maxfreq") {
+        m_maxFreq = value;
+    } else if (param == "melnorm") {
+        m_normalise = (value > 0.5);
     } else if (param == "ncoeffs") {
         m_ncoeffs = lrintf(value);
+    } else if (param == "deltawindow") {
+        m_deltaWidth = lrintf(value);
+    } else if (param == "batchsize") {
+        m_batchSize = lrintf(value);
+    } else if (param == "enabledoutputs") {
+        m_enabledOutputs = getEnabledOutputsMask
+            (value, getOutputDescriptors().size());
     }
 }
 
@@ -201,15 +336,40 @@ Mfcc::getOutputDescriptors() const
     d.isQuantized = true;
     d.quantizeStep = 1.0;
     d.sampleType = OutputDescriptor::OneSamplePerStep;
+
+    float frameRate = m_stepSize ? m_inputSampleRate / m_stepSize :
+        m_inputSampleRate / getPreferredStepSize();
+
+    // batched frames come out late, with their own timestamps
+    if (m_batchSize > 1) {
+        d.sampleType = OutputDescriptor::FixedSampleRate;
+        d.sampleRate = frameRate;
+    }
     list.push_back(d);
 
+    FeatureStats::addOutputDescriptors(list, "mfcc", d);
+    FeatureDeltas::addOutputDescriptors(list, "mfcc", d, frameRate);
+
+    // only the per-frame output is encoded
+    m_encoding.adaptOutputDescriptor(list[0]);
+
     return list;
 }
 
 Mfcc::FeatureSet
-Mfcc::process(const float *const *inputBuffers,
-               UNUSED Vamp::RealTime timestamp)
+Mfcc::process(const float *const *inputBuffers, Vamp::RealTime timestamp)
+{
+    for (size_t i = 0; i < m_stepSize; ++i) {
+        fvec_set_sample(m_ibuf, inputBuffers[0][i], i);
+    }
+    return processInput(m_ibuf, timestamp);
+}
+
+Mfcc::FeatureSet
+Mfcc::processInput(const fvec_t *input, Vamp::RealTime timestamp)
 {
+    DenormalGuard guard;
+
     FeatureSet returnFeatures;
 
     if (m_stepSize == 0) {
@@ -221,26 +381,148 @@ Mfcc::process(const float *const *inputBuffers,
         return returnFeatures;
     }
 
-    for (size_t i = 0; i < m_stepSize; ++i) {
-        fvec_set_sample(m_ibuf, inputBuffers[0][i], i);
-    }
+    m_history.push(input);
 
-    aubio_pvoc_do(m_pvoc, m_ibuf, m_ispec);
-    aubio_mfcc_do(m_mfcc, m_ispec, m_ovec);
+    m_spectrum->process(input, m_ispec);
 
-    Feature feature;
-    for (uint_t i = 0; i < m_ovec->length; i++) {
-        float value = m_ovec->data[i];
-        feature.values.push_back(value);
+    if (m_batchSize > 1) {
+        size_t bins = m_ispec->length;
+        smpl_t *row = &m_batchSpectra[m_batchCount * bins];
+        for (size_t i = 0; i < bins; ++i) row[i] = m_ispec->norm[i];
+        m_batchTimes[m_batchCount] = timestamp;
+        if (++m_batchCount == m_batchSize) processBatch(returnFeatures);
+    } else {
+        m_melbank.process(m_ispec, m_bands);
+        m_cepstrum.process(m_bands->data, m_ovec->data);
+        pushFrame(m_ovec->data, timestamp, returnFeatures);
     }
 
-    returnFeatures[0].push_back(feature);
+    m_lastTimestamp = timestamp;
     return returnFeatures;
 }
 
+void
+Mfcc::pushFrame(const smpl_t *coeffs, const Vamp::RealTime &timestamp,
+                FeatureSet &fs)
+{
+    if (isOutputEnabled(m_enabledOutputs, 0)) {
+        Feature feature;
+        if (m_batchSize > 1) {
+            feature.hasTimestamp = true;
+            feature.timestamp = timestamp;
+        }
+        for (size_t i = 0; i < m_ncoeffs; i++) {
+            float value = coeffs[i];
+            feature.values.push_back(m_encoding.encode(value));
+        }
+        fs[0].push_back(feature);
+    }
+
+    if (isOutputEnabled(m_enabledOutputs, 1) ||
+        isOutputEnabled(m_enabledOutputs, 2)) {
+        m_stats.add(coeffs, timestamp);
+    }
+
+    if (isOutputEnabled(m_enabledOutputs, 3) ||
+        isOutputEnabled(m_enabledOutputs, 4)) {
+        m_deltas.add(coeffs, timestamp, fs,
+                     isOutputEnabled(m_enabledOutputs, 3) ? 3 : -1,
+                     isOutputEnabled(m_enabledOutputs, 4) ? 4 : -1);
+    }
+}
+
+void
+Mfcc::processBatch(FeatureSet &fs)
+{
+    if (m_batchCount == 0) return;
+
+    m_melbank.processBatch(&m_batchSpectra[0], m_ispec->length,
+                           m_batchCount, &m_batchBands[0]);
+    MelCepstrum::logEnergies(&m_batchBands[0], m_batchCount * m_nfilters);
+    gemmTransposed(m_batchCount, m_ncoeffs, m_nfilters,
+                   &m_batchBands[0], m_nfilters,
+                   m_cepstrum.getMatrix(), m_nfilters,
+                   &m_batchCoeffs[0], m_ncoeffs);
+
+    for (size_t f = 0; f < m_batchCount; ++f) {
+        pushFrame(&m_batchCoeffs[f * m_ncoeffs], m_batchTimes[f], fs);
+    }
+    m_batchCount = 0;
+}
+
 Mfcc::FeatureSet
 Mfcc::getRemainingFeatures()
 {
-    return FeatureSet();
+    DenormalGuard guard;
+
+    FeatureSet returnFeatures;
+    processBatch(returnFeatures);
+    m_stats.getFeatures(returnFeatures,
+                        isOutputEnabled(m_enabledOutputs, 1) ? 1 : -1,
+                        isOutputEnabled(m_enabledOutputs, 2) ? 2 : -1,
+                        m_lastTimestamp + Vamp::RealTime::frame2RealTime
+                        (m_stepSize, lrintf(m_inputSampleRate)));
+    m_deltas.flush(returnFeatures,
+                   isOutputEnabled(m_enabledOutputs, 3) ? 3 : -1,
+                   isOutputEnabled(m_enabledOutputs, 4) ? 4 : -1);
+    return returnFeatures;
+}
+
+string
+Mfcc::saveState() const
+{
+    StateWriter writer;
+    writeStateHeader(writer, *this, m_inputSampleRate, m_stepSize, m_blockSize);
+    m_history.save(writer);
+    writer.putSize(m_batchCount);
+    writer.putSamples(m_batchSpectra.empty() ? 0 : &m_batchSpectra[0],
+                      m_batchSpectra.size());
+    writer.putRealTimes(m_batchTimes);
+    m_stats.save(writer);
+    m_deltas.save(writer);
+    writer.putRealTime(m_lastTimestamp);
+    return writer.getData();
 }
 
+bool
+Mfcc::restoreState(const string &state)
+{
+    if (!m_ibuf) {
+        cerr << "Mfcc::restoreState: Mfcc plugin not initialised" << endl;
+        return false;
+    }
+
+    reset();
+
+    StateReader reader(state);
+    if (!readStateHeader(reader, *this, m_inputSampleRate,
+                         m_stepSize, m_blockSize)) {
+        return false;
+    }
+
+    InputHistory history(m_history);
+    history.restore(reader);
+    if (!reader.isOK()) {
+        cerr << "Mfcc::restoreState: invalid state" << endl;
+        return false;
+    }
+
+    history.replay(*this, m_blockSize, m_inputSampleRate);
+    m_history = history;
+
+    m_batchCount = reader.getCount(m_batchTimes.size());
+    reader.getSamples(m_batchSpectra.empty() ? 0 : &m_batchSpectra[0],
+                      m_batchSpectra.size());
+    reader.getRealTimes(m_batchTimes, m_batchTimes.size());
+    m_stats.restore(reader);
+    m_deltas.restore(reader);
+    m_lastTimestamp = reader.getRealTime();
+
+    if (!reader.isAtEnd()) {
+        cerr << "Mfcc::restoreState: invalid state" << endl;
+        reset();
+        return false;
+    }
+
+    return true;
+}
@@ -29,8 +29,18 @@
 #include <aubio/aubio.h>
 
 #include "Types.h"
-
-class Mfcc : public Vamp::Plugin
+#include "Checkpoint.h"
+#include "PcmInput.h"
+#include "FeatureStats.h"
+#include "FeatureDeltas.h"
+#include "MelFilterbank.h"
+#include "MelCepstrum.h"
+#include "FeatureEncoding.h"
+#include "MagnitudeSpectrum.h"
+
+#include <vector>
+
+class Mfcc : public Vamp::Plugin, public Checkpointable, public PcmInput
 {
 public:
     Mfcc(float inputSampleRate);
@@ -59,22 +69,54 @@ public:
 
     FeatureSet process(const float *const *inputBuffers,
                        Vamp::RealTime timestamp);
+    FeatureSet processInput(const fvec_t *input, Vamp::RealTime timestamp);
 
     FeatureSet getRemainingFeatures();
 
+    std::string saveState() const;
+    bool restoreState(const std::string &state);
+
 protected:
     fvec_t *m_ibuf;
-    aubio_pvoc_t *m_pvoc;
+    MagnitudeSpectrum *m_spectrum;
     cvec_t *m_ispec;
-    aubio_mfcc_t *m_mfcc;
+    MelFilterbank m_melbank;
+    fvec_t *m_bands;
+    MelCepstrum m_cepstrum;
     fvec_t *m_ovec;
 
     size_t m_nfilters;
+    float m_minFreq;
+    float m_maxFreq;
+    bool m_normalise;
     size_t m_ncoeffs;
+    size_t m_deltaWidth;
+
+    size_t m_batchSize;
+    size_t m_batchCount;
+    std::vector<smpl_t> m_batchSpectra; // m_batchSize rows of spectrum norms
+    std::vector<smpl_t> m_batchBands;
+    std::vector<smpl_t> m_batchCoeffs;
+    std::vector<Vamp::RealTime> m_batchTimes;
 
     size_t m_stepSize;
     size_t m_blockSize;
-};
 
+    // input kept for rebuilding the aubio objects in restoreState()
+    InputHistory m_history;
+
+    unsigned int m_enabledOutputs;
+    FeatureStats m_stats;
+    FeatureDeltas m_deltas;
+    Vamp::RealTime m_lastTimestamp;
+    FeatureEncoding m_encoding;
+
+    /** compute the coefficients of the gathered spectra, with one
+      matrix product for all their DCTs, and push them */
+    void processBatch(FeatureSet &fs);
+    /** push the coefficients of one frame to the enabled outputs */
+    void pushFrame(const smpl_t *coeffs, const Vamp::RealTime &timestamp,
+                   FeatureSet &fs);
+};
 
 #endif
@@ -25,6 +25,8 @@
 
 #include <math.h>
 #include "Notes.h"
+#include "AubioLock.h"
+#include "DenormalGuard.h"
 
 #include <algorithm>
 
@@ -46,16 +48,22 @@ Notes::Notes(float inputSampleRate) :
     m_silence(-70),
     m_minioi(4),
     m_median(6),
+    m_analysisRate(0),
     m_minpitch(32),
     m_maxpitch(95),
     m_wrapRange(false),
     m_avoidLeaps(false),
-    m_prevPitch(-1)
+    m_prevPitch(-1),
+    m_lowLatency(false),
+    m_provisionalPitch(0),
+    m_haveProvisional(false),
+    m_offline(false)
 {
 }
 
 Notes::~Notes()
 {
+    AubioLock lock;
     if (m_onsetdet) del_aubio_onset(m_onsetdet);
     if (m_pitchdet) del_aubio_pitch(m_pitchdet);
     if (m_ibuf) del_fvec(m_ibuf);
@@ -90,7 +98,7 @@ Notes::getMaker() const
 int
 Notes::getPluginVersion() const
 {
-    return 4;
+    return 5;
 }
 
 string
@@ -110,10 +118,19 @@ Notes::initialise(size_t channels, size_t stepSize, size_t blockSize)
     m_stepSize = stepSize;
     m_blockSize = blockSize;
 
+    m_resampled.initialise(m_inputSampleRate, m_analysisRate,
+                           stepSize, blockSize);
+
     m_ibuf = new_fvec(stepSize);
     m_onset = new_fvec(1);
     m_pitch = new_fvec(1);
 
+    m_medianBuf.reserve(m_median);
+
+    m_history.initialise(getOnsetHistoryHops(stepSize, blockSize, m_minioi,
+                                             m_inputSampleRate) +
+                         m_resampled.getHistoryHops(), stepSize);
+
     reset();
 
     return true;
@@ -122,14 +139,15 @@ Notes::initialise(size_t channels, size_t stepSize, size_t blockSize)
 void
 Notes::reset()
 {
+    AubioLock lock;
     if (m_onsetdet) del_aubio_onset(m_onsetdet);
     if (m_pitchdet) del_aubio_pitch(m_pitchdet);
 
     m_onsetdet = new_aubio_onset
         (const_cast<char *>(getAubioNameForOnsetType(m_onsettype)),
-         m_blockSize,
-         m_stepSize,
-         lrintf(m_inputSampleRate));
+         m_resampled.getBlockSize(),
+         m_resampled.getStepSize(),
+         lrintf(m_resampled.getRate()));
     
     aubio_onset_set_threshold(m_onsetdet, m_threshold);
     aubio_onset_set_silence(m_onsetdet, m_silence);
@@ -137,9 +155,9 @@ Notes::reset()
 
     m_pitchdet = new_aubio_pitch
         (const_cast<char *>(getAubioNameForPitchType(m_pitchtype)),
-         m_blockSize,
-         m_stepSize,
-         lrintf(m_inputSampleRate));
+         m_resampled.getBlockSize(),
+         m_resampled.getStepSize(),
+         lrintf(m_resampled.getRate()));
 
     aubio_pitch_set_unit(m_pitchdet, const_cast<char *>("freq"));
 
@@ -147,8 +165,18 @@ Notes::reset()
     m_delay = Vamp::RealTime::frame2RealTime((4 + m_median) * m_stepSize,
                                        lrintf(m_inputSampleRate));
     m_currentOnset = Vamp::RealTime::zeroTime;
+    m_currentFreq = 0;
     m_haveCurrent = false;
     m_prevPitch = -1;
+    m_haveProvisional = false;
+
+    vector<float>().swap(m_pitchTrack);
+    vector<float>().swap(m_levelTrack);
+    vector<size_t>().swap(m_onsetHops);
+    m_trackStart = Vamp::RealTime::zeroTime;
+
+    m_history.reset();
+    m_resampled.reset();
 }
 
 size_t
@@ -282,6 +310,30 @@ Notes::getParameterDescriptors() const
     desc.quantizeStep = 1;
     list.push_back(desc);
 
+    desc = ParameterDescriptor();
+    desc.identifier = "lowlatency";
+    desc.name = "Report Provisional Notes";
+    desc.description = "Report each note on the provisional notes output as soon as two pitch estimates after its onset agree, then confirm, correct or cancel it once its median pitch is known";
+    desc.minValue = 0;
+    desc.maxValue = 1;
+    desc.defaultValue = 0;
+    desc.isQuantized = true;
+    desc.quantizeStep = 1;
+    list.push_back(desc);
+
+    desc = ParameterDescriptor();
+    desc.identifier = "offline";
+    desc.name = "Segment Notes over the Whole Input";
+    desc.description = "Keep the onsets, pitches and levels found at each step, and segment them into notes at the end of the input: each note lasts until the next onset or silence, takes the median pitch of all its frames, and is split where a different pitch is held without an onset. All notes are returned at the end, and no provisional notes are reported";
+    desc.minValue = 0;
+    desc.maxValue = 1;
+    desc.defaultValue = 0;
+    desc.isQuantized = true;
+    desc.quantizeStep = 1;
+    list.push_back(desc);
+
+    list.push_back(getAnalysisRateDescriptor(m_inputSampleRate));
+
     return list;
 }
 
@@ -306,6 +358,12 @@ Notes::getParameter(std::string param) const
         return m_avoidLeaps ? 1.0 : 0.0;
     } else if (param == "minioi") {
         return m_minioi;
+    } else if (param == "lowlatency") {
+        return m_lowLatency ? 1.0 : 0.0;
+    } else if (param == "offline") {
+        return m_offline ? 1.0 : 0.0;
+    } else if (param == "analysisrate") {
+        return m_analysisRate;
     } else {
         return 0.0;
     }
@@ -347,6 +405,12 @@ Notes::setParameter(std::string param, float value)
         m_avoidLeaps = (value > 0.5);
     } else if (param == "minioi") {
         m_minioi = value;
+    } else if (param == "lowlatency") {
+        m_lowLatency = (value > 0.5);
+    } else if (param == "offline") {
+        m_offline = (value > 0.5);
+    } else if (param == "analysisrate") {
+        m_analysisRate = value;
     }
 }
 
@@ -373,6 +437,22 @@ Notes::getOutputDescriptors() const
     d.sampleRate = 0;
     list.push_back(d);
 
+    d = OutputDescriptor();
+    d.identifier = "provisionalnotes";
+    d.name = "Provisional Notes";
+    d.description = "Notes reported as soon as onset and pitch agree, labelled provisional, then confirmed, corrected or cancelled when the note is final, or provisional and confirmed together if the pitch never agreed sooner";
+    d.unit = "Hz";
+    d.hasFixedBinCount = true;
+    d.binCount = 2;
+    d.binNames.push_back("Frequency");
+    d.binNames.push_back("Velocity");
+    d.hasDuration = false;
+    d.hasKnownExtents = false;
+    d.isQuantized = false;
+    d.sampleType = OutputDescriptor::VariableSampleRate;
+    d.sampleRate = 0;
+    list.push_back(d);
+
     return list;
 }
 
@@ -382,35 +462,80 @@ Notes::process(const float *const *inputBuffers, Vamp::RealTime timestamp)
     for (size_t i = 0; i < m_stepSize; ++i) {
         fvec_set_sample(m_ibuf, inputBuffers[0][i], i);
     }
+    return processInput(m_ibuf, timestamp);
+}
+
+Notes::FeatureSet
+Notes::processInput(const fvec_t *input, Vamp::RealTime timestamp)
+{
+    DenormalGuard guard;
+
+    m_history.push(input);
 
-    aubio_onset_do(m_onsetdet, m_ibuf, m_onset);
-    aubio_pitch_do(m_pitchdet, m_ibuf, m_pitch);
+    if (!m_resampled.isActive()) return analyse(input, timestamp);
+
+    m_resampled.push(input, timestamp);
+    return analyseResampled();
+}
+
+Notes::FeatureSet
+Notes::analyseResampled()
+{
+    FeatureSet returnFeatures;
+    Vamp::RealTime timestamp;
+    while (const fvec_t *input = m_resampled.next(timestamp)) {
+        appendFeatures(returnFeatures, analyse(input, timestamp));
+    }
+    return returnFeatures;
+}
+
+Notes::FeatureSet
+Notes::analyse(const fvec_t *input, Vamp::RealTime timestamp)
+{
+    aubio_onset_do(m_onsetdet, input, m_onset);
+    aubio_pitch_do(m_pitchdet, input, m_pitch);
 
     bool isonset = m_onset->data[0];
     float frequency = m_pitch->data[0];
+    float level = aubio_level_detection(input, m_silence);
+
+    if (m_offline) {
+        if (m_pitchTrack.empty()) m_trackStart = timestamp;
+        if (isonset) m_onsetHops.push_back(m_pitchTrack.size());
+        m_pitchTrack.push_back(frequency);
+        m_levelTrack.push_back(level);
+        return FeatureSet();
+    }
 
     m_notebuf.push_back(frequency);
     if (m_notebuf.size() > m_median) m_notebuf.pop_front();
 
-    float level = aubio_level_detection(m_ibuf, m_silence);
-
     FeatureSet returnFeatures;
 
     if (isonset) {
+        cancelProvisional(returnFeatures);
         if (level == 1.) {
             isonset = false;
             m_count = 0;
             if (m_haveCurrent) pushNote(returnFeatures, timestamp);
         } else {
             m_count = 1;
+            m_provisionalPitch = -1;
         }
     } else {
         if (m_count > 0) ++m_count;
+        if (m_lowLatency && m_count >= 2 && m_count <= m_median &&
+            !m_haveProvisional && m_provisionalPitch < 0) {
+            pushProvisional(returnFeatures, timestamp, level);
+        }
         if (m_count == m_median) {
             if (m_haveCurrent) pushNote(returnFeatures, timestamp);
+            m_medianBuf.assign(m_notebuf.begin(), m_notebuf.end());
+            m_currentFreq = takeMedian();
             m_currentOnset = timestamp;
             m_currentLevel = level;
             m_haveCurrent = true;
+            if (m_lowLatency) confirmProvisional(returnFeatures);
         }
     }
 
@@ -421,21 +546,23 @@ Notes::process(const float *const *inputBuffers, Vamp::RealTime timestamp)
 Notes::FeatureSet
 Notes::getRemainingFeatures()
 {
+    DenormalGuard guard;
+
     FeatureSet returnFeatures;
+    if (m_resampled.isActive()) {
+        m_resampled.flush();
+        returnFeatures = analyseResampled();
+    }
+    if (m_offline) segmentNotes(returnFeatures);
+    cancelProvisional(returnFeatures);
     if (m_haveCurrent) pushNote(returnFeatures, m_lastTimeStamp);
     return returnFeatures;
 }
 
-void
-Notes::pushNote(FeatureSet &fs, const Vamp::RealTime &offTime)
+bool
+Notes::foldPitch(float &freq, int &midiPitch) const
 {
-    std::deque<float> toSort = m_notebuf;
-    std::sort(toSort.begin(), toSort.end());
-    float median = toSort[toSort.size()/2];
-    if (median < 45.0) return;
-
-    float freq = median;
-    int midiPitch = (int)floor(aubio_freqtomidi(freq) + 0.5);
+    midiPitch = (int)floor(aubio_freqtomidi(freq) + 0.5);
     
     if (m_avoidLeaps) {
         if (m_prevPitch >= 0) {
@@ -451,17 +578,151 @@ Notes::pushNote(FeatureSet &fs, const Vamp::RealTime &offTime)
     }
 
     while (midiPitch < m_minpitch) {
-        if (!m_wrapRange) return;
+        if (!m_wrapRange) return false;
         midiPitch += 12;
         freq *= 2;
     }
 
     while (midiPitch > m_maxpitch) {
-        if (!m_wrapRange) return;
+        if (!m_wrapRange) return false;
         midiPitch -= 12;
         freq /= 2;
     }
 
+    return true;
+}
+
+float
+Notes::takeMedian()
+{
+    // the upper median of m_medianBuf, which is left partly sorted
+    if (m_medianBuf.empty()) return 0;
+    vector<float>::iterator mid = m_medianBuf.begin() + m_medianBuf.size()/2;
+    std::nth_element(m_medianBuf.begin(), mid, m_medianBuf.end());
+    return *mid;
+}
+
+void
+Notes::segmentNotes(FeatureSet &fs)
+{
+    // With the whole input known, a note can take its end and pitch
+    // from everything after its onset. It starts where analyse() would
+    // place it, 5 hops before its onset is reported (m_delay, less the
+    // m_median - 1 hops analyse() waits for), and lasts until the next
+    // onset or the first silent hop after its own onset. A pitch held
+    // for m_median frames after a different one also starts a new
+    // note, for legato notes which have no onset of their own.
+
+    const size_t lead = 5;
+    size_t hops = m_pitchTrack.size();
+
+    // hops covered by the window of one pitch frame
+    size_t span = (m_resampled.getBlockSize() +
+                   m_resampled.getStepSize() - 1) /
+        m_resampled.getStepSize();
+
+    for (size_t i = 0; i < m_onsetHops.size(); ++i) {
+
+        size_t onset = m_onsetHops[i];
+        if (m_levelTrack[onset] == 1.) continue; // silent onsets only end notes
+
+        size_t start = (onset > lead ? onset - lead : 0);
+        size_t end = hops;
+        if (i + 1 < m_onsetHops.size()) {
+            size_t next = m_onsetHops[i + 1];
+            end = (next > lead ? next - lead : 0);
+        }
+        for (size_t k = onset; k < end; ++k) {
+            if (m_levelTrack[k] == 1.) {
+                end = k;
+                break;
+            }
+        }
+
+        // as in analyse(), notes shorter than m_median hops are dropped
+        if (end < start + m_median) continue;
+
+        // split at each change between pitches held for m_median
+        // frames, after the last frame of the old pitch and no later
+        // than the first hop of the window of the new one
+        size_t from = start;
+        int held = -1, run = -1;
+        size_t heldEnd = 0, runStart = 0;
+
+        for (size_t k = start + span; k < end; ++k) {
+            int midiPitch = -1;
+            if (m_pitchTrack[k] >= 45.0) {
+                midiPitch = (int)floor(aubio_freqtomidi(m_pitchTrack[k]) + 0.5);
+            }
+            if (k == start + span || midiPitch != run) {
+                run = midiPitch;
+                runStart = k;
+            }
+            if (run >= 0 && k + 1 - runStart == m_median) {
+                if (held >= 0 && run != held) {
+                    size_t split = runStart + 1 - span;
+                    if (split <= heldEnd) split = heldEnd + 1;
+                    pushSegment(fs, from, split, span);
+                    from = split;
+                }
+                held = run;
+            }
+            if (held >= 0 && midiPitch == held) heldEnd = k;
+        }
+
+        pushSegment(fs, from, end, span);
+    }
+
+    vector<float>().swap(m_pitchTrack);
+    vector<float>().swap(m_levelTrack);
+    vector<size_t>().swap(m_onsetHops);
+}
+
+void
+Notes::pushSegment(FeatureSet &fs, size_t from, size_t to, size_t span)
+{
+    // the median pitch of the frames within the note, or of the first
+    // m_median frames from its start if it is shorter than that
+    size_t first = from + span;
+    size_t last = std::min(std::max(to, first + m_median),
+                           m_pitchTrack.size());
+    if (first >= last) return;
+
+    m_medianBuf.assign(m_pitchTrack.begin() + first,
+                       m_pitchTrack.begin() + last);
+    m_currentFreq = takeMedian();
+
+    // the loudest hop of the note
+    m_currentLevel = 1.;
+    for (size_t k = from; k < to; ++k) {
+        float level = m_levelTrack[k];
+        if (level == 1.) continue;
+        if (m_currentLevel == 1. || level > m_currentLevel) {
+            m_currentLevel = level;
+        }
+    }
+
+    // times as analyse() would have them, m_delay after the note
+    // starts and after it ends
+    int rate = lrintf(m_inputSampleRate);
+    long startFrame = Vamp::RealTime::realTime2Frame(m_trackStart, rate);
+    long delay = (4 + m_median) * m_stepSize;
+    m_currentOnset = Vamp::RealTime::frame2RealTime
+        (startFrame + from * m_stepSize + delay, rate);
+    pushNote(fs, Vamp::RealTime::frame2RealTime
+             (startFrame + to * m_stepSize + delay, rate));
+}
+
+void
+Notes::pushNote(FeatureSet &fs, const Vamp::RealTime &offTime)
+{
+    float median = m_currentFreq;
+    if (median < 45.0) return;
+
+    float freq = median;
+    int midiPitch = 0;
+    if (!foldPitch(freq, midiPitch)) return;
+
     m_prevPitch = midiPitch;
 
     Feature feature;
@@ -480,4 +741,188 @@ Notes::pushNote(FeatureSet &fs, const Vamp::RealTime &offTime)
     feature.values.push_back(m_currentLevel);
     fs[0].push_back(feature);
 }
-    
+
+void
+Notes::pushProvisional(FeatureSet &fs, const Vamp::RealTime &timestamp,
+                       float level)
+{
+    // the last two pitch frames must round to the same note
+    float last = m_notebuf[m_notebuf.size() - 1];
+    float prev = m_notebuf[m_notebuf.size() - 2];
+    if (last < 45.0 || prev < 45.0) return;
+    if (fabs(aubio_freqtomidi(last) - aubio_freqtomidi(prev)) >= 0.5) return;
+
+    float freq = last;
+    int midiPitch = 0;
+    if (!foldPitch(freq, midiPitch)) {
+        m_provisionalPitch = midiPitch; // out of range, do not retry
+        return;
+    }
+
+    // same timestamp as the final note, whose onset is set when
+    // m_count reaches m_median; counted in frames, as the host counts
+    // its timestamps, so that the two are equal
+    int rate = lrintf(m_inputSampleRate);
+    Vamp::RealTime onset = Vamp::RealTime::frame2RealTime
+        (Vamp::RealTime::realTime2Frame(timestamp, rate) +
+         (m_median - m_count) * m_stepSize, rate);
+    if (onset < m_delay) onset = m_delay;
+
+    m_provisional = Feature();
+    m_provisional.hasTimestamp = true;
+    m_provisional.timestamp = onset - m_delay;
+    m_provisional.values.push_back(freq);
+    m_provisional.values.push_back(level);
+    m_provisional.label = "provisional";
+    fs[1].push_back(m_provisional);
+
+    m_provisionalPitch = midiPitch;
+    m_haveProvisional = true;
+}
+
+void
+Notes::confirmProvisional(FeatureSet &fs)
+{
+    // the current note has just started, with the pitch and level that
+    // pushNote will report; m_prevPitch is already that of the previous
+    // note, so the folding is the same
+    float freq = m_currentFreq;
+    int midiPitch = 0;
+    if (freq < 45.0 || !foldPitch(freq, midiPitch)) {
+        cancelProvisional(fs);
+        return;
+    }
+
+    Feature update;
+    update.hasTimestamp = true;
+    update.timestamp = m_currentOnset < m_delay ?
+        Vamp::RealTime::zeroTime : m_currentOnset - m_delay;
+    update.values.push_back(freq);
+    update.values.push_back(m_currentLevel);
+
+    if (!m_haveProvisional) {
+        // no two pitch frames agreed before now: report the note
+        // provisionally all the same, so that every note confirmed
+        // was reported first
+        update.label = "provisional";
+        fs[1].push_back(update);
+        m_provisionalPitch = midiPitch;
+    }
+
+    update.label = (m_provisionalPitch != midiPitch) ?
+        "corrected" : "confirmed";
+    fs[1].push_back(update);
+    m_haveProvisional = false;
+}
+
+void
+Notes::cancelProvisional(FeatureSet &fs)
+{
+    // a provisional note that will not become a note
+    if (!m_haveProvisional) return;
+    m_provisional.label = "cancelled";
+    fs[1].push_back(m_provisional);
+    m_haveProvisional = false;
+}
+
+string
+Notes::saveState() const
+{
+    StateWriter writer;
+    writeStateHeader(writer, *this, m_inputSampleRate, m_stepSize, m_blockSize);
+    m_history.save(writer);
+    writer.putFloats(vector<float>(m_notebuf.begin(), m_notebuf.end()));
+    writer.putSize(m_count);
+    writer.putRealTime(m_currentOnset);
+    writer.putRealTime(m_lastTimeStamp);
+    writer.putFloat(m_currentLevel);
+    writer.putFloat(m_currentFreq);
+    writer.putBool(m_haveCurrent);
+    writer.putInt(m_prevPitch);
+    writer.putFeature(m_provisional);
+    writer.putInt(m_provisionalPitch);
+    writer.putBool(m_haveProvisional);
+    if (m_offline) {
+        writer.putRealTime(m_trackStart);
+        writer.putSize(m_pitchTrack.size());
+        writer.putSize(m_onsetHops.size());
+        writer.putFloats(m_pitchTrack);
+        writer.putFloats(m_levelTrack);
+        writer.putSizes(m_onsetHops);
+    }
+    return writer.getData();
+}
+
+bool
+Notes::restoreState(const string &state)
+{
+    if (!m_ibuf) {
+        cerr << "Notes::restoreState: Notes plugin not initialised" << endl;
+        return false;
+    }
+
+    reset();
+
+    if (!isOnsetMemoryBounded(m_onsettype)) {
+        cerr << "Notes::restoreState: the " << getAubioNameForOnsetType(m_onsettype)
+             << " onset function is whitened over the whole input and cannot"
+             << " be rebuilt exactly, so analyses using it cannot be resumed"
+             << endl;
+        return false;
+    }
+
+    StateReader reader(state);
+    if (!readStateHeader(reader, *this, m_inputSampleRate,
+                         m_stepSize, m_blockSize)) {
+        return false;
+    }
+
+    InputHistory history(m_history);
+    history.restore(reader);
+    if (!reader.isOK()) {
+        cerr << "Notes::restoreState: invalid state" << endl;
+        return false;
+    }
+
+    history.replay(*this, m_blockSize, m_inputSampleRate);
+    m_history = history;
+
+    size_t notes = reader.getCount(m_median);
+    m_notebuf.clear();
+    for (size_t i = 0; i < notes; ++i) m_notebuf.push_back(reader.getFloat());
+    m_count = reader.getSize();
+    m_currentOnset = reader.getRealTime();
+    m_lastTimeStamp = reader.getRealTime();
+    m_currentLevel = reader.getFloat();
+    m_currentFreq = reader.getFloat();
+    m_haveCurrent = reader.getBool();
+    m_prevPitch = reader.getInt();
+    m_provisional = reader.getFeature();
+    m_provisionalPitch = reader.getInt();
+    m_haveProvisional = reader.getBool();
+
+    // the hops replayed above are in the saved tracks already
+    bool tracksOK = true;
+    if (m_offline) {
+        m_trackStart = reader.getRealTime();
+        size_t hops = reader.getCount(state.size() / 4);
+        size_t onsets = reader.getCount(hops);
+        reader.getFloats(m_pitchTrack, hops);
+        reader.getFloats(m_levelTrack, hops);
+        reader.getSizes(m_onsetHops, onsets);
+        for (size_t i = 0; i < m_onsetHops.size(); ++i) {
+            if (m_onsetHops[i] >= hops ||
+                (i > 0 && m_onsetHops[i] <= m_onsetHops[i-1])) {
+                tracksOK = false;
+            }
+        }
+    }
+
+    if (!tracksOK || !reader.isAtEnd()) {
+        cerr << "Notes::restoreState: invalid state" << endl;
+        reset();
+        return false;
+    }
+
+    return true;
+}
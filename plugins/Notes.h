@@ -30,10 +30,14 @@
 #include <aubio/aubio.h>
 
 #include <deque>
+#include <vector>
 
 #include "Types.h"
+#include "Checkpoint.h"
+#include "PcmInput.h"
+#include "Resampler.h"
 
-class Notes : public Vamp::Plugin
+class Notes : public Vamp::Plugin, public Checkpointable, public PcmInput
 {
 public:
     Notes(float inputSampleRate);
@@ -62,9 +66,13 @@ public:
 
     FeatureSet process(const float *const *inputBuffers,
                        Vamp::RealTime timestamp);
+    FeatureSet processInput(const fvec_t *input, Vamp::RealTime timestamp);
 
     FeatureSet getRemainingFeatures();
 
+    std::string saveState() const;
+    bool restoreState(const std::string &state);
+
 protected:
     fvec_t *m_ibuf;
     fvec_t *m_onset;
@@ -79,6 +87,14 @@ protected:
     size_t m_median;
     size_t m_stepSize;
     size_t m_blockSize;
+
+    // input kept for rebuilding the aubio objects in restoreState()
+    InputHistory m_history;
+
+    // input decimated to the analysis rate, when it is below the host's
+    float m_analysisRate;
+    ResampledInput m_resampled;
+
     int m_minpitch;
     int m_maxpitch;
     bool m_wrapRange;
@@ -89,10 +105,36 @@ protected:
     Vamp::RealTime m_currentOnset;
     Vamp::RealTime m_lastTimeStamp;
     float m_currentLevel;
+    float m_currentFreq;
     bool m_haveCurrent;
     int m_prevPitch;
 
+    bool m_lowLatency;
+    Feature m_provisional;
+    int m_provisionalPitch;
+    bool m_haveProvisional;
+
+    // in offline mode, the pitch and level of every hop and the hops
+    // with an onset, segmented into notes by segmentNotes() at the end
+    bool m_offline;
+    std::vector<float> m_pitchTrack;
+    std::vector<float> m_levelTrack;
+    std::vector<size_t> m_onsetHops;
+    Vamp::RealTime m_trackStart;
+
+    // pitches whose median is being taken
+    std::vector<float> m_medianBuf;
+
     void pushNote(FeatureSet &, const Vamp::RealTime &);
+    void pushProvisional(FeatureSet &, const Vamp::RealTime &, float level);
+    void confirmProvisional(FeatureSet &);
+    void cancelProvisional(FeatureSet &);
+    bool foldPitch(float &freq, int &midiPitch) const;
+    float takeMedian();
+    void segmentNotes(FeatureSet &);
+    void pushSegment(FeatureSet &, size_t from, size_t to, size_t span);
+    FeatureSet analyse(const fvec_t *input, Vamp::RealTime timestamp);
+    FeatureSet analyseResampled();
 };
 
 
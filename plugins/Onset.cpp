@@ -25,6 +25,8 @@
 
 #include <math.h>
 #include "Onset.h"
+#include "AubioLock.h"
+#include "DenormalGuard.h"
 
 using std::string;
 using std::vector;
@@ -39,16 +41,26 @@ Onset::Onset(float inputSampleRate) :
     m_onsettype(OnsetDefault),
     m_threshold(0.3),
     m_silence(-90),
-    m_minioi(4)
+    m_minioi(4),
+    m_coarseThreshold(0),
+    m_enabledOutputs(7),
+    m_frameOffset(0),
+    m_warmup(0),
+    m_warmupHops(0),
+    m_fine(false),
+    m_fineHops(0),
+    m_fineStart(0)
 {
 
 }
 
 Onset::~Onset()
 {
+    AubioLock lock;
     if (m_onsetdet) del_aubio_onset(m_onsetdet);
     if (m_ibuf) del_fvec(m_ibuf);
     if (m_onset) del_fvec(m_onset);
+    if (m_warmup) del_fvec(m_warmup);
 }
 
 string
@@ -100,6 +112,19 @@ Onset::initialise(size_t channels, size_t stepSize, size_t blockSize)
 
     m_ibuf = new_fvec(stepSize);
     m_onset = new_fvec(1);
+    m_warmup = new_fvec(stepSize);
+
+    m_warmupHops = getOnsetHistoryHops(stepSize, blockSize, m_minioi,
+                                       m_inputSampleRate);
+
+    // coarse frames of twice the block size; onsets are reported from
+    // one frame before a candidate, after m_warmupHops hops of warm-up
+    size_t frameHops = 2 * getPvocHistoryHops(stepSize, blockSize);
+    m_screen.initialise(stepSize, frameHops, m_coarseThreshold, m_silence);
+
+    size_t historyHops = m_warmupHops;
+    if (m_coarseThreshold > 0) historyHops += 2 * frameHops;
+    m_history.initialise(historyHops, stepSize);
 
     reset();
 
@@ -109,6 +134,21 @@ Onset::initialise(size_t channels, size_t stepSize, size_t blockSize)
 void
 Onset::reset()
 {
+    newDetector();
+
+    m_history.reset();
+    m_frameOffset = 0;
+
+    m_screen.reset();
+    m_fine = false;
+    m_fineHops = 0;
+    m_fineStart = 0;
+}
+
+void
+Onset::newDetector()
+{
+    AubioLock lock;
     if (m_onsetdet) del_aubio_onset(m_onsetdet);
 
     m_onsetdet = new_aubio_onset
@@ -120,7 +160,6 @@ Onset::reset()
     aubio_onset_set_threshold(m_onsetdet, m_threshold);
     aubio_onset_set_silence(m_onsetdet, m_silence);
     aubio_onset_set_minioi(m_onsetdet, m_minioi);
-
 }
 
 size_t
@@ -193,6 +232,19 @@ Onset::getParameterDescriptors() const
     desc.quantizeStep = 1;
     list.push_back(desc);
 
+    desc = ParameterDescriptor();
+    desc.identifier = "coarsethreshold";
+    desc.name = "Coarse Pass Threshold";
+    desc.description = "Rise in energy between coarse frames of the input around which the onset detection function is evaluated, or 0 to evaluate it everywhere";
+    desc.minValue = 0;
+    desc.maxValue = 20;
+    desc.defaultValue = 0;
+    desc.unit = "dB";
+    desc.isQuantized = false;
+    list.push_back(desc);
+
+    list.push_back(getEnabledOutputsDescriptor(getOutputDescriptors()));
+
     return list;
 }
 
@@ -219,6 +271,10 @@ Onset::getParameter(std::string param) const
         } else {
             return m_minioi;
         }
+    } else if (param == "coarsethreshold") {
+        return m_coarseThreshold;
+    } else if (param == "enabledoutputs") {
+        return m_enabledOutputs;
     } else {
         return 0.0;
     }
@@ -239,7 +295,6 @@ Onset::setParameter(std::string param, float value)
         case 7: m_onsettype = OnsetSpecFlux; break;
         case 8: m_onsettype = OnsetDefault; break;
         }
-        if (!m_onsetdet) initialise(1, 256, 512);
     } else if (param == "peakpickthreshold") {
         m_threshold = value;
         if (m_onsetdet)
@@ -252,6 +307,11 @@ Onset::setParameter(std::string param, float value)
         m_minioi = value;
         if (m_onsetdet)
             aubio_onset_set_minioi(m_onsetdet, m_minioi);
+    } else if (param == "coarsethreshold") {
+        m_coarseThreshold = value;
+    } else if (param == "enabledoutputs") {
+        m_enabledOutputs = getEnabledOutputsMask
+            (value, getOutputDescriptors().size());
     }
 }
 
@@ -293,42 +353,212 @@ Onset::getOutputDescriptors() const
 }
 
 Onset::FeatureSet
-Onset::process(const float *const *inputBuffers,
-               UNUSED Vamp::RealTime timestamp)
+Onset::process(const float *const *inputBuffers, Vamp::RealTime timestamp)
 {
     for (size_t i = 0; i < m_stepSize; ++i) {
         fvec_set_sample(m_ibuf, inputBuffers[0][i], i);
     }
+    return processInput(m_ibuf, timestamp);
+}
+
+Onset::FeatureSet
+Onset::processInput(const fvec_t *input, UNUSED Vamp::RealTime timestamp)
+{
+    DenormalGuard guard;
+
+    m_history.push(input);
+
+    if (m_coarseThreshold > 0) {
+        return processCoarse(input);
+    }
 
-    aubio_onset_do(m_onsetdet, m_ibuf, m_onset);
+    aubio_onset_do(m_onsetdet, input, m_onset);
 
     smpl_t isonset = m_onset->data[0];
 
     FeatureSet returnFeatures;
 
-    if (isonset) {
+    if (isonset && isOutputEnabled(m_enabledOutputs, 0)) {
         Feature onsettime;
         onsettime.hasTimestamp = true;
-        onsettime.timestamp = Vamp::RealTime::fromSeconds(aubio_onset_get_last_s(m_onsetdet));
+        onsettime.timestamp = getLastOnsetTime(m_onsetdet, m_frameOffset,
+                                               m_inputSampleRate);
         returnFeatures[0].push_back(onsettime);
     }
 
-    Feature odf;
-    odf.hasTimestamp = false;
-    odf.values.push_back(aubio_onset_get_descriptor(m_onsetdet));
-    returnFeatures[1].push_back(odf);
+    if (isOutputEnabled(m_enabledOutputs, 1)) {
+        Feature odf;
+        odf.hasTimestamp = false;
+        odf.values.push_back(aubio_onset_get_descriptor(m_onsetdet));
+        returnFeatures[1].push_back(odf);
+    }
 
-    Feature todf;
-    todf.hasTimestamp = false;
-    todf.values.push_back(aubio_onset_get_thresholded_descriptor(m_onsetdet));
-    returnFeatures[2].push_back(todf);
+    if (isOutputEnabled(m_enabledOutputs, 2)) {
+        Feature todf;
+        todf.hasTimestamp = false;
+        todf.values.push_back(aubio_onset_get_thresholded_descriptor(m_onsetdet));
+        returnFeatures[2].push_back(todf);
+    }
 
     return returnFeatures;
 }
 
+Onset::FeatureSet
+Onset::processCoarse(const fvec_t *input)
+{
+    FeatureSet returnFeatures;
+
+    if (m_screen.push(input)) {
+        if (!m_fine) {
+            // report onsets from the frame before the candidate on
+            size_t hops = 2 * m_screen.getFrameHops();
+            size_t total = m_history.getTotal();
+            size_t start = (total > hops ? total - hops : 0) * m_stepSize;
+            if (start > m_fineStart) m_fineStart = start;
+            warmUp(m_history.getCount() - 1, returnFeatures);
+            m_fine = true;
+        }
+        m_fineHops = m_warmupHops;
+    }
+
+    bool fine = m_fine;
+    if (fine) {
+        aubio_onset_do(m_onsetdet, input, m_onset);
+        addOnset(returnFeatures);
+        if (--m_fineHops == 0) m_fine = false;
+    }
+
+    if (isOutputEnabled(m_enabledOutputs, 1)) {
+        Feature odf;
+        odf.hasTimestamp = false;
+        odf.values.push_back
+            (fine ? aubio_onset_get_descriptor(m_onsetdet) : 0);
+        returnFeatures[1].push_back(odf);
+    }
+
+    if (isOutputEnabled(m_enabledOutputs, 2)) {
+        Feature todf;
+        todf.hasTimestamp = false;
+        todf.values.push_back
+            (fine ? aubio_onset_get_thresholded_descriptor(m_onsetdet) : 0);
+        returnFeatures[2].push_back(todf);
+    }
+
+    return returnFeatures;
+}
+
+void
+Onset::warmUp(size_t blocks, FeatureSet &features)
+{
+    // a new detector, run over the oldest blocks of m_history
+    newDetector();
+    m_frameOffset = m_history.getStartFrame();
+
+    for (size_t i = 0; i < blocks; ++i) {
+        const float *block = m_history.getBlock(i);
+        for (size_t j = 0; j < m_stepSize; ++j) {
+            fvec_set_sample(m_warmup, block[j], j);
+        }
+        aubio_onset_do(m_onsetdet, m_warmup, m_onset);
+        addOnset(features);
+    }
+}
+
+void
+Onset::addOnset(FeatureSet &features)
+{
+    if (!m_onset->data[0]) return;
+
+    // the detector reports the same onsets again after a warm-up
+    size_t frame = m_frameOffset + aubio_onset_get_last(m_onsetdet);
+    if (frame < m_fineStart) return;
+    m_fineStart = frame + 1;
+
+    if (isOutputEnabled(m_enabledOutputs, 0)) {
+        Feature onsettime;
+        onsettime.hasTimestamp = true;
+        onsettime.timestamp = getLastOnsetTime(m_onsetdet, m_frameOffset,
+                                               m_inputSampleRate);
+        features[0].push_back(onsettime);
+    }
+}
+
 Onset::FeatureSet
 Onset::getRemainingFeatures()
 {
     return FeatureSet();
 }
 
+string
+Onset::saveState() const
+{
+    StateWriter writer;
+    writeStateHeader(writer, *this, m_inputSampleRate, m_stepSize, m_blockSize);
+    m_history.save(writer);
+    if (m_coarseThreshold > 0) {
+        m_screen.save(writer);
+        writer.putBool(m_fine);
+        writer.putSize(m_fineHops);
+        writer.putSize(m_fineStart);
+    }
+    return writer.getData();
+}
+
+bool
+Onset::restoreState(const string &state)
+{
+    if (!m_ibuf) {
+        cerr << "Onset::restoreState: Onset plugin not initialised" << endl;
+        return false;
+    }
+
+    reset();
+
+    if (!isOnsetMemoryBounded(m_onsettype)) {
+        cerr << "Onset::restoreState: the " << getAubioNameForOnsetType(m_onsettype)
+             << " onset function is whitened over the whole input and cannot"
+             << " be rebuilt exactly, so analyses using it cannot be resumed"
+             << endl;
+        return false;
+    }
+
+    StateReader reader(state);
+    if (!readStateHeader(reader, *this, m_inputSampleRate,
+                         m_stepSize, m_blockSize)) {
+        return false;
+    }
+
+    InputHistory history(m_history);
+    history.restore(reader);
+    if (!reader.isOK()) {
+        cerr << "Onset::restoreState: invalid state" << endl;
+        return false;
+    }
+
+    if (m_coarseThreshold > 0) {
+        m_history = history;
+        m_screen.restore(reader);
+        bool fine = reader.getBool();
+        size_t fineHops = reader.getCount(m_warmupHops);
+        size_t fineStart = reader.getSize();
+        if (fine && reader.isOK()) {
+            FeatureSet discarded;
+            warmUp(m_history.getCount(), discarded);
+        }
+        m_fine = fine;
+        m_fineHops = fineHops;
+        m_fineStart = fineStart;
+    } else {
+        m_frameOffset = history.getStartFrame();
+        history.replay(*this, m_blockSize, m_inputSampleRate);
+        m_history = history;
+    }
+
+    if (!reader.isAtEnd()) {
+        cerr << "Onset::restoreState: invalid state" << endl;
+        reset();
+        return false;
+    }
+
+    return true;
+}
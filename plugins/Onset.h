@@ -30,8 +30,11 @@
 #include <aubio/aubio.h>
 
 #include "Types.h"
+#include "Checkpoint.h"
+#include "PcmInput.h"
+#include "OnsetScreen.h"
 
-class Onset : public Vamp::Plugin
+class Onset : public Vamp::Plugin, public Checkpointable, public PcmInput
 {
 public:
     Onset(float inputSampleRate);
@@ -60,9 +63,13 @@ public:
 
     FeatureSet process(const float *const *inputBuffers,
                        Vamp::RealTime timestamp);
+    FeatureSet processInput(const fvec_t *input, Vamp::RealTime timestamp);
 
     FeatureSet getRemainingFeatures();
 
+    std::string saveState() const;
+    bool restoreState(const std::string &state);
+
 protected:
     fvec_t *m_ibuf;
     fvec_t *m_onset;
@@ -71,8 +78,30 @@ protected:
     float m_threshold;
     float m_silence;
     float m_minioi;
+    float m_coarseThreshold;
+    unsigned int m_enabledOutputs;
     size_t m_stepSize;
     size_t m_blockSize;
+
+    // input kept for rebuilding the aubio objects in restoreState()
+    InputHistory m_history;
+    size_t m_frameOffset; // first frame given to m_onsetdet
+
+    // coarse pass: m_onsetdet only runs from a little before the
+    // frames m_screen flags to m_warmupHops after the last of them,
+    // after a new detector is warmed up on the input in m_history
+    OnsetScreen m_screen;
+    fvec_t *m_warmup;
+    size_t m_warmupHops;
+    bool m_fine;
+    size_t m_fineHops;    // hops left before m_onsetdet stops
+    size_t m_fineStart;   // first frame at which onsets are reported
+
+    void newDetector();
+    FeatureSet processCoarse(const fvec_t *input);
+    void warmUp(size_t blocks, FeatureSet &features);
+    void addOnset(FeatureSet &features);
+
     Vamp::RealTime m_delay;
     Vamp::RealTime m_lastOnset;
 };
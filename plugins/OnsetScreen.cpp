@@ -0,0 +1,130 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "OnsetScreen.h"
+
+#include <cmath>
+
+OnsetScreen::OnsetScreen() :
+    m_stepSize(0),
+    m_frameHops(1),
+    m_threshold(0),
+    m_silence(-90)
+{
+    reset();
+}
+
+void
+OnsetScreen::initialise(size_t stepSize, size_t frameHops,
+                        float threshold, float silence)
+{
+    m_stepSize = stepSize;
+    m_frameHops = (frameHops > 0 ? frameHops : 1);
+    m_threshold = threshold;
+    m_silence = silence;
+    reset();
+}
+
+void
+OnsetScreen::reset()
+{
+    m_hops = 0;
+    m_energy = 0;
+    m_brightness = 0;
+    m_last = 0;
+    for (int i = 0; i < 2; ++i) {
+        m_prevEnergy[i] = 0;
+        m_prevBrightness[i] = 0;
+    }
+}
+
+static bool
+rises(double value, const double prev[2], double ratio)
+{
+    double floor = (prev[0] < prev[1] ? prev[0] : prev[1]);
+    return value > floor * ratio;
+}
+
+bool
+OnsetScreen::push(const fvec_t *input)
+{
+    const smpl_t *data = input->data;
+    double energy = 0, brightness = 0;
+    smpl_t last = m_last;
+    for (size_t i = 0; i < m_stepSize; ++i) {
+        smpl_t d = data[i] - last;
+        energy += data[i] * data[i];
+        brightness += d * d;
+        last = data[i];
+    }
+    m_last = last;
+    m_energy += energy;
+    m_brightness += brightness;
+
+    if (++m_hops < m_frameHops) return false;
+
+    double ratio = pow(10.0, m_threshold / 10.0);
+    double level = 10.0 * log10(m_energy / (m_frameHops * m_stepSize) + 1e-30);
+
+    bool candidate = (level > m_silence &&
+                      (rises(m_energy, m_prevEnergy, ratio) ||
+                       rises(m_brightness, m_prevBrightness, ratio)));
+
+    m_prevEnergy[0] = m_prevEnergy[1];
+    m_prevEnergy[1] = m_energy;
+    m_prevBrightness[0] = m_prevBrightness[1];
+    m_prevBrightness[1] = m_brightness;
+    m_hops = 0;
+    m_energy = 0;
+    m_brightness = 0;
+
+    return candidate;
+}
+
+void
+OnsetScreen::save(StateWriter &writer) const
+{
+    writer.putSize(m_hops);
+    writer.putDouble(m_energy);
+    writer.putDouble(m_brightness);
+    writer.putDouble(m_last);
+    for (int i = 0; i < 2; ++i) {
+        writer.putDouble(m_prevEnergy[i]);
+        writer.putDouble(m_prevBrightness[i]);
+    }
+}
+
+void
+OnsetScreen::restore(StateReader &reader)
+{
+    m_hops = reader.getCount(m_frameHops - 1);
+    m_energy = reader.getDouble();
+    m_brightness = reader.getDouble();
+    m_last = reader.getDouble();
+    for (int i = 0; i < 2; ++i) {
+        m_prevEnergy[i] = reader.getDouble();
+        m_prevBrightness[i] = reader.getDouble();
+    }
+}
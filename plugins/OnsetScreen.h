@@ -0,0 +1,75 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _ONSET_SCREEN_H_
+#define _ONSET_SCREEN_H_
+
+#include <aubio/aubio.h>
+#include <cstddef>
+
+#include "Checkpoint.h"
+
+/** Cheap time-domain screen for onset candidates
+
+  The input is cut into frames of a few hops, and the energy of each
+  frame and of its first difference, which stands in for its high
+  frequency content, compared with those of the two frames before. A
+  frame is a candidate when either rises by more than the threshold,
+  in dB, over the lower of the two, and its level is above the
+  silence threshold. This costs a few operations per sample, against
+  an FFT and a detection function per hop for aubio_onset_do(). */
+class OnsetScreen
+{
+public:
+    OnsetScreen();
+
+    void initialise(size_t stepSize, size_t frameHops,
+                    float threshold, float silence);
+    void reset();
+
+    size_t getFrameHops() const { return m_frameHops; }
+
+    /** take the stepSize samples of a hop; true if this completes a
+      frame, of the last getFrameHops() hops, that is a candidate */
+    bool push(const fvec_t *input);
+
+    void save(StateWriter &writer) const;
+    void restore(StateReader &reader);
+
+protected:
+    size_t m_stepSize;
+    size_t m_frameHops;
+    float m_threshold;
+    float m_silence;
+
+    size_t m_hops;          // hops into the current frame
+    double m_energy;        // of the current frame so far
+    double m_brightness;    // energy of its first difference so far
+    smpl_t m_last;          // last sample, for the first difference
+    double m_prevEnergy[2];
+    double m_prevBrightness[2];
+};
+
+#endif /* _ONSET_SCREEN_H_ */
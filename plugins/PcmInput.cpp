@@ -0,0 +1,184 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "PcmInput.h"
+
+#include <stdint.h>
+#include <cstring>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+// native loads, which the compiler turns into vector loads in the
+// conversion loops below
+static uint32_t
+get16(const unsigned char *p)
+{
+    uint16_t v;
+    memcpy(&v, p, 2);
+    return v;
+}
+
+static uint32_t
+get32(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+#else
+
+static uint32_t
+get16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t
+get32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+#endif
+
+// Sample decoders, from little-endian bytes to values in [-1, 1)
+
+struct Int16Sample {
+    enum { bytes = 2 };
+    static float get(const unsigned char *p) {
+        return (int16_t)get16(p) * (1.f / 32768.f);
+    }
+};
+
+struct Int24Sample {
+    enum { bytes = 3 };
+    static float get(const unsigned char *p) {
+        int32_t v = (int32_t)((p[0] << 8) | (p[1] << 16) |
+                              ((uint32_t)p[2] << 24));
+        return (v >> 8) * (1.f / 8388608.f);
+    }
+};
+
+struct Int32Sample {
+    enum { bytes = 4 };
+    static float get(const unsigned char *p) {
+        return (int32_t)get32(p) * (1.f / 2147483648.f);
+    }
+};
+
+struct Float32Sample {
+    enum { bytes = 4 };
+    static float get(const unsigned char *p) {
+        uint32_t w = get32(p);
+        float v;
+        memcpy(&v, &w, 4);
+        return v;
+    }
+};
+
+struct Float64Sample {
+    enum { bytes = 8 };
+    static double get(const unsigned char *p) {
+        uint64_t w = get32(p) | ((uint64_t)get32(p + 4) << 32);
+        double v;
+        memcpy(&v, &w, 8);
+        return v;
+    }
+};
+
+// Mono and stereo have loops of their own, with no inner loop over
+// channels, so that they vectorise
+template <class S, class T>
+static void
+convertFrames(const unsigned char *p, size_t frames, size_t channels,
+              T *out)
+{
+    if (channels == 1) {
+        for (size_t i = 0; i < frames; ++i) {
+            out[i] = S::get(p + i * S::bytes);
+        }
+        return;
+    }
+    if (channels == 2) {
+        for (size_t i = 0; i < frames; ++i) {
+            out[i] = (S::get(p + 2 * i * S::bytes) +
+                      S::get(p + (2 * i + 1) * S::bytes)) * 0.5f;
+        }
+        return;
+    }
+    float gain = 1.f / channels;
+    for (size_t i = 0; i < frames; ++i) {
+        T sum = 0;
+        for (size_t c = 0; c < channels; ++c) {
+            sum += S::get(p);
+            p += S::bytes;
+        }
+        out[i] = sum * gain;
+    }
+}
+
+template <class T>
+static void
+convert(const void *pcm, PcmFormat format, size_t channels, size_t frames,
+        T *out)
+{
+    const unsigned char *p = (const unsigned char *)pcm;
+    switch (format) {
+    case PcmInt16: convertFrames<Int16Sample>(p, frames, channels, out); break;
+    case PcmInt24: convertFrames<Int24Sample>(p, frames, channels, out); break;
+    case PcmInt32: convertFrames<Int32Sample>(p, frames, channels, out); break;
+    case PcmFloat32: convertFrames<Float32Sample>(p, frames, channels, out); break;
+    case PcmFloat64: convertFrames<Float64Sample>(p, frames, channels, out); break;
+    }
+}
+
+size_t
+getPcmSampleBytes(PcmFormat format)
+{
+    switch (format) {
+    case PcmInt16: return 2;
+    case PcmInt24: return 3;
+    case PcmInt32: return 4;
+    case PcmFloat32: return 4;
+    case PcmFloat64: return 8;
+    }
+    return 0;
+}
+
+void
+convertPcm(const void *pcm, PcmFormat format, size_t channels, size_t frames,
+           float *out)
+{
+    convert(pcm, format, channels, frames, out);
+}
+
+void
+convertPcm(const void *pcm, PcmFormat format, size_t channels, size_t frames,
+           double *out)
+{
+    convert(pcm, format, channels, frames, out);
+}
+
@@ -0,0 +1,76 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _PCM_INPUT_H_
+#define _PCM_INPUT_H_
+
+#include <vamp-sdk/Plugin.h>
+#include <aubio/aubio.h>
+#include <cstddef>
+
+/** Sample formats of interleaved PCM, all little-endian, as in WAV
+  files: 24-bit samples are packed in 3 bytes */
+enum PcmFormat {
+    PcmInt16,
+    PcmInt24,
+    PcmInt32,
+    PcmFloat32,
+    PcmFloat64
+};
+
+/** bytes taken by one sample of format */
+size_t getPcmSampleBytes(PcmFormat format);
+
+/** Convert frames of PCM in channels interleaved channels to mono
+  samples in [-1, 1), scaling integers and mixing the channels down
+  to their mean in the same pass. There are both float and double
+  versions, so that out can be the data of an fvec_t whatever the
+  precision of aubio. */
+void convertPcm(const void *pcm, PcmFormat format, size_t channels,
+                size_t frames, float *out);
+void convertPcm(const void *pcm, PcmFormat format, size_t channels,
+                size_t frames, double *out);
+
+/** A plugin that takes its input already converted to aubio samples
+
+  process() copies the first stepSize samples of each block, which are
+  all the plugins use, into an fvec_t of their own before analysing
+  them. processInput() analyses an fvec_t handed to it instead, so that
+  a host running several plugins at the same step size can convert
+  each step of its input once, straight from the PCM it has, and give
+  the same vector to all of them. */
+class PcmInput
+{
+public:
+    virtual ~PcmInput() { }
+
+    /** process the stepSize samples of input, those of the block
+      process() would have been given at timestamp; the plugin does not
+      keep input beyond the call */
+    virtual Vamp::Plugin::FeatureSet processInput(const fvec_t *input,
+                                                  Vamp::RealTime timestamp) = 0;
+};
+
+#endif /* _PCM_INPUT_H_ */
@@ -25,6 +25,8 @@
 
 #include <math.h>
 #include "Pitch.h"
+#include "AubioLock.h"
+#include "DenormalGuard.h"
 
 using std::string;
 using std::vector;
@@ -42,12 +44,14 @@ Pitch::Pitch(float inputSampleRate) :
     m_silence(-90),
     m_wrapRange(false),
     m_stepSize(0),
-    m_blockSize(0)
+    m_blockSize(0),
+    m_analysisRate(0)
 {
 }
 
 Pitch::~Pitch()
 {
+    AubioLock lock;
     if (m_pitchdet) del_aubio_pitch(m_pitchdet);
     if (m_ibuf) del_fvec(m_ibuf);
     if (m_obuf) del_fvec(m_obuf);
@@ -100,9 +104,15 @@ Pitch::initialise(size_t channels, size_t stepSize, size_t blockSize)
     m_stepSize = stepSize;
     m_blockSize = blockSize;
 
+    m_resampled.initialise(m_inputSampleRate, m_analysisRate,
+                           stepSize, blockSize);
+
     m_ibuf = new_fvec(stepSize);
     m_obuf = new_fvec(1);
 
+    m_history.initialise(getPvocHistoryHops(stepSize, blockSize) + 1 +
+                         m_resampled.getHistoryHops(), stepSize);
+
     reset();
 
     return true;
@@ -111,15 +121,19 @@ Pitch::initialise(size_t channels, size_t stepSize, size_t blockSize)
 void
 Pitch::reset()
 {
+    AubioLock lock;
     if (m_pitchdet) del_aubio_pitch(m_pitchdet);
 
     m_pitchdet = new_aubio_pitch
         (const_cast<char *>(getAubioNameForPitchType(m_pitchtype)),
-         m_blockSize,
-         m_stepSize,
-         lrintf(m_inputSampleRate));
+         m_resampled.getBlockSize(),
+         m_resampled.getStepSize(),
+         lrintf(m_resampled.getRate()));
 
     aubio_pitch_set_unit(m_pitchdet, const_cast<char *>("freq"));
+
+    m_history.reset();
+    m_resampled.reset();
 }
 
 size_t
@@ -199,6 +213,8 @@ Pitch::getParameterDescriptors() const
     desc.isQuantized = false;
     list.push_back(desc);
 
+    list.push_back(getAnalysisRateDescriptor(m_inputSampleRate));
+
     return list;
 }
 
@@ -215,6 +231,8 @@ Pitch::getParameter(std::string param) const
         return m_wrapRange ? 1.0 : 0.0;
     } else if (param == "silencethreshold") {
         return m_silence;
+    } else if (param == "analysisrate") {
+        return m_analysisRate;
     } else {
         return 0.0;
     }
@@ -239,6 +257,8 @@ Pitch::setParameter(std::string param, float value)
         m_wrapRange = (value > 0.5);
     } else if (param == "silencethreshold") {
         m_silence = value;
+    } else if (param == "analysisrate") {
+        m_analysisRate = value;
     }
 }
 
@@ -267,25 +287,53 @@ Pitch::getOutputDescriptors() const
 }
 
 Pitch::FeatureSet
-Pitch::process(const float *const *inputBuffers,
-               Vamp::RealTime timestamp)
+Pitch::process(const float *const *inputBuffers, Vamp::RealTime timestamp)
 {
-    FeatureSet returnFeatures;
+    for (size_t i = 0; i < m_stepSize; ++i) {
+        fvec_set_sample(m_ibuf, inputBuffers[0][i], i);
+    }
+    return processInput(m_ibuf, timestamp);
+}
+
+Pitch::FeatureSet
+Pitch::processInput(const fvec_t *input, Vamp::RealTime timestamp)
+{
+    DenormalGuard guard;
 
     if (m_stepSize == 0) {
         std::cerr << "Pitch::process: Pitch plugin not initialised" << std::endl;
-        return returnFeatures;
+        return FeatureSet();
     }
 
-    for (size_t i = 0; i < m_stepSize; ++i) {
-        fvec_set_sample(m_ibuf, inputBuffers[0][i], i);
+    m_history.push(input);
+
+    if (!m_resampled.isActive()) return analyse(input, timestamp);
+
+    m_resampled.push(input, timestamp);
+    return analyseResampled();
+}
+
+Pitch::FeatureSet
+Pitch::analyseResampled()
+{
+    FeatureSet returnFeatures;
+    Vamp::RealTime timestamp;
+    while (const fvec_t *input = m_resampled.next(timestamp)) {
+        appendFeatures(returnFeatures, analyse(input, timestamp));
     }
+    return returnFeatures;
+}
 
-    aubio_pitch_do(m_pitchdet, m_ibuf, m_obuf);
+Pitch::FeatureSet
+Pitch::analyse(const fvec_t *input, Vamp::RealTime timestamp)
+{
+    FeatureSet returnFeatures;
+
+    aubio_pitch_do(m_pitchdet, input, m_obuf);
     
     float freq = m_obuf->data[0];
 
-    bool silent = aubio_silence_detection(m_ibuf, m_silence);
+    bool silent = aubio_silence_detection(input, m_silence);
     if (silent) {
 //        std::cerr << "(silent)" << std::endl;
         return returnFeatures;
@@ -316,6 +364,54 @@ Pitch::process(const float *const *inputBuffers,
 Pitch::FeatureSet
 Pitch::getRemainingFeatures()
 {
-    return FeatureSet();
+    DenormalGuard guard;
+
+    if (!m_resampled.isActive()) return FeatureSet();
+
+    m_resampled.flush();
+    return analyseResampled();
+}
+
+string
+Pitch::saveState() const
+{
+    StateWriter writer;
+    writeStateHeader(writer, *this, m_inputSampleRate, m_stepSize, m_blockSize);
+    m_history.save(writer);
+    return writer.getData();
 }
 
+bool
+Pitch::restoreState(const string &state)
+{
+    if (!m_ibuf) {
+        cerr << "Pitch::restoreState: Pitch plugin not initialised" << endl;
+        return false;
+    }
+
+    reset();
+
+    StateReader reader(state);
+    if (!readStateHeader(reader, *this, m_inputSampleRate,
+                         m_stepSize, m_blockSize)) {
+        return false;
+    }
+
+    InputHistory history(m_history);
+    history.restore(reader);
+    if (!reader.isOK()) {
+        cerr << "Pitch::restoreState: invalid state" << endl;
+        return false;
+    }
+
+    history.replay(*this, m_blockSize, m_inputSampleRate);
+    m_history = history;
+
+    if (!reader.isAtEnd()) {
+        cerr << "Pitch::restoreState: invalid state" << endl;
+        reset();
+        return false;
+    }
+
+    return true;
+}
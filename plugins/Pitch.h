@@ -30,8 +30,11 @@
 #include <aubio/aubio.h>
 
 #include "Types.h"
+#include "Checkpoint.h"
+#include "PcmInput.h"
+#include "Resampler.h"
 
-class Pitch : public Vamp::Plugin
+class Pitch : public Vamp::Plugin, public Checkpointable, public PcmInput
 {
 public:
     Pitch(float inputSampleRate);
@@ -60,9 +63,13 @@ public:
 
     FeatureSet process(const float *const *inputBuffers,
                        Vamp::RealTime timestamp);
+    FeatureSet processInput(const fvec_t *input, Vamp::RealTime timestamp);
 
     FeatureSet getRemainingFeatures();
 
+    std::string saveState() const;
+    bool restoreState(const std::string &state);
+
 protected:
     fvec_t *m_ibuf;
     fvec_t *m_obuf;
@@ -75,6 +82,16 @@ protected:
 
     size_t m_stepSize;
     size_t m_blockSize;
+
+    // input kept for rebuilding the aubio objects in restoreState()
+    InputHistory m_history;
+
+    // input decimated to the analysis rate, when it is below the host's
+    float m_analysisRate;
+    ResampledInput m_resampled;
+
+    FeatureSet analyse(const fvec_t *input, Vamp::RealTime timestamp);
+    FeatureSet analyseResampled();
 };
 
 
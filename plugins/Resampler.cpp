@@ -0,0 +1,281 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "Resampler.h"
+
+#include <cmath>
+
+using std::vector;
+
+// zero crossings of the sinc on each side, at the lower of the rates
+static const double zeroCrossings = 16;
+
+// cutoff, as a fraction of the lower Nyquist frequency
+static const double rolloff = 0.9;
+
+// Kaiser window shape, for about 80dB of stopband attenuation
+static const double kaiserBeta = 8;
+
+static size_t
+gcd(size_t a, size_t b)
+{
+    while (b != 0) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// modified Bessel function of the first kind, order 0
+static double
+besselI0(double x)
+{
+    double sum = 1, term = 1;
+    for (int k = 1; k < 50; ++k) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+Resampler::Resampler() :
+    m_up(1),
+    m_down(1),
+    m_halfWidth(1),
+    m_taps(2),
+    m_bufferStart(0),
+    m_centre(0),
+    m_phase(0)
+{
+}
+
+void
+Resampler::initialise(unsigned int sourceRate, unsigned int targetRate)
+{
+    size_t g = gcd(sourceRate, targetRate);
+    m_up = targetRate / g;
+    m_down = sourceRate / g;
+
+    // cutoff in cycles per input sample, and the half width of the
+    // filter in input samples that holds zeroCrossings of its sinc
+    double ratio = (double)m_up / m_down;
+    double cutoff = 0.5 * rolloff * (ratio < 1 ? ratio : 1);
+    double halfWidth = zeroCrossings / (2 * cutoff);
+    m_halfWidth = (size_t)ceil(halfWidth);
+    m_taps = 2 * m_halfWidth;
+
+    // phase p is for outputs p / m_up of an input sample past the
+    // centre sample, tap k for input sample k - m_halfWidth + 1 from it
+    m_filter.resize(m_up * m_taps);
+    double norm = besselI0(kaiserBeta);
+    for (size_t p = 0; p < m_up; ++p) {
+        smpl_t *h = &m_filter[p * m_taps];
+        double sum = 0;
+        for (size_t k = 0; k < m_taps; ++k) {
+            double x = (double)p / m_up - ((double)k - (m_halfWidth - 1));
+            double w = x / halfWidth;
+            double c = 0;
+            if (fabs(w) < 1) {
+                double y = 2 * cutoff * x;
+                c = 2 * cutoff * (y == 0 ? 1 : sin(M_PI * y) / (M_PI * y));
+                c *= besselI0(kaiserBeta * sqrt(1 - w * w)) / norm;
+            }
+            h[k] = c;
+            sum += c;
+        }
+        // unit gain at DC for every phase
+        for (size_t k = 0; k < m_taps; ++k) {
+            h[k] /= sum;
+        }
+    }
+
+    reset();
+}
+
+void
+Resampler::reset()
+{
+    m_buffer.assign(m_halfWidth - 1, 0);
+    m_bufferStart = 0;
+    m_centre = 0;
+    m_phase = 0;
+}
+
+void
+Resampler::process(const smpl_t *input, size_t count, vector<smpl_t> &out)
+{
+    m_buffer.insert(m_buffer.end(), input, input + count);
+
+    while (m_centre - m_bufferStart + m_taps <= m_buffer.size()) {
+        const smpl_t *x = &m_buffer[m_centre - m_bufferStart];
+        const smpl_t *h = &m_filter[m_phase * m_taps];
+        smpl_t sum = 0;
+        for (size_t k = 0; k < m_taps; ++k) {
+            sum += h[k] * x[k];
+        }
+        out.push_back(sum);
+
+        m_phase += m_down;
+        m_centre += m_phase / m_up;
+        m_phase %= m_up;
+    }
+
+    // drop the input no output needs any more, once in a while
+    size_t used = m_centre - m_bufferStart;
+    if (used > m_buffer.size()) used = m_buffer.size();
+    if (used > 0 && used * 2 >= m_buffer.size()) {
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + used);
+        m_bufferStart += used;
+    }
+}
+
+ResampledInput::ResampledInput() :
+    m_active(false),
+    m_rate(0),
+    m_hostStepSize(0),
+    m_stepSize(0),
+    m_blockSize(0),
+    m_outputRead(0)
+{
+    m_hop.length = 0;
+    m_hop.data = 0;
+}
+
+void
+ResampledInput::initialise(float hostRate, float rate, size_t stepSize,
+                           size_t blockSize)
+{
+    size_t hostRateInt = lrintf(hostRate);
+
+    m_active = false;
+    m_rate = hostRate;
+    m_hostStepSize = stepSize;
+    m_stepSize = stepSize;
+    m_blockSize = blockSize;
+
+    if (rate > 0 && rate < hostRate && stepSize > 0 && hostRateInt > 0) {
+
+        // a hop of step samples at the analysis rate lasts as long as
+        // one of stepSize at the host rate if rate = hostRate * step /
+        // stepSize, a whole number if step is a multiple of q
+        size_t g = gcd(stepSize, hostRateInt);
+        size_t q = stepSize / g;
+        size_t step = (size_t)ceil(stepSize * (double)rate / hostRateInt);
+        step = (step + q - 1) / q * q;
+
+        if (step < stepSize) {
+            m_active = true;
+            m_stepSize = step;
+            m_rate = (float)(hostRateInt / g) * (step / q);
+
+            // scale the block likewise, rounding up to a power of two
+            // if it was one, so that it spans at least as long
+            double exact = blockSize * (double)step / stepSize;
+            size_t block = (size_t)ceil(exact);
+            if (blockSize > 0 && (blockSize & (blockSize - 1)) == 0) {
+                block = 1;
+                while (block < exact) block *= 2;
+            }
+            m_blockSize = (block > step ? block : step);
+
+            m_resampler.initialise(hostRateInt, (unsigned int)m_rate);
+        }
+    }
+
+    m_hop.length = m_stepSize;
+    reset();
+}
+
+void
+ResampledInput::reset()
+{
+    m_resampler.reset();
+    m_output.clear();
+    m_outputRead = 0;
+    m_timestamps.clear();
+}
+
+size_t
+ResampledInput::getHistoryHops() const
+{
+    if (!m_active) return 0;
+    return (2 * m_resampler.getLatency() + m_hostStepSize - 1) /
+        m_hostStepSize + 1;
+}
+
+void
+ResampledInput::push(const fvec_t *input, Vamp::RealTime timestamp)
+{
+    if (m_outputRead > 0) {
+        m_output.erase(m_output.begin(), m_output.begin() + m_outputRead);
+        m_outputRead = 0;
+    }
+    m_timestamps.push_back(timestamp);
+    m_resampler.process(input->data, m_hostStepSize, m_output);
+}
+
+void
+ResampledInput::flush()
+{
+    if (m_outputRead > 0) {
+        m_output.erase(m_output.begin(), m_output.begin() + m_outputRead);
+        m_outputRead = 0;
+    }
+    vector<smpl_t> zeros(m_hostStepSize, 0);
+    while (m_output.size() < m_timestamps.size() * m_stepSize) {
+        m_resampler.process(&zeros[0], m_hostStepSize, m_output);
+    }
+}
+
+const fvec_t *
+ResampledInput::next(Vamp::RealTime &timestamp)
+{
+    if (m_timestamps.empty() ||
+        m_output.size() - m_outputRead < m_stepSize) {
+        return 0;
+    }
+    m_hop.data = &m_output[m_outputRead];
+    m_outputRead += m_stepSize;
+    timestamp = m_timestamps.front();
+    m_timestamps.pop_front();
+    return &m_hop;
+}
+
+Vamp::Plugin::ParameterDescriptor
+getAnalysisRateDescriptor(float inputSampleRate)
+{
+    Vamp::Plugin::ParameterDescriptor desc;
+    desc.identifier = "analysisrate";
+    desc.name = "Analysis Sample Rate";
+    desc.description = "Low-pass filter and decimate the input to this rate before analysing it, 0 to analyse at the input rate; rounded up so that a step is a whole number of samples at both rates";
+    desc.minValue = 0;
+    desc.maxValue = inputSampleRate;
+    desc.defaultValue = 0;
+    desc.unit = "Hz";
+    desc.isQuantized = false;
+    return desc;
+}
@@ -0,0 +1,135 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _RESAMPLER_H_
+#define _RESAMPLER_H_
+
+#include <vamp-sdk/Plugin.h>
+#include <aubio/aubio.h>
+#include <deque>
+#include <vector>
+#include <cstddef>
+
+/** Polyphase low-pass resampler between two integer sample rates
+
+  The rates are reduced to a ratio up/down, and each output sample is
+  computed from a Kaiser-windowed sinc centred on its own time, using
+  the one of up precomputed phases of the filter that matches the
+  fraction of an input sample it falls at. Output sample n is at time
+  n * down / up in input samples exactly, with no delay; in exchange,
+  it is only produced once the input has reached getLatency() samples
+  past that time. The cutoff is just below the lower of the two
+  Nyquist frequencies. */
+class Resampler
+{
+public:
+    Resampler();
+
+    void initialise(unsigned int sourceRate, unsigned int targetRate);
+    void reset();
+
+    /** input samples needed beyond the time of an output sample */
+    size_t getLatency() const { return m_halfWidth; }
+
+    /** take count input samples, appending the output samples they
+      complete to out */
+    void process(const smpl_t *input, size_t count, std::vector<smpl_t> &out);
+
+protected:
+    size_t m_up;
+    size_t m_down;
+    size_t m_halfWidth;             // filter half width, in input samples
+    size_t m_taps;                  // 2 * m_halfWidth taps per phase
+    std::vector<smpl_t> m_filter;   // m_up phases of m_taps coefficients
+
+    std::vector<smpl_t> m_buffer;   // input, from m_bufferStart
+    size_t m_bufferStart;           // input index of m_buffer[0], plus
+                                    // m_halfWidth - 1 leading zeros
+    size_t m_centre;                // input sample before the next output
+    size_t m_phase;                 // its fraction of a sample, in 1/m_up
+};
+
+/** Input of a plugin analysing at a lower rate than the host's
+
+  The host's hops of stepSize samples are low-pass filtered and
+  decimated to the analysis rate, and cut into hops of getStepSize()
+  samples there. The analysis rate is rounded up so that the two hops
+  last exactly as long, so analysis hop k covers the same time as host
+  hop k and takes its timestamp. Hops come out a few host hops late,
+  because of the lookahead of the filter; flush() pads the input with
+  zeros to bring out the last ones. */
+class ResampledInput
+{
+public:
+    ResampledInput();
+
+    /** analyse at rate, or at hostRate if rate is 0 or not below it,
+      in which case the input is not touched at all */
+    void initialise(float hostRate, float rate, size_t stepSize,
+                    size_t blockSize);
+    void reset();
+
+    bool isActive() const { return m_active; }
+
+    /** the analysis rate, step and block sizes */
+    float getRate() const { return m_rate; }
+    size_t getStepSize() const { return m_stepSize; }
+    size_t getBlockSize() const { return m_blockSize; }
+
+    /** host hops of input to replay, on top of those the analysis
+      itself needs, to rebuild the filter state in restoreState() */
+    size_t getHistoryHops() const;
+
+    /** queue the stepSize samples of a host hop */
+    void push(const fvec_t *input, Vamp::RealTime timestamp);
+
+    /** pad the input so that every host hop pushed has its analysis
+      hop; call at the end of the input */
+    void flush();
+
+    /** the next analysis hop, valid until the next push() or flush(),
+      or 0 if there is none yet; timestamp is set to that of its host
+      hop */
+    const fvec_t *next(Vamp::RealTime &timestamp);
+
+protected:
+    bool m_active;
+    float m_rate;
+    size_t m_hostStepSize;
+    size_t m_stepSize;
+    size_t m_blockSize;
+
+    Resampler m_resampler;
+    std::vector<smpl_t> m_output;   // resampled input not yet consumed
+    size_t m_outputRead;
+    std::deque<Vamp::RealTime> m_timestamps;  // of host hops pending
+    fvec_t m_hop;
+};
+
+/** The "analysisrate" parameter of the plugins taking a ResampledInput */
+Vamp::Plugin::ParameterDescriptor
+getAnalysisRateDescriptor(float inputSampleRate);
+
+#endif /* _RESAMPLER_H_ */
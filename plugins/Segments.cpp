@@ -0,0 +1,568 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <math.h>
+#include "Segments.h"
+#include "AubioLock.h"
+#include "DenormalGuard.h"
+
+using std::string;
+using std::vector;
+using std::cerr;
+using std::endl;
+
+Segments::Segments(float inputSampleRate) :
+    Plugin(inputSampleRate),
+    m_ibuf(0),      // input fvec_t, set in initialise
+    m_onset(0),     // onset fvec_t, set in initialise
+    m_onsetdet(0),  // aubio_onset_t, set in reset
+    m_spectrum(0),  // MagnitudeSpectrum, set in reset
+    m_ispec(0),     // cvec_t, set in initialise
+    m_melvec(0),    // filterbank output fvec_t, set in initialise
+    m_onsettype(OnsetDefault),
+    m_threshold(0.3),
+    m_silence(-90),
+    m_minioi(4),
+    m_nfilters(40), // parameter
+    m_ncoeffs(13),  // parameter
+    m_enabledOutputs(3),
+    m_stepSize(0),  // host parameter
+    m_blockSize(0), // host parameter
+    m_frameOffset(0),
+    m_maxPending(0),
+    m_pendingStart(0),
+    m_pendingCount(0),
+    m_count(0),
+    m_haveSegment(false)
+{
+}
+
+Segments::~Segments()
+{
+    AubioLock lock;
+    if (m_onsetdet) del_aubio_onset(m_onsetdet);
+    delete m_spectrum;
+    if (m_ibuf) del_fvec(m_ibuf);
+    if (m_onset) del_fvec(m_onset);
+    if (m_ispec) del_cvec(m_ispec);
+    if (m_melvec) del_fvec(m_melvec);
+}
+
+string
+Segments::getIdentifier() const
+{
+    return "aubiosegments";
+}
+
+string
+Segments::getName() const
+{
+    return "Aubio Onset Segment Features";
+}
+
+string
+Segments::getDescription() const
+{
+    return "Average MFCCs and mel band energies over each segment between two onsets";
+}
+
+string
+Segments::getMaker() const
+{
+    return "Paul Brossier";
+}
+
+int
+Segments::getPluginVersion() const
+{
+    return 2;
+}
+
+string
+Segments::getCopyright() const
+{
+    return "GPL";
+}
+
+bool
+Segments::initialise(size_t channels, size_t stepSize, size_t blockSize)
+{
+    if (channels != 1) {
+        std::cerr << "Segments::initialise: channels must be 1" << std::endl;
+        return false;
+    }
+
+    if (m_ncoeffs > m_nfilters) {
+        std::cerr << "Segments::initialise: number of coefficients must not exceed number of filters" << std::endl;
+        return false;
+    }
+
+    // the same bands and coefficients as the Mfcc and MelEnergy
+    // plugins with their default frequency range
+    if (!m_melbank.initialise(m_nfilters, blockSize, m_inputSampleRate,
+                              MelFilterbank::defaultMinFreq,
+                              MelFilterbank::defaultMaxFreq, true)) {
+        return false;
+    }
+    m_cepstrum.initialise(m_nfilters, m_ncoeffs);
+
+    m_stepSize = stepSize;
+    m_blockSize = blockSize;
+
+    m_ibuf = new_fvec(stepSize);
+    m_onset = new_fvec(1);
+    m_ispec = new_cvec(blockSize);
+    m_melvec = new_fvec(m_nfilters);
+
+    m_history.initialise(getOnsetHistoryHops(stepSize, blockSize, m_minioi,
+                                             m_inputSampleRate),
+                         stepSize);
+
+    reset();
+
+    // aubio reports an onset up to its delay, and half a hop of peak
+    // interpolation, before the frame that detects it: keep the frames
+    // of those hops and of the current one to assign them after the
+    // fact. The minimum interval only drops onsets, it never makes one
+    // come out later.
+    size_t delay = aubio_onset_get_delay(m_onsetdet);
+    m_maxPending = (delay + m_stepSize - 1) / m_stepSize + 2;
+    m_pending.assign(m_maxPending * getFrameSize(), 0.f);
+    m_pendingTimes.assign(m_maxPending, Vamp::RealTime::zeroTime);
+    m_sum.assign(getFrameSize(), 0.);
+
+    return true;
+}
+
+void
+Segments::reset()
+{
+    AubioLock lock;
+    if (m_onsetdet) del_aubio_onset(m_onsetdet);
+    delete m_spectrum;
+
+    m_onsetdet = new_aubio_onset
+        (const_cast<char *>(getAubioNameForOnsetType(m_onsettype)),
+         m_blockSize,
+         m_stepSize,
+         lrintf(m_inputSampleRate));
+
+    aubio_onset_set_threshold(m_onsetdet, m_threshold);
+    aubio_onset_set_silence(m_onsetdet, m_silence);
+    aubio_onset_set_minioi(m_onsetdet, m_minioi);
+
+    m_spectrum = new MagnitudeSpectrum(m_blockSize, m_stepSize);
+
+    m_pendingStart = 0;
+    m_pendingCount = 0;
+    m_sum.assign(m_sum.size(), 0.);
+    m_count = 0;
+    m_haveSegment = false;
+    m_lastTimestamp = Vamp::RealTime::zeroTime;
+
+    m_history.reset();
+    m_frameOffset = 0;
+}
+
+size_t
+Segments::getPreferredStepSize() const
+{
+    return 256;
+}
+
+size_t
+Segments::getPreferredBlockSize() const
+{
+    return 2 * getPreferredStepSize();
+}
+
+Segments::ParameterList
+Segments::getParameterDescriptors() const
+{
+    ParameterList list;
+
+    ParameterDescriptor desc;
+    desc.identifier = "onsettype";
+    desc.name = "Onset Detection Function Type";
+    desc.description = "Type of onset detection function to use";
+    desc.minValue = 0;
+    desc.maxValue = 8;
+    desc.defaultValue = (int)OnsetDefault;
+    desc.isQuantized = true;
+    desc.quantizeStep = 1;
+    desc.valueNames.push_back("Energy Based");
+    desc.valueNames.push_back("Spectral Difference");
+    desc.valueNames.push_back("High-Frequency Content");
+    desc.valueNames.push_back("Complex Domain");
+    desc.valueNames.push_back("Phase Deviation");
+    desc.valueNames.push_back("Kullback-Liebler");
+    desc.valueNames.push_back("Modified Kullback-Liebler");
+    desc.valueNames.push_back("Spectral Flux");
+    desc.valueNames.push_back("Default");
+    list.push_back(desc);
+
+    desc = ParameterDescriptor();
+    desc.identifier = "peakpickthreshold";
+    desc.name = "Peak Picker Threshold";
+    desc.description = "Threshold used for peak picking, the higher the more detections";
+    desc.minValue = 0;
+    desc.maxValue = 1;
+    desc.defaultValue = 0.3;
+    desc.isQuantized = false;
+    list.push_back(desc);
+
+    desc = ParameterDescriptor();
+    desc.identifier = "silencethreshold";
+    desc.name = "Silence Threshold";
+    desc.description = "Silence threshold, the higher the least detection";
+    desc.minValue = -120;
+    desc.maxValue = 0;
+    desc.defaultValue = -90;
+    desc.unit = "dB";
+    desc.isQuantized = false;
+    list.push_back(desc);
+
+    desc = ParameterDescriptor();
+    desc.identifier = "minioi";
+    desc.name = "Minimum Inter-Onset Interval";
+    desc.description = "Time interval below which two consecutive onsets should be merged";
+    desc.minValue = 0;
+    desc.maxValue = 40;
+    desc.defaultValue = 4;
+    desc.unit = "ms";
+    desc.isQuantized = true;
+    desc.quantizeStep = 1;
+    list.push_back(desc);
+
+    desc = ParameterDescriptor();
+    desc.identifier = "nfilters";
+    desc.name = "Number of filters";
+    desc.description = "Size of mel filterbank used to compute MFCCs and band energies";
+    desc.minValue = 1;
+    desc.maxValue = 256;
+    desc.defaultValue = 40;
+    desc.isQuantized = true;
+    desc.quantizeStep = 1;
+    list.push_back(desc);
+
+    desc = ParameterDescriptor();
+    desc.identifier = "ncoeffs";
+    desc.name = "Number of coefficients";
+    desc.description = "Number of MFCC coefficients to compute";
+    desc.minValue = 1;
+    desc.maxValue = 100;
+    desc.defaultValue = 13;
+    desc.isQuantized = true;
+    desc.quantizeStep = 1;
+    list.push_back(desc);
+
+    list.push_back(getEnabledOutputsDescriptor(getOutputDescriptors()));
+
+    return list;
+}
+
+float
+Segments::getParameter(std::string param) const
+{
+    if (param == "onsettype") {
+        return m_onsettype;
+    } else if (param == "peakpickthreshold") {
+        return m_threshold;
+    } else if (param == "silencethreshold") {
+        return m_silence;
+    } else if (param == "minioi") {
+        return m_minioi;
+    } else if (param == "nfilters") {
+        return m_nfilters;
+    } else if (param == "ncoeffs") {
+        return m_ncoeffs;
+    } else if (param == "enabledoutputs") {
+        return m_enabledOutputs;
+    } else {
+        return 0.0;
+    }
+}
+
+void
+Segments::setParameter(std::string param, float value)
+{
+    if (param == "onsettype") {
+        switch (lrintf(value)) {
+        case 0: m_onsettype = OnsetEnergy; break;
+        case 1: m_onsettype = OnsetSpecDiff; break;
+        case 2: m_onsettype = OnsetHFC; break;
+        case 3: m_onsettype = OnsetComplex; break;
+        case 4: m_onsettype = OnsetPhase; break;
+        case 5: m_onsettype = OnsetKL; break;
+        case 6: m_onsettype = OnsetMKL; break;
+        case 7: m_onsettype = OnsetSpecFlux; break;
+        case 8: m_onsettype = OnsetDefault; break;
+        }
+    } else if (param == "peakpickthreshold") {
+        m_threshold = value;
+    } else if (param == "silencethreshold") {
+        m_silence = value;
+    } else if (param == "minioi") {
+        m_minioi = value;
+    } else if (param == "nfilters") {
+        m_nfilters = lrintf(value);
+    } else if (param == "ncoeffs") {
+        m_ncoeffs = lrintf(value);
+    } else if (param == "enabledoutputs") {
+        m_enabledOutputs = getEnabledOutputsMask
+            (value, getOutputDescriptors().size());
+    }
+}
+
+Segments::OutputList
+Segments::getOutputDescriptors() const
+{
+    OutputList list;
+
+    OutputDescriptor d;
+    d.identifier = "mfcc";
+    d.name = "Segment Mel-Frequency Cepstrum Coefficients";
+    d.description = "Mean MFCCs over each segment between two onsets";
+    d.unit = "";
+    d.hasFixedBinCount = true;
+    d.binCount = m_ncoeffs;
+    d.hasKnownExtents = false;
+    d.isQuantized = false;
+    d.sampleType = OutputDescriptor::VariableSampleRate;
+    d.sampleRate = 0;
+    d.hasDuration = true;
+    list.push_back(d);
+
+    d.identifier = "melenergy";
+    d.name = "Segment Mel-Frequency Energy per band";
+    d.description = "Mean energy in each Mel-Frequency Band over each segment between two onsets";
+    d.binCount = m_nfilters;
+    list.push_back(d);
+
+    return list;
+}
+
+void
+Segments::accumulate(size_t pendingIndex)
+{
+    const float *frame = &m_pending[pendingIndex * getFrameSize()];
+    if (!m_haveSegment) {
+        m_segmentStart = m_pendingTimes[pendingIndex];
+        m_haveSegment = true;
+    }
+    for (size_t i = 0; i < getFrameSize(); ++i) {
+        m_sum[i] += frame[i];
+    }
+    ++m_count;
+}
+
+void
+Segments::popPending()
+{
+    accumulate(m_pendingStart);
+    m_pendingStart = (m_pendingStart + 1) % m_maxPending;
+    --m_pendingCount;
+}
+
+void
+Segments::pushSegment(FeatureSet &fs, const Vamp::RealTime &endTime)
+{
+    if (!m_haveSegment || m_count == 0) {
+        m_haveSegment = false;
+        return;
+    }
+
+    Feature feature;
+    feature.hasTimestamp = true;
+    feature.timestamp = m_segmentStart;
+    feature.hasDuration = true;
+    feature.duration = endTime - m_segmentStart;
+
+    if (isOutputEnabled(m_enabledOutputs, 0)) {
+        for (size_t i = 0; i < m_ncoeffs; ++i) {
+            feature.values.push_back(m_sum[i] / m_count);
+        }
+        fs[0].push_back(feature);
+        feature.values.clear();
+    }
+
+    if (isOutputEnabled(m_enabledOutputs, 1)) {
+        for (size_t i = 0; i < m_nfilters; ++i) {
+            feature.values.push_back(m_sum[m_ncoeffs + i] / m_count);
+        }
+        fs[1].push_back(feature);
+    }
+
+    m_sum.assign(m_sum.size(), 0.);
+    m_count = 0;
+    m_haveSegment = false;
+}
+
+Segments::FeatureSet
+Segments::process(const float *const *inputBuffers, Vamp::RealTime timestamp)
+{
+    for (size_t i = 0; i < m_stepSize; ++i) {
+        fvec_set_sample(m_ibuf, inputBuffers[0][i], i);
+    }
+    return processInput(m_ibuf, timestamp);
+}
+
+Segments::FeatureSet
+Segments::processInput(const fvec_t *input, Vamp::RealTime timestamp)
+{
+    DenormalGuard guard;
+
+    FeatureSet returnFeatures;
+
+    if (m_stepSize == 0) {
+        std::cerr << "Segments::process: Segments plugin not initialised" << std::endl;
+        return returnFeatures;
+    }
+
+    m_history.push(input);
+
+    aubio_onset_do(m_onsetdet, input, m_onset);
+    m_spectrum->process(input, m_ispec);
+
+    if (m_pendingCount == m_maxPending) popPending();
+
+    size_t index = (m_pendingStart + m_pendingCount) % m_maxPending;
+    float *frame = &m_pending[index * getFrameSize()];
+    m_pendingTimes[index] = timestamp;
+    ++m_pendingCount;
+
+    m_melbank.process(m_ispec, m_melvec);
+    for (size_t i = 0; i < m_nfilters; ++i) {
+        frame[m_ncoeffs + i] = m_melvec->data[i];
+    }
+    if (isOutputEnabled(m_enabledOutputs, 0)) {
+        m_cepstrum.process(m_melvec->data, frame);
+    }
+
+    if (m_onset->data[0]) {
+        // frames before the onset close the current segment, the
+        // others are left pending for the new one
+        Vamp::RealTime onsetTime =
+            getLastOnsetTime(m_onsetdet, m_frameOffset, m_inputSampleRate);
+        while (m_pendingCount > 0 &&
+               m_pendingTimes[m_pendingStart] < onsetTime) {
+            popPending();
+        }
+        pushSegment(returnFeatures, onsetTime);
+        m_segmentStart = onsetTime;
+        m_haveSegment = true;
+    }
+
+    m_lastTimestamp = timestamp;
+    return returnFeatures;
+}
+
+Segments::FeatureSet
+Segments::getRemainingFeatures()
+{
+    DenormalGuard guard;
+
+    FeatureSet returnFeatures;
+    while (m_pendingCount > 0) popPending();
+    pushSegment(returnFeatures, m_lastTimestamp +
+                Vamp::RealTime::frame2RealTime
+                (m_stepSize, lrintf(m_inputSampleRate)));
+    return returnFeatures;
+}
+
+string
+Segments::saveState() const
+{
+    StateWriter writer;
+    writeStateHeader(writer, *this, m_inputSampleRate, m_stepSize, m_blockSize);
+    m_history.save(writer);
+    writer.putSize(m_pendingStart);
+    writer.putSize(m_pendingCount);
+    writer.putFloats(m_pending);
+    writer.putRealTimes(m_pendingTimes);
+    writer.putDoubles(m_sum);
+    writer.putSize(m_count);
+    writer.putBool(m_haveSegment);
+    writer.putRealTime(m_segmentStart);
+    writer.putRealTime(m_lastTimestamp);
+    return writer.getData();
+}
+
+bool
+Segments::restoreState(const string &state)
+{
+    if (!m_ibuf) {
+        cerr << "Segments::restoreState: Segments plugin not initialised" << endl;
+        return false;
+    }
+
+    reset();
+
+    if (!isOnsetMemoryBounded(m_onsettype)) {
+        cerr << "Segments::restoreState: the " << getAubioNameForOnsetType(m_onsettype)
+             << " onset function is whitened over the whole input and cannot"
+             << " be rebuilt exactly, so analyses using it cannot be resumed"
+             << endl;
+        return false;
+    }
+
+    StateReader reader(state);
+    if (!readStateHeader(reader, *this, m_inputSampleRate,
+                         m_stepSize, m_blockSize)) {
+        return false;
+    }
+
+    InputHistory history(m_history);
+    history.restore(reader);
+    if (!reader.isOK()) {
+        cerr << "Segments::restoreState: invalid state" << endl;
+        return false;
+    }
+
+    m_frameOffset = history.getStartFrame();
+    history.replay(*this, m_blockSize, m_inputSampleRate);
+    m_history = history;
+
+    m_pendingStart = reader.getSize();
+    m_pendingCount = reader.getSize();
+    if (m_pendingStart >= m_maxPending || m_pendingCount > m_maxPending) {
+        reader.fail();
+    }
+    reader.getFloats(m_pending, m_maxPending * getFrameSize());
+    reader.getRealTimes(m_pendingTimes, m_maxPending);
+    reader.getDoubles(m_sum, getFrameSize());
+    m_count = reader.getSize();
+    m_haveSegment = reader.getBool();
+    m_segmentStart = reader.getRealTime();
+    m_lastTimestamp = reader.getRealTime();
+
+    if (!reader.isAtEnd()) {
+        cerr << "Segments::restoreState: invalid state" << endl;
+        reset();
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,129 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _SEGMENTS_PLUGIN_H_
+#define _SEGMENTS_PLUGIN_H_
+
+#include <vamp-sdk/Plugin.h>
+#include <aubio/aubio.h>
+
+#include "Types.h"
+#include "Checkpoint.h"
+#include "PcmInput.h"
+#include "MagnitudeSpectrum.h"
+#include "MelFilterbank.h"
+#include "MelCepstrum.h"
+
+/** Onset detection and spectral features in a single pass
+
+  Runs an onset detector alongside MFCC and mel band energy extraction,
+  and returns the mean feature vectors over each segment between two
+  consecutive onsets. Frames are held back by the onset detection delay,
+  so that each one is accumulated into the segment it belongs to.
+
+*/
+class Segments : public Vamp::Plugin, public Checkpointable, public PcmInput
+{
+public:
+    Segments(float inputSampleRate);
+    virtual ~Segments();
+
+    bool initialise(size_t channels, size_t stepSize, size_t blockSize);
+    void reset();
+
+    InputDomain getInputDomain() const { return TimeDomain; }
+
+    std::string getIdentifier() const;
+    std::string getName() const;
+    std::string getDescription() const;
+    std::string getMaker() const;
+    int getPluginVersion() const;
+    std::string getCopyright() const;
+
+    ParameterList getParameterDescriptors() const;
+    float getParameter(std::string) const;
+    void setParameter(std::string, float);
+
+    size_t getPreferredStepSize() const;
+    size_t getPreferredBlockSize() const;
+
+    OutputList getOutputDescriptors() const;
+
+    FeatureSet process(const float *const *inputBuffers,
+                       Vamp::RealTime timestamp);
+    FeatureSet processInput(const fvec_t *input, Vamp::RealTime timestamp);
+
+    FeatureSet getRemainingFeatures();
+
+    std::string saveState() const;
+    bool restoreState(const std::string &state);
+
+protected:
+    fvec_t *m_ibuf;
+    fvec_t *m_onset;
+    aubio_onset_t *m_onsetdet;
+    MagnitudeSpectrum *m_spectrum;
+    cvec_t *m_ispec;
+    MelFilterbank m_melbank;
+    MelCepstrum m_cepstrum;
+    fvec_t *m_melvec;
+
+    OnsetType m_onsettype;
+    float m_threshold;
+    float m_silence;
+    float m_minioi;
+    size_t m_nfilters;
+    size_t m_ncoeffs;
+    unsigned int m_enabledOutputs;
+
+    size_t m_stepSize;
+    size_t m_blockSize;
+
+    // input kept for rebuilding the aubio objects in restoreState()
+    InputHistory m_history;
+    size_t m_frameOffset; // first frame given to m_onsetdet
+
+    // frames not yet assigned to a segment, in a ring of m_maxPending
+    size_t m_maxPending;
+    size_t m_pendingStart;
+    size_t m_pendingCount;
+    std::vector<float> m_pending;
+    std::vector<Vamp::RealTime> m_pendingTimes;
+
+    // sum of the frames of the current segment
+    std::vector<double> m_sum;
+    size_t m_count;
+    bool m_haveSegment;
+    Vamp::RealTime m_segmentStart;
+    Vamp::RealTime m_lastTimestamp;
+
+    size_t getFrameSize() const { return m_ncoeffs + m_nfilters; }
+    void accumulate(size_t pendingIndex);
+    void popPending();
+    void pushSegment(FeatureSet &, const Vamp::RealTime &);
+};
+
+
+#endif /* _SEGMENTS_PLUGIN_H_ */
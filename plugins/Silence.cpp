@@ -24,7 +24,9 @@
 */
 
 #include <math.h>
+#include <algorithm>
 #include "Silence.h"
+#include "DenormalGuard.h"
 
 using std::string;
 using std::vector;
@@ -36,6 +38,7 @@ Silence::Silence(float inputSampleRate) :
     m_ibuf(0),
     m_pbuf(0),
     m_threshold(-80),
+    m_enabledOutputs(7),
     m_prevSilent(false),
     m_first(true)
 {
@@ -74,7 +77,7 @@ Silence::getMaker() const
 int
 Silence::getPluginVersion() const
 {
-    return 4;
+    return 5;
 }
 
 string
@@ -135,6 +138,8 @@ Silence::getParameterDescriptors() const
     desc.isQuantized = false;
     list.push_back(desc);
 
+    list.push_back(getEnabledOutputsDescriptor(getOutputDescriptors()));
+
     return list;
 }
 
@@ -143,6 +148,8 @@ Silence::getParameter(std::string param) const
 {
     if (param == "silencethreshold") {
         return m_threshold;
+    } else if (param == "enabledoutputs") {
+        return m_enabledOutputs;
     } else {
         return 0.0;
     }
@@ -153,6 +160,9 @@ Silence::setParameter(std::string param, float value)
 {
     if (param == "silencethreshold") {
         m_threshold = value;
+    } else if (param == "enabledoutputs") {
+        m_enabledOutputs = getEnabledOutputsMask
+            (value, getOutputDescriptors().size());
     }
 }
 
@@ -203,14 +213,20 @@ Silence::getOutputDescriptors() const
 }
 
 Silence::FeatureSet
-Silence::process(const float *const *inputBuffers,
-                 Vamp::RealTime timestamp)
+Silence::process(const float *const *inputBuffers, Vamp::RealTime timestamp)
 {
     for (size_t i = 0; i < m_stepSize; ++i) {
         fvec_set_sample(m_ibuf, inputBuffers[0][i], i);
     }
+    return processInput(m_ibuf, timestamp);
+}
+
+Silence::FeatureSet
+Silence::processInput(const fvec_t *input, Vamp::RealTime timestamp)
+{
+    DenormalGuard guard;
 
-    bool silent = aubio_silence_detection(m_ibuf, m_threshold);
+    bool silent = aubio_silence_detection(input, m_threshold);
     FeatureSet returnFeatures;
 
     if (m_first || m_prevSilent != silent) {
@@ -228,8 +244,8 @@ Silence::process(const float *const *inputBuffers,
             fvec_t vec;
             vec.length = incr * 4;
             
-            for (size_t i = 0; i < m_stepSize - incr * 4; i += incr) {
-                vec.data = m_ibuf->data + i;
+            for (size_t i = 0; i + incr * 4 <= m_stepSize; i += incr) {
+                vec.data = input->data + i;
                 bool subsilent = aubio_silence_detection(&vec, m_threshold);
                 if (silent == subsilent) {
                     off = i;
@@ -238,8 +254,11 @@ Silence::process(const float *const *inputBuffers,
             }
 
             if (silent && (off == 0)) {
-                for (size_t i = 0; i < m_stepSize - incr; i += incr) {
+                for (size_t i = 0; i + incr <= m_stepSize; i += incr) {
+                    // the window starts i + incr samples before the end
+                    // of the previous block, and must not run past it
                     vec.data = m_pbuf->data + m_stepSize - i - incr;
+                    vec.length = std::min(incr * 4, i + incr);
                     bool subsilent = aubio_silence_detection(&vec, m_threshold);
                     if (!subsilent) {
                         off = -(long)i;
@@ -256,24 +275,21 @@ Silence::process(const float *const *inputBuffers,
         Feature feature;
         feature.hasTimestamp = true;
         feature.timestamp = featureStamp;
-        feature.values.push_back(silent ? 0 : 1);
-        returnFeatures[2].push_back(feature);
+        if (isOutputEnabled(m_enabledOutputs, 2)) {
+            feature.values.push_back(silent ? 0 : 1);
+            returnFeatures[2].push_back(feature);
+            feature.values.clear();
+        }
 
-        feature.values.clear();
+        // the region ending here goes to "noisy" when becoming silent,
+        // and to "silent" when becoming non-silent
+        int regionOutput = silent ? 1 : 0;
 
-        if (!m_first) {
+        if (!m_first && isOutputEnabled(m_enabledOutputs, regionOutput)) {
             feature.timestamp = m_lastChange;
             feature.hasDuration = true;
             feature.duration = featureStamp - m_lastChange;
-            if (silent) {
-                // non-silent regions feature
-                // (becoming silent, so this is a non-silent region)
-                returnFeatures[1].push_back(feature);
-            } else {
-                // silent regions feature
-                // (becoming non-silent, so this is a silent region)
-                returnFeatures[0].push_back(feature);
-            }                    
+            returnFeatures[regionOutput].push_back(feature);
         }
         m_lastChange = featureStamp;
 
@@ -281,12 +297,8 @@ Silence::process(const float *const *inputBuffers,
         m_first = false;
     }
 
-    // swap ibuf and pbuf data pointers, so that this block's data is
-    // available in pbuf when processing the next block, without
-    // having to allocate new storage for it
-    smpl_t *tmpdata = m_ibuf->data;
-    m_ibuf->data = m_pbuf->data;
-    m_pbuf->data = tmpdata;
+    // keep this block's data in pbuf for processing the next block
+    fvec_copy(input, m_pbuf);
 
     m_lastTimestamp = timestamp;
 
@@ -302,21 +314,20 @@ Silence::getRemainingFeatures()
 
     if (m_lastTimestamp > m_lastChange) {
 
-        Feature feature;
-        feature.hasTimestamp = true;
+        // silent or non-silent regions feature
+        int regionOutput = m_prevSilent ? 0 : 1;
+
+        if (isOutputEnabled(m_enabledOutputs, regionOutput)) {
+            Feature feature;
+            feature.hasTimestamp = true;
 
-        feature.timestamp = m_lastChange;
-        feature.hasDuration = true;
-        feature.duration = m_lastTimestamp - m_lastChange;
-        if (m_prevSilent) {
-            // silent regions feature
-            returnFeatures[0].push_back(feature);
-        } else {
-            // non-silent regions feature
-            returnFeatures[1].push_back(feature);
+            feature.timestamp = m_lastChange;
+            feature.hasDuration = true;
+            feature.duration = m_lastTimestamp - m_lastChange;
+            returnFeatures[regionOutput].push_back(feature);
         }
 
-        if (!m_prevSilent) {
+        if (!m_prevSilent && isOutputEnabled(m_enabledOutputs, 2)) {
             Feature silenceTestFeature;
             silenceTestFeature.hasTimestamp = true;
             silenceTestFeature.timestamp = m_lastTimestamp;
@@ -328,3 +339,48 @@ Silence::getRemainingFeatures()
     return returnFeatures;
 }
 
+string
+Silence::saveState() const
+{
+    StateWriter writer;
+    writeStateHeader(writer, *this, m_inputSampleRate, m_stepSize, m_blockSize);
+    writer.putSamples(m_pbuf->data, m_stepSize);
+    writer.putBool(m_prevSilent);
+    writer.putBool(m_first);
+    writer.putRealTime(m_lastChange);
+    writer.putRealTime(m_lastTimestamp);
+    return writer.getData();
+}
+
+bool
+Silence::restoreState(const string &state)
+{
+    if (!m_ibuf) {
+        cerr << "Silence::restoreState: Silence plugin not initialised" << endl;
+        return false;
+    }
+
+    reset();
+
+    // no aubio objects here, the previous block is all there is to
+    // rebuild
+    StateReader reader(state);
+    if (!readStateHeader(reader, *this, m_inputSampleRate,
+                         m_stepSize, m_blockSize)) {
+        return false;
+    }
+
+    reader.getSamples(m_pbuf->data, m_stepSize);
+    m_prevSilent = reader.getBool();
+    m_first = reader.getBool();
+    m_lastChange = reader.getRealTime();
+    m_lastTimestamp = reader.getRealTime();
+
+    if (!reader.isAtEnd()) {
+        cerr << "Silence::restoreState: invalid state" << endl;
+        reset();
+        return false;
+    }
+
+    return true;
+}
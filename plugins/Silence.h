@@ -29,7 +29,11 @@
 #include <vamp-sdk/Plugin.h>
 #include <aubio/aubio.h>
 
-class Silence : public Vamp::Plugin
+#include "Types.h"
+#include "Checkpoint.h"
+#include "PcmInput.h"
+
+class Silence : public Vamp::Plugin, public Checkpointable, public PcmInput
 {
 public:
     Silence(float inputSampleRate);
@@ -58,13 +62,18 @@ public:
 
     FeatureSet process(const float *const *inputBuffers,
                        Vamp::RealTime timestamp);
+    FeatureSet processInput(const fvec_t *input, Vamp::RealTime timestamp);
 
     FeatureSet getRemainingFeatures();
 
+    std::string saveState() const;
+    bool restoreState(const std::string &state);
+
 protected:
     fvec_t *m_ibuf;
     fvec_t *m_pbuf;
     float m_threshold;
+    unsigned int m_enabledOutputs;
     size_t m_stepSize;
     size_t m_blockSize;
     bool m_prevSilent;
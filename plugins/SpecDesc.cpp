@@ -24,6 +24,8 @@
 
 #include <math.h>
 #include "SpecDesc.h"
+#include "AubioLock.h"
+#include "DenormalGuard.h"
 
 using std::string;
 using std::vector;
@@ -33,7 +35,7 @@ using std::endl;
 SpecDesc::SpecDesc(float inputSampleRate) :
     Plugin(inputSampleRate),
     m_ibuf(0),
-    m_pvoc(0),
+    m_spectrum(0),
     m_ispec(0),
     m_specdesc(0),
     m_out(0),
@@ -43,8 +45,9 @@ SpecDesc::SpecDesc(float inputSampleRate) :
 
 SpecDesc::~SpecDesc()
 {
+    AubioLock lock;
     if (m_specdesc) del_aubio_specdesc(m_specdesc);
-    if (m_pvoc) del_aubio_pvoc(m_pvoc);
+    delete m_spectrum;
     if (m_ibuf) del_fvec(m_ibuf);
     if (m_ispec) del_cvec(m_ispec);
     if (m_out) del_fvec(m_out);
@@ -101,6 +104,9 @@ SpecDesc::initialise(size_t channels, size_t stepSize, size_t blockSize)
     m_ispec = new_cvec(blockSize);
     m_out = new_fvec(1);
 
+    m_history.initialise(getPvocHistoryHops(stepSize, blockSize) + 2,
+                         stepSize);
+
     reset();
 
     return true;
@@ -109,14 +115,17 @@ SpecDesc::initialise(size_t channels, size_t stepSize, size_t blockSize)
 void
 SpecDesc::reset()
 {
-    if (m_pvoc) del_aubio_pvoc(m_pvoc);
+    AubioLock lock;
+    delete m_spectrum;
     if (m_specdesc) del_aubio_specdesc(m_specdesc);
 
     m_specdesc = new_aubio_specdesc
         (const_cast<char *>(getAubioNameForSpecDescType(m_specdesctype)),
          m_blockSize);
 
-    m_pvoc = new_aubio_pvoc(m_blockSize, m_stepSize);
+    m_spectrum = new MagnitudeSpectrum(m_blockSize, m_stepSize);
+
+    m_history.reset();
 }
 
 size_t
@@ -204,14 +213,22 @@ SpecDesc::getOutputDescriptors() const
 }
 
 SpecDesc::FeatureSet
-SpecDesc::process(const float *const *inputBuffers,
-               UNUSED Vamp::RealTime timestamp)
+SpecDesc::process(const float *const *inputBuffers, Vamp::RealTime timestamp)
 {
     for (size_t i = 0; i < m_stepSize; ++i) {
         fvec_set_sample(m_ibuf, inputBuffers[0][i], i);
     }
+    return processInput(m_ibuf, timestamp);
+}
+
+SpecDesc::FeatureSet
+SpecDesc::processInput(const fvec_t *input, UNUSED Vamp::RealTime timestamp)
+{
+    DenormalGuard guard;
 
-    aubio_pvoc_do(m_pvoc, m_ibuf, m_ispec);
+    m_history.push(input);
+
+    m_spectrum->process(input, m_ispec);
     aubio_specdesc_do(m_specdesc, m_ispec, m_out);
 
     FeatureSet returnFeatures;
@@ -230,3 +247,46 @@ SpecDesc::getRemainingFeatures()
     return FeatureSet();
 }
 
+string
+SpecDesc::saveState() const
+{
+    StateWriter writer;
+    writeStateHeader(writer, *this, m_inputSampleRate, m_stepSize, m_blockSize);
+    m_history.save(writer);
+    return writer.getData();
+}
+
+bool
+SpecDesc::restoreState(const string &state)
+{
+    if (!m_ibuf) {
+        cerr << "SpecDesc::restoreState: SpecDesc plugin not initialised" << endl;
+        return false;
+    }
+
+    reset();
+
+    StateReader reader(state);
+    if (!readStateHeader(reader, *this, m_inputSampleRate,
+                         m_stepSize, m_blockSize)) {
+        return false;
+    }
+
+    InputHistory history(m_history);
+    history.restore(reader);
+    if (!reader.isOK()) {
+        cerr << "SpecDesc::restoreState: invalid state" << endl;
+        return false;
+    }
+
+    history.replay(*this, m_blockSize, m_inputSampleRate);
+    m_history = history;
+
+    if (!reader.isAtEnd()) {
+        cerr << "SpecDesc::restoreState: invalid state" << endl;
+        reset();
+        return false;
+    }
+
+    return true;
+}
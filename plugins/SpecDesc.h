@@ -29,8 +29,11 @@
 #include <aubio/aubio.h>
 
 #include "Types.h"
+#include "Checkpoint.h"
+#include "PcmInput.h"
+#include "MagnitudeSpectrum.h"
 
-class SpecDesc : public Vamp::Plugin
+class SpecDesc : public Vamp::Plugin, public Checkpointable, public PcmInput
 {
 public:
     SpecDesc(float inputSampleRate);
@@ -59,18 +62,25 @@ public:
 
     FeatureSet process(const float *const *inputBuffers,
                        Vamp::RealTime timestamp);
+    FeatureSet processInput(const fvec_t *input, Vamp::RealTime timestamp);
 
     FeatureSet getRemainingFeatures();
 
+    std::string saveState() const;
+    bool restoreState(const std::string &state);
+
 protected:
     fvec_t *m_ibuf;
-    aubio_pvoc_t *m_pvoc;
+    MagnitudeSpectrum *m_spectrum;
     cvec_t *m_ispec;
     aubio_specdesc_t *m_specdesc;
     fvec_t *m_out;
     SpecDescType m_specdesctype;
     size_t m_stepSize;
     size_t m_blockSize;
+
+    // input kept for rebuilding the aubio objects in restoreState()
+    InputHistory m_history;
 };
 
 
@@ -25,6 +25,8 @@
 
 #include <math.h>
 #include "Tempo.h"
+#include "AubioLock.h"
+#include "DenormalGuard.h"
 
 using std::string;
 using std::vector;
@@ -39,12 +41,16 @@ Tempo::Tempo(float inputSampleRate) :
     m_onsettype(OnsetComplex),
     m_tempo(0),
     m_threshold(0.3),
-    m_silence(-70)
+    m_silence(-70),
+    m_tolerance(1),
+    m_enabledOutputs(7),
+    m_analysisRate(0)
 {
 }
 
 Tempo::~Tempo()
 {
+    AubioLock lock;
     if (m_ibuf) del_fvec(m_ibuf);
     if (m_beat) del_fvec(m_beat);
     if (m_tempo) del_aubio_tempo(m_tempo);
@@ -97,6 +103,9 @@ Tempo::initialise(size_t channels, size_t stepSize, size_t blockSize)
     m_stepSize = stepSize;
     m_blockSize = blockSize;
 
+    m_resampled.initialise(m_inputSampleRate, m_analysisRate,
+                           stepSize, blockSize);
+
     m_ibuf = new_fvec(stepSize);
     m_beat = new_fvec(2);
     
@@ -111,18 +120,23 @@ Tempo::initialise(size_t channels, size_t stepSize, size_t blockSize)
 void
 Tempo::reset()
 {
+    AubioLock lock;
     if (m_tempo) del_aubio_tempo(m_tempo);
 
     m_lastBeat = Vamp::RealTime::zeroTime - m_delay - m_delay;
+    m_lastTimestamp = Vamp::RealTime::zeroTime;
+    m_haveSpan = false;
 
     m_tempo = new_aubio_tempo
         (const_cast<char *>(getAubioNameForOnsetType(m_onsettype)),
-         m_blockSize,
-         m_stepSize,
-         lrintf(m_inputSampleRate));
+         m_resampled.getBlockSize(),
+         m_resampled.getStepSize(),
+         lrintf(m_resampled.getRate()));
 
     aubio_tempo_set_silence(m_tempo, m_silence);
     aubio_tempo_set_threshold(m_tempo, m_threshold);
+
+    m_resampled.reset();
 }
 
 size_t
@@ -182,6 +196,21 @@ Tempo::getParameterDescriptors() const
     desc.isQuantized = false;
     list.push_back(desc);
 
+    desc = ParameterDescriptor();
+    desc.identifier = "tempotolerance";
+    desc.name = "Tempo Change Tolerance";
+    desc.description = "Smallest tempo variation starting a new region in the tempo changes output";
+    desc.minValue = 0;
+    desc.maxValue = 20;
+    desc.defaultValue = 1;
+    desc.unit = "bpm";
+    desc.isQuantized = false;
+    list.push_back(desc);
+
+    list.push_back(getEnabledOutputsDescriptor(getOutputDescriptors()));
+
+    list.push_back(getAnalysisRateDescriptor(m_inputSampleRate));
+
     return list;
 }
 
@@ -194,6 +223,12 @@ Tempo::getParameter(std::string param) const
         return m_threshold;
     } else if (param == "silencethreshold") {
         return m_silence;
+    } else if (param == "tempotolerance") {
+        return m_tolerance;
+    } else if (param == "enabledoutputs") {
+        return m_enabledOutputs;
+    } else if (param == "analysisrate") {
+        return m_analysisRate;
     } else {
         return 0.0;
     }
@@ -217,6 +252,13 @@ Tempo::setParameter(std::string param, float value)
         m_threshold = value;
     } else if (param == "silencethreshold") {
         m_silence = value;
+    } else if (param == "tempotolerance") {
+        m_tolerance = value;
+    } else if (param == "enabledoutputs") {
+        m_enabledOutputs = getEnabledOutputsMask
+            (value, getOutputDescriptors().size());
+    } else if (param == "analysisrate") {
+        m_analysisRate = value;
     }
 }
 
@@ -247,6 +289,19 @@ Tempo::getOutputDescriptors() const
     d.sampleType = OutputDescriptor::OneSamplePerStep;
     list.push_back(d);
 
+    d.identifier = "tempochanges";
+    d.name = "Tempo Changes";
+    d.description = "Regions of constant tempo, starting whenever the estimated tempo changes by more than the tolerance";
+    d.unit = "bpm";
+    d.hasFixedBinCount = true;
+    d.binCount = 1;
+    d.hasKnownExtents = false;
+    d.isQuantized = false;
+    d.sampleType = OutputDescriptor::VariableSampleRate;
+    d.sampleRate = 0;
+    d.hasDuration = true;
+    list.push_back(d);
+
     return list;
 }
 
@@ -256,16 +311,43 @@ Tempo::process(const float *const *inputBuffers, Vamp::RealTime timestamp)
     for (size_t i = 0; i < m_stepSize; ++i) {
         fvec_set_sample(m_ibuf, inputBuffers[0][i], i);
     }
+    return processInput(m_ibuf, timestamp);
+}
+
+Tempo::FeatureSet
+Tempo::processInput(const fvec_t *input, Vamp::RealTime timestamp)
+{
+    DenormalGuard guard;
 
-    aubio_tempo_do(m_tempo, m_ibuf, m_beat);
+    if (!m_resampled.isActive()) return analyse(input, timestamp);
 
-    bool istactus = m_beat->data[0];
+    m_resampled.push(input, timestamp);
+    return analyseResampled();
+}
 
-    m_bpm = aubio_tempo_get_bpm(m_tempo);
+Tempo::FeatureSet
+Tempo::analyseResampled()
+{
+    FeatureSet returnFeatures;
+    Vamp::RealTime timestamp;
+    while (const fvec_t *input = m_resampled.next(timestamp)) {
+        appendFeatures(returnFeatures, analyse(input, timestamp));
+    }
+    return returnFeatures;
+}
+
+Tempo::FeatureSet
+Tempo::analyse(const fvec_t *input, Vamp::RealTime timestamp)
+{
+    aubio_tempo_do(m_tempo, input, m_beat);
+
+    m_lastTimestamp = timestamp;
+
+    bool istactus = m_beat->data[0];
 
     FeatureSet returnFeatures;
 
-    if (istactus == true) {
+    if (istactus == true && isOutputEnabled(m_enabledOutputs, 0)) {
         if (timestamp - m_lastBeat >= m_delay) {
             Feature onsettime;
             onsettime.hasTimestamp = true;
@@ -276,19 +358,104 @@ Tempo::process(const float *const *inputBuffers, Vamp::RealTime timestamp)
         }
     }
 
-    if (m_bpm >= 30 && m_bpm <= 206) {
+    if (!isOutputEnabled(m_enabledOutputs, 1) &&
+        !isOutputEnabled(m_enabledOutputs, 2)) {
+        return returnFeatures;
+    }
+
+    m_bpm = aubio_tempo_get_bpm(m_tempo);
+
+    bool valid = (m_bpm >= 30 && m_bpm <= 206);
+
+    if (valid && isOutputEnabled(m_enabledOutputs, 1)) {
         Feature tempo;
         tempo.hasTimestamp = false;
         tempo.values.push_back(m_bpm);
         returnFeatures[1].push_back(tempo);
     }
 
+    if (isOutputEnabled(m_enabledOutputs, 2)) {
+        // close the current region when the tempo moves away from the
+        // value it started with, or is lost altogether
+        if (m_haveSpan && (!valid || fabsf(m_bpm - m_spanBpm) > m_tolerance)) {
+            pushTempoSpan(returnFeatures, m_lastTimestamp);
+        }
+        if (valid) {
+            if (!m_haveSpan) {
+                m_haveSpan = true;
+                m_spanBpm = m_bpm;
+                m_spanSum = 0;
+                m_spanCount = 0;
+                m_spanStart = m_lastTimestamp;
+            }
+            m_spanSum += m_bpm;
+            ++m_spanCount;
+        }
+    }
+
     return returnFeatures;
 }
 
 Tempo::FeatureSet
 Tempo::getRemainingFeatures()
 {
-    return FeatureSet();
+    DenormalGuard guard;
+
+    FeatureSet returnFeatures;
+    if (m_resampled.isActive()) {
+        m_resampled.flush();
+        returnFeatures = analyseResampled();
+    }
+    if (m_haveSpan) {
+        pushTempoSpan(returnFeatures, m_lastTimestamp +
+                      Vamp::RealTime::frame2RealTime
+                      (m_stepSize, lrintf(m_inputSampleRate)));
+    }
+    return returnFeatures;
+}
+
+void
+Tempo::pushTempoSpan(FeatureSet &fs, const Vamp::RealTime &endTime)
+{
+    Feature feature;
+    feature.hasTimestamp = true;
+    feature.timestamp = m_spanStart;
+    feature.hasDuration = true;
+    feature.duration = endTime - m_spanStart;
+    feature.values.push_back(m_spanSum / m_spanCount);
+    fs[2].push_back(feature);
+
+    m_haveSpan = false;
+}
+
+string
+Tempo::saveState() const
+{
+    StateWriter writer;
+    writeStateHeader(writer, *this, m_inputSampleRate, m_stepSize, m_blockSize);
+    writer.putFloat(m_bpm);
+    writer.putRealTime(m_lastBeat);
+    writer.putRealTime(m_lastTimestamp);
+    writer.putBool(m_haveSpan);
+    writer.putFloat(m_spanBpm);
+    writer.putDouble(m_spanSum);
+    writer.putSize(m_spanCount);
+    writer.putRealTime(m_spanStart);
+    return writer.getData();
 }
 
+bool
+Tempo::restoreState(const string &)
+{
+    if (!m_ibuf) {
+        cerr << "Tempo::restoreState: Tempo plugin not initialised" << endl;
+        return false;
+    }
+
+    // the beat tracker refines its period and phase over the whole
+    // input, and replaying part of it would not rebuild them exactly
+    reset();
+    cerr << "Tempo::restoreState: the beat tracker cannot be rebuilt"
+         << " exactly, so tempo analyses cannot be resumed" << endl;
+    return false;
+}
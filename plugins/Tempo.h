@@ -30,8 +30,11 @@
 #include <aubio/aubio.h>
 
 #include "Types.h"
+#include "Checkpoint.h"
+#include "PcmInput.h"
+#include "Resampler.h"
 
-class Tempo : public Vamp::Plugin
+class Tempo : public Vamp::Plugin, public Checkpointable, public PcmInput
 {
 public:
     Tempo(float inputSampleRate);
@@ -59,9 +62,13 @@ public:
     OutputList getOutputDescriptors() const;
 
     FeatureSet process(const float *const *inputBuffers, Vamp::RealTime timestamp);
+    FeatureSet processInput(const fvec_t *input, Vamp::RealTime timestamp);
 
     FeatureSet getRemainingFeatures();
 
+    std::string saveState() const;
+    bool restoreState(const std::string &state);
+
 protected:
     fvec_t *m_ibuf;
     fvec_t *m_beat;
@@ -70,10 +77,29 @@ protected:
     aubio_tempo_t *m_tempo;
     float m_threshold;
     float m_silence;
+    float m_tolerance;
+    unsigned int m_enabledOutputs;
     size_t m_stepSize;
     size_t m_blockSize;
+
+    // input decimated to the analysis rate, when it is below the host's
+    float m_analysisRate;
+    ResampledInput m_resampled;
+
     Vamp::RealTime m_delay;
     Vamp::RealTime m_lastBeat;
+    Vamp::RealTime m_lastTimestamp;
+
+    // current run of near-constant tempo, for the tempo changes output
+    bool m_haveSpan;
+    float m_spanBpm;
+    double m_spanSum;
+    size_t m_spanCount;
+    Vamp::RealTime m_spanStart;
+
+    void pushTempoSpan(FeatureSet &, const Vamp::RealTime &);
+    FeatureSet analyse(const fvec_t *input, Vamp::RealTime timestamp);
+    FeatureSet analyseResampled();
 };
 
 
@@ -23,6 +23,9 @@
 
 */
 
+#include <math.h>
+#include <sstream>
+
 #include "Types.h"
 
 const char *getAubioNameForOnsetType(OnsetType t)
@@ -52,3 +55,48 @@ const char *getAubioNameForPitchType(PitchType t)
     return names[(int)t];
 }
 
+
+Vamp::Plugin::ParameterDescriptor
+getEnabledOutputsDescriptor(const Vamp::Plugin::OutputList &outputs,
+                            unsigned int defaultMask)
+{
+    unsigned int all = (1u << outputs.size()) - 1;
+
+    Vamp::Plugin::ParameterDescriptor desc;
+    desc.identifier = "enabledoutputs";
+    desc.name = "Enabled Outputs";
+    desc.description = "Outputs to compute, as the sum of";
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        std::ostringstream bit;
+        bit << (i == 0 ? " " : ", ") << (1u << i) << " for "
+            << outputs[i].name;
+        desc.description += bit.str();
+    }
+    desc.description += "; disabled outputs return no features";
+    desc.minValue = 1;
+    desc.maxValue = all;
+    desc.defaultValue = (defaultMask ? (defaultMask & all) : all);
+    desc.isQuantized = true;
+    desc.quantizeStep = 1;
+    return desc;
+}
+
+unsigned int
+getEnabledOutputsMask(float value, size_t outputs)
+{
+    unsigned int all = (1u << outputs) - 1;
+    if (!(value >= 1)) return 1;
+    if (value >= all) return all;
+    return (unsigned int)lrintf(value);
+}
+
+void
+appendFeatures(Vamp::Plugin::FeatureSet &to,
+               const Vamp::Plugin::FeatureSet &from)
+{
+    for (Vamp::Plugin::FeatureSet::const_iterator i = from.begin();
+         i != from.end(); ++i) {
+        Vamp::Plugin::FeatureList &list = to[i->first];
+        list.insert(list.end(), i->second.begin(), i->second.end());
+    }
+}
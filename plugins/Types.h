@@ -26,6 +26,8 @@
 #ifndef _ONSET_TYPE_H_
 #define _ONSET_TYPE_H_
 
+#include <vamp-sdk/Plugin.h>
+
 /** silence unused parameter warning by adding an attribute */
 #if defined(__GNUC__)
 #define UNUSED __attribute__((unused))
@@ -76,5 +78,28 @@ enum PitchType {
 
 extern const char *getAubioNameForPitchType(PitchType t);
 
+// Plugins with several outputs take an "enabledoutputs" parameter, a
+// bit mask in which bit i enables output i. Outputs that are disabled
+// keep their index but are neither computed nor returned. The default
+// is the given mask, or all outputs if it is 0.
+
+extern Vamp::Plugin::ParameterDescriptor
+getEnabledOutputsDescriptor(const Vamp::Plugin::OutputList &outputs,
+                            unsigned int defaultMask = 0);
+
+// The mask for a value of that parameter, clamped to the range of its
+// descriptor, from 1 (the first output only) to all outputs enabled
+
+extern unsigned int getEnabledOutputsMask(float value, size_t outputs);
+
+inline bool isOutputEnabled(unsigned int mask, int output) {
+    return (mask >> output) & 1;
+}
+
+// Append the features of each output of from to those of to
+
+extern void appendFeatures(Vamp::Plugin::FeatureSet &to,
+                           const Vamp::Plugin::FeatureSet &from);
+
 #endif
 
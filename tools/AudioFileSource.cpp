@@ -0,0 +1,352 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include "AudioFileSource.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::string;
+
+// read ahead this far beyond the current block, and drop pages this
+// far behind it
+static const size_t adviceWindow = 8 << 20;
+
+// frames converted into the staging buffer beyond the block, so that
+// its contents are moved back to the start only once in a while
+static const size_t stagingFrames = 1 << 16;
+
+// little-endian header fields
+static uint32_t
+get16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t
+get32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool
+isLittleEndian()
+{
+    uint32_t word = 1;
+    unsigned char first;
+    memcpy(&first, &word, 1);
+    return first == 1;
+}
+
+AudioFileSource::AudioFileSource() :
+    m_fd(-1),
+    m_map(0),
+    m_mapSize(0),
+    m_data(0),
+    m_format(PcmFloat32),
+    m_bytesPerFrame(0),
+    m_channels(0),
+    m_frames(0),
+    m_rate(0),
+    m_direct(false),
+    m_stepSize(0),
+    m_blockSize(0),
+    m_nextFrame(0),
+    m_bufferStart(0),
+    m_bufferFill(0),
+    m_adviceEnd(0),
+    m_dropped(0)
+{
+}
+
+AudioFileSource::~AudioFileSource()
+{
+    close();
+}
+
+void
+AudioFileSource::close()
+{
+    if (m_map) munmap(m_map, m_mapSize);
+    if (m_fd >= 0) ::close(m_fd);
+    m_fd = -1;
+    m_map = 0;
+    m_mapSize = 0;
+    m_data = 0;
+    m_frames = 0;
+    m_nextFrame = 0;
+}
+
+bool
+AudioFileSource::mapFile(const string &path, string &error)
+{
+    close();
+
+    m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(m_fd, &st) < 0 || st.st_size == 0) {
+        error = path + ": empty or unreadable file";
+        close();
+        return false;
+    }
+    m_mapSize = st.st_size;
+    m_map = mmap(0, m_mapSize, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (m_map == MAP_FAILED) {
+        m_map = 0;
+        error = path + ": " + strerror(errno);
+        close();
+        return false;
+    }
+    madvise(m_map, m_mapSize, MADV_SEQUENTIAL);
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    return true;
+}
+
+bool
+AudioFileSource::open(const string &path, float rawRate, size_t rawChannels,
+                      string &error)
+{
+    unsigned char head[12];
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    bool wav = (read(fd, head, 12) == 12 &&
+                !memcmp(head, "RIFF", 4) && !memcmp(head + 8, "WAVE", 4));
+    ::close(fd);
+
+    if (wav) return openWav(path, error);
+    return openRaw(path, rawRate, rawChannels, error);
+}
+
+bool
+AudioFileSource::openWav(const string &path, string &error)
+{
+    if (!mapFile(path, error)) return false;
+
+    const unsigned char *base = (const unsigned char *)m_map;
+    if (m_mapSize < 12 || memcmp(base, "RIFF", 4) ||
+        memcmp(base + 8, "WAVE", 4)) {
+        error = path + ": not a WAV file";
+        close();
+        return false;
+    }
+
+    unsigned int format = 0, channels = 0, rate = 0, align = 0, bits = 0;
+    size_t dataOffset = 0, dataSize = 0;
+    bool haveFormat = false, haveData = false;
+
+    size_t pos = 12;
+    while (pos + 8 <= m_mapSize && !(haveFormat && haveData)) {
+        const unsigned char *chunk = base + pos;
+        size_t size = get32(chunk + 4);
+        size_t body = pos + 8;
+        size_t remaining = m_mapSize - body;
+        if (!memcmp(chunk, "fmt ", 4) && size >= 16 && size <= remaining) {
+            format = get16(chunk + 8);
+            channels = get16(chunk + 10);
+            rate = get32(chunk + 12);
+            align = get16(chunk + 20);
+            bits = get16(chunk + 22);
+            if (format == 0xfffe && size >= 40) {
+                format = get16(chunk + 32); // start of the subformat GUID
+            }
+            haveFormat = true;
+        } else if (!memcmp(chunk, "data", 4)) {
+            // streaming writers leave the size unset or too large
+            if (size > remaining) size = remaining;
+            dataOffset = body;
+            dataSize = size;
+            haveData = true;
+        }
+        if (size > remaining) break;
+        pos = body + size + (size & 1);
+    }
+
+    if (!haveFormat || !haveData) {
+        error = path + ": no format or data chunk";
+        close();
+        return false;
+    }
+    if (channels == 0 || rate == 0 || align == 0 || align % channels) {
+        error = path + ": invalid format chunk";
+        close();
+        return false;
+    }
+
+    size_t container = align / channels;
+    if (format == 1 && container == 2 && bits <= 16) {
+        m_format = PcmInt16;
+    } else if (format == 1 && container == 3 && bits <= 24) {
+        m_format = PcmInt24;
+    } else if (format == 1 && container == 4 && bits <= 32) {
+        // 24-bit samples in 32-bit containers are left-justified
+        m_format = PcmInt32;
+    } else if (format == 3 && container == 4 && bits == 32) {
+        m_format = PcmFloat32;
+    } else if (format == 3 && container == 8 && bits == 64) {
+        m_format = PcmFloat64;
+    } else {
+        error = path + ": unsupported sample format";
+        close();
+        return false;
+    }
+
+    m_data = base + dataOffset;
+    m_bytesPerFrame = align;
+    m_channels = channels;
+    m_frames = dataSize / align;
+    m_rate = rate;
+    return true;
+}
+
+bool
+AudioFileSource::openRaw(const string &path, float rate, size_t channels,
+                         string &error)
+{
+    if (!mapFile(path, error)) return false;
+    if (rate <= 0 || channels == 0) {
+        error = "invalid rate or channel count";
+        close();
+        return false;
+    }
+
+    m_data = (const unsigned char *)m_map;
+    m_format = PcmFloat32;
+    m_bytesPerFrame = 4 * channels;
+    m_channels = channels;
+    m_frames = m_mapSize / m_bytesPerFrame;
+    m_rate = rate;
+    return true;
+}
+
+void
+AudioFileSource::start(size_t stepSize, size_t blockSize)
+{
+    m_stepSize = stepSize;
+    m_blockSize = blockSize;
+    m_nextFrame = 0;
+
+    m_direct = (m_format == PcmFloat32 && m_channels == 1 &&
+                isLittleEndian() && ((uintptr_t)m_data % sizeof(float)) == 0);
+
+    m_buffer.assign(blockSize + (stepSize > stagingFrames ?
+                                 stepSize : stagingFrames), 0.f);
+    m_bufferStart = 0;
+    m_bufferFill = 0;
+
+    m_adviceEnd = m_data - (const unsigned char *)m_map;
+    m_dropped = 0;
+}
+
+void
+AudioFileSource::convert(size_t frame, size_t count, float *out) const
+{
+    convertPcm(m_data + frame * m_bytesPerFrame, m_format, m_channels, count,
+               out);
+}
+
+void
+AudioFileSource::advise(size_t frame)
+{
+    size_t page = sysconf(_SC_PAGESIZE);
+    unsigned char *base = (unsigned char *)m_map;
+    size_t pos = (m_data - base) + frame * m_bytesPerFrame;
+
+    if (pos + adviceWindow / 2 > m_adviceEnd && m_adviceEnd < m_mapSize) {
+        size_t from = m_adviceEnd / page * page;
+        size_t to = pos + adviceWindow;
+        if (to > m_mapSize) to = m_mapSize;
+        madvise(base + from, to - from, MADV_WILLNEED);
+        m_adviceEnd = to;
+    }
+
+    if (pos > m_dropped + 2 * adviceWindow) {
+        size_t to = (pos - adviceWindow) / page * page;
+        madvise(base + m_dropped, to - m_dropped, MADV_DONTNEED);
+#ifdef POSIX_FADV_DONTNEED
+        // and from the page cache, as nothing else is likely to read
+        // the file while it streams through
+        posix_fadvise(m_fd, m_dropped, to - m_dropped, POSIX_FADV_DONTNEED);
+#endif
+        m_dropped = to;
+    }
+}
+
+const float *
+AudioFileSource::next(size_t &frame)
+{
+    if (!m_map || m_blockSize == 0 || m_nextFrame >= m_frames) return 0;
+
+    frame = m_nextFrame;
+    m_nextFrame += m_stepSize;
+    advise(frame);
+
+    size_t end = frame + m_blockSize;
+    if (m_direct && end <= m_frames) {
+        return (const float *)m_data + frame;
+    }
+
+    if (frame < m_bufferStart || frame > m_bufferStart + m_bufferFill) {
+        // steps longer than blocks skip frames
+        m_bufferStart = frame;
+        m_bufferFill = 0;
+    }
+    if (end > m_bufferStart + m_buffer.size()) {
+        size_t keep = m_bufferStart + m_bufferFill - frame;
+        memmove(&m_buffer[0], &m_buffer[frame - m_bufferStart],
+                keep * sizeof(float));
+        m_bufferStart = frame;
+        m_bufferFill = keep;
+    }
+
+    size_t have = m_bufferStart + m_bufferFill;
+    if (have < end) {
+        size_t available = end < m_frames ? end : m_frames;
+        if (have < available) {
+            convert(have, available - have, &m_buffer[have - m_bufferStart]);
+            have = available;
+        }
+        for (size_t f = have; f < end; ++f) {
+            m_buffer[f - m_bufferStart] = 0.f;
+        }
+        m_bufferFill = end - m_bufferStart;
+    }
+
+    return &m_buffer[frame - m_bufferStart];
+}
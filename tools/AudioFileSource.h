@@ -0,0 +1,117 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef _AUDIO_FILE_SOURCE_H_
+#define _AUDIO_FILE_SOURCE_H_
+
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+
+#include "plugins/PcmInput.h"
+
+/** Mono blocks of a PCM WAV file or of raw float32 samples, read from
+  a memory mapping of the file
+
+  WAV files may hold 16, 24 or 32-bit integer or 32 or 64-bit float
+  samples, in any number of channels, which are mixed down to mono.
+  Samples are converted straight from the mapping into a staging
+  buffer that blocks are handed out of in place, so overlapping blocks
+  share their samples and each one is converted only once. Mono float32
+  data needs no conversion at all: blocks point into the mapping itself,
+  apart from the last one, padded with zeros.
+
+  The kernel is told that the file is read sequentially, asked to read
+  ahead a window beyond the current block, and to drop pages already
+  used, so that files larger than memory stream through it. */
+class AudioFileSource
+{
+public:
+    AudioFileSource();
+    ~AudioFileSource();
+
+    /** map path as a WAV file if it starts with a RIFF WAVE header,
+      or as raw samples at rawRate in rawChannels otherwise */
+    bool open(const std::string &path, float rawRate, size_t rawChannels,
+              std::string &error);
+
+    /** map a WAV file, returning false and setting error if it cannot
+      be read */
+    bool openWav(const std::string &path, std::string &error);
+
+    /** map a file of raw little-endian float32 samples, interleaved in
+      the given number of channels */
+    bool openRaw(const std::string &path, float rate, size_t channels,
+                 std::string &error);
+
+    void close();
+
+    float getSampleRate() const { return m_rate; }
+    size_t getChannelCount() const { return m_channels; }
+    size_t getFrameCount() const { return m_frames; }
+
+    /** start handing out blocks of blockSize frames, starting
+      stepSize frames apart, from the first frame */
+    void start(size_t stepSize, size_t blockSize);
+
+    /** the next block, valid until the next call, or 0 past the end of
+      the file; frame is set to the number of its first frame */
+    const float *next(size_t &frame);
+
+protected:
+    int m_fd;
+    void *m_map;
+    size_t m_mapSize;
+    const unsigned char *m_data;
+    PcmFormat m_format;
+    size_t m_bytesPerFrame;
+    size_t m_channels;
+    size_t m_frames;
+    float m_rate;
+    bool m_direct;
+
+    size_t m_stepSize;
+    size_t m_blockSize;
+    size_t m_nextFrame;
+
+    std::vector<float> m_buffer;
+    size_t m_bufferStart;   // frame at m_buffer[0]
+    size_t m_bufferFill;    // frames converted into m_buffer
+
+    size_t m_adviceEnd;     // end of the last read-ahead, in bytes
+    size_t m_dropped;       // start of the pages not yet dropped
+
+    bool mapFile(const std::string &path, std::string &error);
+    void convert(size_t frame, size_t count, float *out) const;
+    void advise(size_t frame);
+
+private:
+    AudioFileSource(const AudioFileSource &);
+    AudioFileSource &operator=(const AudioFileSource &);
+};
+
+#endif /* _AUDIO_FILE_SOURCE_H_ */
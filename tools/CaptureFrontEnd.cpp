@@ -0,0 +1,242 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "CaptureFrontEnd.h"
+
+CaptureFrontEnd::CaptureFrontEnd(const VampPluginDescriptor *d,
+                                 VampPluginHandle h, float rate,
+                                 unsigned int stepSize, unsigned int blockSize,
+                                 size_t ringFrames, size_t queueSize) :
+    m_descriptor(d),
+    m_handle(h),
+    m_rate(rate),
+    m_stepSize(stepSize),
+    m_blockSize(blockSize),
+    m_outputCount(0),
+    m_input(ringFrames),
+    m_features(queueSize),
+    m_running(false),
+    m_stopping(0),
+    m_block(blockSize, 0.f),
+    m_blockFill(0),
+    m_skip(0),
+    m_frame(0),
+    m_droppedFrames(0),
+    m_droppedFeatures(0),
+    m_processedBlocks(0)
+{
+}
+
+CaptureFrontEnd::~CaptureFrontEnd()
+{
+    if (m_running) stop();
+    while (LiveFeature *f = popFeature()) delete f;
+    m_descriptor->cleanup(m_handle);
+}
+
+bool
+CaptureFrontEnd::start()
+{
+    if (m_running) return true;
+    if (!m_descriptor->initialise(m_handle, 1, m_stepSize, m_blockSize)) {
+        fprintf(stderr, "CaptureFrontEnd::start: %s failed to initialise\n",
+                m_descriptor->identifier);
+        return false;
+    }
+    m_outputCount = m_descriptor->getOutputCount(m_handle);
+    if (pthread_create(&m_thread, 0, run, this)) {
+        fprintf(stderr, "CaptureFrontEnd::start: cannot create thread\n");
+        return false;
+    }
+    m_running = true;
+    return true;
+}
+
+void
+CaptureFrontEnd::stop()
+{
+    if (!m_running) return;
+    __atomic_store_n(&m_stopping, 1, __ATOMIC_RELEASE);
+    pthread_join(m_thread, 0);
+    m_running = false;
+}
+
+void
+CaptureFrontEnd::push(const float *samples, size_t count)
+{
+    size_t written = m_input.write(samples, count);
+    if (written < count) {
+        __atomic_store_n(&m_droppedFrames,
+                         m_droppedFrames + (count - written), __ATOMIC_RELAXED);
+    }
+}
+
+LiveFeature *
+CaptureFrontEnd::popFeature()
+{
+    LiveFeature *f = 0;
+    if (!m_features.read(&f, 1)) return 0;
+    return f;
+}
+
+unsigned long
+CaptureFrontEnd::getDroppedFrames() const
+{
+    return __atomic_load_n(&m_droppedFrames, __ATOMIC_RELAXED);
+}
+
+unsigned long
+CaptureFrontEnd::getDroppedFeatures() const
+{
+    return __atomic_load_n(&m_droppedFeatures, __ATOMIC_RELAXED);
+}
+
+unsigned long
+CaptureFrontEnd::getProcessedBlocks() const
+{
+    return __atomic_load_n(&m_processedBlocks, __ATOMIC_RELAXED);
+}
+
+void *
+CaptureFrontEnd::run(void *arg)
+{
+    ((CaptureFrontEnd *)arg)->work();
+    return 0;
+}
+
+void
+CaptureFrontEnd::work()
+{
+    // poll at a quarter of a step, so that a block is picked up soon
+    // after its last sample arrives
+    double wait = m_stepSize / m_rate / 4;
+    if (wait < 0.0005) wait = 0.0005;
+    struct timespec ts;
+    ts.tv_sec = (time_t)wait;
+    ts.tv_nsec = (long)((wait - ts.tv_sec) * 1e9);
+
+    while (true) {
+        // read the flag before the ring, so that nothing pushed before
+        // stop() is missed
+        bool stopping = __atomic_load_n(&m_stopping, __ATOMIC_ACQUIRE);
+        bool progress = false;
+        while (fillBlock()) {
+            processBlock();
+            progress = true;
+        }
+        if (stopping) break;
+        if (!progress) nanosleep(&ts, 0);
+    }
+
+    // blocks still holding unprocessed samples, padded with zeros
+    size_t overlap = m_stepSize < m_blockSize ? m_blockSize - m_stepSize : 0;
+    while (m_blockFill > 0 && m_skip == 0) {
+        size_t fill = m_blockFill;
+        memset(&m_block[fill], 0, (m_blockSize - fill) * sizeof(float));
+        m_blockFill = m_blockSize;
+        processBlock();
+        m_blockFill = fill > m_stepSize ? fill - m_stepSize : 0;
+        if (m_blockFill > overlap) m_blockFill = overlap;
+    }
+
+    publish(m_descriptor->getRemainingFeatures(m_handle), m_frame);
+}
+
+bool
+CaptureFrontEnd::fillBlock()
+{
+    if (m_skip > 0) {
+        m_skip -= m_input.skip(m_skip);
+        if (m_skip > 0) return false;
+    }
+    m_blockFill += m_input.read(&m_block[m_blockFill],
+                                m_blockSize - m_blockFill);
+    return m_blockFill == m_blockSize;
+}
+
+void
+CaptureFrontEnd::processBlock()
+{
+    const float *inputs[1] = { &m_block[0] };
+    int sec = (int)(m_frame / m_rate);
+    int nsec = (int)((m_frame - sec * m_rate) / m_rate * 1e9);
+
+    publish(m_descriptor->process(m_handle, inputs, sec, nsec), m_frame);
+    __atomic_store_n(&m_processedBlocks, m_processedBlocks + 1,
+                     __ATOMIC_RELAXED);
+
+    m_frame += m_stepSize;
+    if (m_stepSize < m_blockSize) {
+        memmove(&m_block[0], &m_block[m_stepSize],
+                (m_blockSize - m_stepSize) * sizeof(float));
+        m_blockFill = m_blockSize - m_stepSize;
+    } else {
+        m_blockFill = 0;
+        m_skip = m_stepSize - m_blockSize;
+    }
+}
+
+void
+CaptureFrontEnd::publish(VampFeatureList *fl, unsigned long frame)
+{
+    if (!fl) return;
+
+    int sec = (int)(frame / m_rate);
+    int nsec = (int)((frame - sec * m_rate) / m_rate * 1e9);
+    bool v2 = m_descriptor->vampApiVersion >= 2;
+
+    for (unsigned int o = 0; o < m_outputCount; ++o) {
+        unsigned int n = fl[o].featureCount;
+        for (unsigned int i = 0; i < n; ++i) {
+            const VampFeature &v = fl[o].features[i].v1;
+            LiveFeature *f = new LiveFeature;
+            f->output = o;
+            f->frame = frame;
+            f->sec = v.hasTimestamp ? v.sec : sec;
+            f->nsec = v.hasTimestamp ? v.nsec : nsec;
+            f->hasDuration = false;
+            f->durationSec = f->durationNsec = 0;
+            if (v2) {
+                const VampFeatureV2 &v2f = fl[o].features[n + i].v2;
+                f->hasDuration = v2f.hasDuration;
+                f->durationSec = v2f.durationSec;
+                f->durationNsec = v2f.durationNsec;
+            }
+            f->values.assign(v.values, v.values + v.valueCount);
+            if (v.label) f->label = v.label;
+            if (!m_features.write(&f, 1)) {
+                delete f;
+                __atomic_store_n(&m_droppedFeatures, m_droppedFeatures + 1,
+                                 __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+    m_descriptor->releaseFeatureSet(fl);
+}
@@ -0,0 +1,130 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _CAPTURE_FRONT_END_H_
+#define _CAPTURE_FRONT_END_H_
+
+#include <vamp/vamp.h>
+#include <pthread.h>
+
+#include <string>
+#include <vector>
+
+#include "SpscRing.h"
+
+/** A feature returned by a plugin running behind a CaptureFrontEnd */
+struct LiveFeature {
+    unsigned int output;
+    unsigned long frame;    // first frame of the block that returned it
+    int sec, nsec;          // the block time, unless the plugin set one
+    bool hasDuration;
+    int durationSec, durationNsec;
+    std::vector<float> values;
+    std::string label;
+};
+
+/** Real-time front-end running a plugin on a worker thread
+
+  A capture thread hands buffers of any size to push(), which copies
+  them into a lock-free single-producer, single-consumer ring and never
+  blocks. A worker thread takes the samples out, re-blocks them into
+  blocks of blockSize frames advancing by stepSize frames, and runs the
+  plugin on them, so a slow process() call delays the features but not
+  the capture. Features are handed to a consumer thread through a
+  second lock-free queue.
+
+  Samples that do not fit in the input ring, and features that do not
+  fit in the feature queue, are dropped and counted. Dropped samples
+  shift the timestamps of everything after them.
+
+*/
+class CaptureFrontEnd
+{
+public:
+    /** d and h are an instantiated plugin with its parameters set, of
+      which the front-end takes ownership; ringFrames is the capacity
+      of the input ring and queueSize that of the feature queue */
+    CaptureFrontEnd(const VampPluginDescriptor *d, VampPluginHandle h,
+                    float rate, unsigned int stepSize, unsigned int blockSize,
+                    size_t ringFrames, size_t queueSize);
+    ~CaptureFrontEnd();
+
+    /** initialise the plugin and start the worker thread */
+    bool start();
+
+    /** process the samples left, padding the last block with zeros,
+      publish the remaining features and stop the worker thread; call
+      after the last push() */
+    void stop();
+
+    /** capture thread: queue count mono samples */
+    void push(const float *samples, size_t count);
+
+    /** consumer thread: take the next feature, to be deleted by the
+      caller, or return 0 if there is none */
+    LiveFeature *popFeature();
+
+    unsigned long getDroppedFrames() const;
+    unsigned long getDroppedFeatures() const;
+    unsigned long getProcessedBlocks() const;
+
+protected:
+    const VampPluginDescriptor *m_descriptor;
+    VampPluginHandle m_handle;
+    float m_rate;
+    unsigned int m_stepSize;
+    unsigned int m_blockSize;
+    unsigned int m_outputCount;
+
+    SpscRing<float> m_input;
+    SpscRing<LiveFeature *> m_features;
+
+    pthread_t m_thread;
+    bool m_running;
+    int m_stopping;         // set by stop(), read by the worker
+
+    // worker state
+    std::vector<float> m_block;
+    size_t m_blockFill;     // samples received in m_block
+    size_t m_skip;          // samples to drop when stepSize > blockSize
+    unsigned long m_frame;  // first frame of m_block
+
+    // counters, each written by a single thread
+    unsigned long m_droppedFrames;
+    unsigned long m_droppedFeatures;
+    unsigned long m_processedBlocks;
+
+    static void *run(void *);
+    void work();
+    bool fillBlock();
+    void processBlock();
+    void publish(VampFeatureList *fl, unsigned long frame);
+
+private:
+    CaptureFrontEnd(const CaptureFrontEnd &);
+    CaptureFrontEnd &operator=(const CaptureFrontEnd &);
+};
+
+#endif /* _CAPTURE_FRONT_END_H_ */
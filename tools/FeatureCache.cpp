@@ -0,0 +1,269 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FeatureCache.h"
+
+using std::string;
+using std::vector;
+
+// "VAFC", then the format version, bumped with any change to the layout
+static const uint32_t cacheMagic = 0x43464156;
+static const uint32_t cacheFormat = 1;
+static const uint32_t byteOrderMark = 0x01020304;
+
+// Entry layout, in native byte order (checked with the byte order
+// mark): magic, format, byte order mark, description length, then the
+// description, the audio hash and frame count as 64-bit words, and the
+// feature count. Each feature is 8 words, output, sec, nsec, has
+// duration, duration sec, duration nsec, value count and label length,
+// followed by the values and the label.
+static const size_t featureWords = 8;
+
+static inline uint64_t
+rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+// finaliser of splitmix64
+static inline uint64_t
+mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t
+hashBytes(const string &s, uint64_t seed)
+{
+    uint64_t h = 0xcbf29ce484222325ULL ^ seed;
+    for (size_t i = 0; i < s.size(); ++i) {
+        h = (h ^ (unsigned char)s[i]) * 0x100000001b3ULL;
+    }
+    return mix64(h);
+}
+
+FeatureCache::FeatureCache(const string &directory) :
+    m_directory(directory),
+    m_hits(0),
+    m_misses(0),
+    m_tempCounter(0)
+{
+}
+
+uint64_t
+FeatureCache::hashAudio(const float *samples, size_t frames)
+{
+    // four independent lanes of 32-bit words, so that the multiplies
+    // can overlap
+    static const uint64_t c1 = 0x87c37b91114253d5ULL;
+    static const uint64_t c2 = 0x4cf5ad432745937fULL;
+    uint64_t lanes[4] = { c1, c2, c1 ^ c2, c1 + c2 };
+    const uint32_t *words = (const uint32_t *)samples;
+
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        for (int j = 0; j < 4; ++j) {
+            lanes[j] = rotl64(lanes[j] ^ (words[i + j] * c1), 31) * c2;
+        }
+    }
+    for (; i < frames; ++i) {
+        lanes[0] = rotl64(lanes[0] ^ (words[i] * c1), 31) * c2;
+    }
+
+    uint64_t h = frames;
+    for (int j = 0; j < 4; ++j) h = mix64(h ^ lanes[j]);
+    return h;
+}
+
+FeatureCache::Key
+FeatureCache::makeKey(const Vamp::Plugin *plugin, float rate,
+                      size_t stepSize, size_t blockSize,
+                      const float *samples, size_t frames) const
+{
+    Key key;
+    char buf[128];
+    snprintf(buf, sizeof(buf), " version %d rate %.9g step %lu block %lu",
+             plugin->getPluginVersion(), rate,
+             (unsigned long)stepSize, (unsigned long)blockSize);
+    key.description = plugin->getIdentifier() + buf;
+
+    // every parameter, so that a default given explicitly or left out
+    // addresses the same entry
+    Vamp::Plugin::ParameterList params = plugin->getParameterDescriptors();
+    for (size_t i = 0; i < params.size(); ++i) {
+        snprintf(buf, sizeof(buf), "=%.9g",
+                 plugin->getParameter(params[i].identifier));
+        key.description += " " + params[i].identifier + buf;
+    }
+
+    key.audioHash = hashAudio(samples, frames);
+    key.frames = frames;
+
+    uint64_t h = hashBytes(key.description, key.audioHash ^ mix64(frames));
+    snprintf(buf, sizeof(buf), "/%016llx.vafc", (unsigned long long)h);
+    key.path = m_directory + buf;
+    return key;
+}
+
+// Sequential reading of an entry held in memory, failing past its end
+class EntryReader
+{
+public:
+    EntryReader(const vector<char> &data) : m_data(data), m_pos(0) { }
+
+    bool read(void *out, size_t n) {
+        if (n > m_data.size() - m_pos) return false;
+        if (n > 0) memcpy(out, &m_data[m_pos], n);
+        m_pos += n;
+        return true;
+    }
+
+    bool atEnd() const { return m_pos == m_data.size(); }
+
+private:
+    const vector<char> &m_data;
+    size_t m_pos;
+};
+
+bool
+FeatureCache::lookup(const Key &key, vector<RingFeature> &features)
+{
+    features.clear();
+
+    vector<char> data;
+    FILE *f = fopen(key.path.c_str(), "rb");
+    if (f) {
+        char buf[65536];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+            data.insert(data.end(), buf, buf + n);
+        }
+        fclose(f);
+    }
+
+    EntryReader r(data);
+    uint32_t head[4];
+    uint64_t hash = 0, frames = 0;
+    uint32_t count = 0;
+    string description;
+    bool ok = f && r.read(head, sizeof(head)) &&
+        head[0] == cacheMagic && head[1] == cacheFormat &&
+        head[2] == byteOrderMark && head[3] == key.description.size();
+    if (ok) {
+        description.resize(head[3]);
+        ok = r.read(&description[0], head[3]) &&
+            description == key.description &&
+            r.read(&hash, sizeof(hash)) && hash == key.audioHash &&
+            r.read(&frames, sizeof(frames)) && frames == key.frames &&
+            r.read(&count, sizeof(count));
+    }
+    for (uint32_t i = 0; ok && i < count; ++i) {
+        uint32_t w[featureWords];
+        if (!r.read(w, sizeof(w)) || w[6] > data.size() || w[7] > data.size()) {
+            ok = false;
+            break;
+        }
+        RingFeature rf;
+        rf.output = w[0];
+        rf.sec = (int32_t)w[1];
+        rf.nsec = (int32_t)w[2];
+        rf.hasDuration = w[3] != 0;
+        rf.durationSec = (int32_t)w[4];
+        rf.durationNsec = (int32_t)w[5];
+        rf.values.resize(w[6]);
+        rf.label.resize(w[7]);
+        ok = r.read(rf.values.empty() ? 0 : &rf.values[0], w[6] * 4) &&
+            r.read(rf.label.empty() ? 0 : &rf.label[0], w[7]);
+        if (ok) features.push_back(rf);
+    }
+    ok = ok && r.atEnd();
+
+    if (!ok) features.clear();
+    __atomic_fetch_add(ok ? &m_hits : &m_misses, 1, __ATOMIC_RELAXED);
+    return ok;
+}
+
+bool
+FeatureCache::store(const Key &key, const vector<RingFeature> &features)
+{
+    string data;
+    uint32_t head[4] = { cacheMagic, cacheFormat, byteOrderMark,
+                         (uint32_t)key.description.size() };
+    uint32_t count = features.size();
+    data.append((const char *)head, sizeof(head));
+    data += key.description;
+    data.append((const char *)&key.audioHash, sizeof(key.audioHash));
+    data.append((const char *)&key.frames, sizeof(key.frames));
+    data.append((const char *)&count, sizeof(count));
+    for (size_t i = 0; i < features.size(); ++i) {
+        const RingFeature &rf = features[i];
+        uint32_t w[featureWords] = {
+            rf.output, (uint32_t)rf.sec, (uint32_t)rf.nsec, rf.hasDuration,
+            (uint32_t)rf.durationSec, (uint32_t)rf.durationNsec,
+            (uint32_t)rf.values.size(), (uint32_t)rf.label.size()
+        };
+        data.append((const char *)w, sizeof(w));
+        if (!rf.values.empty()) {
+            data.append((const char *)&rf.values[0], rf.values.size() * 4);
+        }
+        data += rf.label;
+    }
+
+    // written under a name of its own and renamed, so that readers
+    // never see part of an entry
+    char temp[64];
+    snprintf(temp, sizeof(temp), "/.tmp-%ld-%lu", (long)getpid(),
+             __atomic_fetch_add(&m_tempCounter, 1, __ATOMIC_RELAXED));
+    string tempPath = m_directory + temp;
+
+    FILE *f = fopen(tempPath.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    ok = (fclose(f) == 0) && ok;
+    if (ok) ok = rename(tempPath.c_str(), key.path.c_str()) == 0;
+    if (!ok) unlink(tempPath.c_str());
+    return ok;
+}
+
+unsigned long
+FeatureCache::getHitCount() const
+{
+    return __atomic_load_n(&m_hits, __ATOMIC_RELAXED);
+}
+
+unsigned long
+FeatureCache::getMissCount() const
+{
+    return __atomic_load_n(&m_misses, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,81 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _FEATURE_CACHE_H_
+#define _FEATURE_CACHE_H_
+
+#include <vamp-sdk/Plugin.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "FeatureRing.h"
+
+/** Persistent cache of the features found by a plugin configuration in
+  some audio, stored one file per entry in a directory
+
+  Entries are addressed by a hash of the audio content and of a
+  description of the configuration: plugin identifier and version,
+  sample rate, step and block sizes and the value of every parameter.
+  Bumping a plugin's version therefore leaves its old entries unused.
+  The description, audio hash and length are stored in the entry too,
+  and checked when it is read. */
+class FeatureCache
+{
+public:
+    struct Key {
+        std::string description;
+        uint64_t audioHash;
+        uint64_t frames;
+        std::string path;
+    };
+
+    FeatureCache(const std::string &directory);
+
+    /** 64-bit hash of the audio samples */
+    static uint64_t hashAudio(const float *samples, size_t frames);
+
+    /** key for the features of an initialised plugin in the audio */
+    Key makeKey(const Vamp::Plugin *plugin, float rate, size_t stepSize,
+                size_t blockSize, const float *samples, size_t frames) const;
+
+    /** read the features of an entry, returning false if there is none */
+    bool lookup(const Key &key, std::vector<RingFeature> &features);
+
+    /** write an entry, replacing any earlier one atomically */
+    bool store(const Key &key, const std::vector<RingFeature> &features);
+
+    unsigned long getHitCount() const;
+    unsigned long getMissCount() const;
+
+protected:
+    std::string m_directory;
+    unsigned long m_hits;
+    unsigned long m_misses;
+    unsigned long m_tempCounter;
+};
+
+#endif /* _FEATURE_CACHE_H_ */
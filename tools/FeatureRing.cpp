@@ -0,0 +1,175 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <string.h>
+
+#include "FeatureRing.h"
+
+static const unsigned int featureRingMagic = 0x56414652; // "VAFR"
+
+// Record layout, in 32-bit words: size in bytes, output, sec, nsec,
+// has duration, duration sec, duration nsec, value count and label
+// length, then the values and the label, padded to a whole word
+static const size_t recordWords = 9;
+
+struct FeatureRing::Header {
+    unsigned int magic;
+    unsigned int capacity;
+    char pad0[56];
+    unsigned int writeIndex;
+    char pad1[60];
+    unsigned int readIndex;
+    char pad2[60];
+};
+
+size_t
+FeatureRing::getMappingSize(size_t capacity)
+{
+    size_t size = 64;
+    while (size < capacity) size <<= 1;
+    return sizeof(Header) + size;
+}
+
+FeatureRing::FeatureRing(void *base, size_t size, bool create) :
+    m_header((Header *)base),
+    m_data(base ? (unsigned char *)base + sizeof(Header) : 0),
+    m_size(size),
+    m_capacity(0)
+{
+    if (size < sizeof(Header) + 64) return;
+    if (create) {
+        unsigned int capacity = 64;
+        while (capacity < (1u << 30) &&
+               capacity * 2 <= size - sizeof(Header)) capacity <<= 1;
+        m_header->capacity = capacity;
+        m_header->writeIndex = 0;
+        m_header->readIndex = 0;
+        __atomic_store_n(&m_header->magic, featureRingMagic,
+                         __ATOMIC_RELEASE);
+    }
+    if (__atomic_load_n(&m_header->magic, __ATOMIC_ACQUIRE) ==
+        featureRingMagic) {
+        unsigned int capacity = m_header->capacity;
+        if (capacity >= 64 && (capacity & (capacity - 1)) == 0 &&
+            capacity <= size - sizeof(Header)) {
+            m_capacity = capacity;
+        }
+    }
+}
+
+bool
+FeatureRing::isValid() const
+{
+    return m_capacity != 0;
+}
+
+size_t
+FeatureRing::getRecordSize(const RingFeature &f)
+{
+    return (recordWords + f.values.size()) * 4 +
+        ((f.label.size() + 3) & ~(size_t)3);
+}
+
+size_t
+FeatureRing::getCapacity() const
+{
+    return m_capacity;
+}
+
+void
+FeatureRing::copyIn(unsigned int index, const void *src, size_t n)
+{
+    unsigned int capacity = m_capacity;
+    unsigned int offset = index & (capacity - 1);
+    size_t first = n < capacity - offset ? n : capacity - offset;
+    memcpy(m_data + offset, src, first);
+    memcpy(m_data, (const unsigned char *)src + first, n - first);
+}
+
+void
+FeatureRing::copyOut(unsigned int index, void *dst, size_t n) const
+{
+    unsigned int capacity = m_capacity;
+    unsigned int offset = index & (capacity - 1);
+    size_t first = n < capacity - offset ? n : capacity - offset;
+    memcpy(dst, m_data + offset, first);
+    memcpy((unsigned char *)dst + first, m_data, n - first);
+}
+
+bool
+FeatureRing::write(const RingFeature &f)
+{
+    unsigned int capacity = m_capacity;
+    size_t size = getRecordSize(f);
+    unsigned int w = __atomic_load_n(&m_header->writeIndex, __ATOMIC_RELAXED);
+    unsigned int r = __atomic_load_n(&m_header->readIndex, __ATOMIC_ACQUIRE);
+    if (w - r > capacity || size > capacity - (w - r)) return false;
+
+    unsigned int head[recordWords] = {
+        (unsigned int)size, f.output, (unsigned int)f.sec,
+        (unsigned int)f.nsec, f.hasDuration, (unsigned int)f.durationSec,
+        (unsigned int)f.durationNsec, (unsigned int)f.values.size(),
+        (unsigned int)f.label.size()
+    };
+    copyIn(w, head, sizeof(head));
+    unsigned int at = w + sizeof(head);
+    if (!f.values.empty()) {
+        copyIn(at, &f.values[0], f.values.size() * 4);
+        at += f.values.size() * 4;
+    }
+    copyIn(at, f.label.data(), f.label.size());
+
+    __atomic_store_n(&m_header->writeIndex, w + (unsigned int)size,
+                     __ATOMIC_RELEASE);
+    return true;
+}
+
+bool
+FeatureRing::read(RingFeature &f)
+{
+    unsigned int r = __atomic_load_n(&m_header->readIndex, __ATOMIC_RELAXED);
+    unsigned int w = __atomic_load_n(&m_header->writeIndex, __ATOMIC_ACQUIRE);
+    if (w == r) return false;
+
+    unsigned int head[recordWords];
+    copyOut(r, head, sizeof(head));
+    f.output = head[1];
+    f.sec = (int)head[2];
+    f.nsec = (int)head[3];
+    f.hasDuration = head[4] != 0;
+    f.durationSec = (int)head[5];
+    f.durationNsec = (int)head[6];
+    f.values.resize(head[7]);
+    unsigned int at = r + sizeof(head);
+    if (!f.values.empty()) {
+        copyOut(at, &f.values[0], f.values.size() * 4);
+        at += f.values.size() * 4;
+    }
+    f.label.resize(head[8]);
+    if (!f.label.empty()) copyOut(at, &f.label[0], f.label.size());
+
+    __atomic_store_n(&m_header->readIndex, r + head[0], __ATOMIC_RELEASE);
+    return true;
+}
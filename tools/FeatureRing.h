@@ -0,0 +1,94 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _FEATURE_RING_H_
+#define _FEATURE_RING_H_
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+/** A feature as carried by a FeatureRing */
+struct RingFeature {
+    RingFeature() : output(0), sec(0), nsec(0), hasDuration(false),
+                    durationSec(0), durationNsec(0) { }
+    unsigned int output;
+    int sec, nsec;
+    bool hasDuration;
+    int durationSec, durationNsec;
+    std::vector<float> values;
+    std::string label;
+};
+
+/** Lock-free ring of variable-size feature records in memory shared
+  between two processes, one writing and one reading
+
+  The mapping starts with a header holding the capacity and the two
+  free-running byte indices, each on its own cache line and written by
+  one side only, followed by the records. The reader creates the ring;
+  the writer checks the header once, and keeps every access within the
+  capacity it found whatever the reader does to the header later.
+
+*/
+class FeatureRing
+{
+public:
+    /** bytes to map for a ring holding at least capacity bytes of
+      records */
+    static size_t getMappingSize(size_t capacity);
+
+    /** use the size bytes mapped at base, initialising the header if
+      create is true */
+    FeatureRing(void *base, size_t size, bool create);
+
+    /** whether the header is that of a ring fitting in the mapping */
+    bool isValid() const;
+
+    /** bytes a record for the feature takes */
+    static size_t getRecordSize(const RingFeature &f);
+
+    /** largest record the ring can ever hold */
+    size_t getCapacity() const;
+
+    /** writer: append a record, or return false if there is no room
+      for it yet */
+    bool write(const RingFeature &f);
+
+    /** reader: take the next record, or return false if there is none */
+    bool read(RingFeature &f);
+
+protected:
+    struct Header;
+    Header *m_header;
+    unsigned char *m_data;
+    size_t m_size;
+    unsigned int m_capacity;    // as found when constructed
+
+    void copyIn(unsigned int index, const void *src, size_t n);
+    void copyOut(unsigned int index, void *dst, size_t n) const;
+};
+
+#endif /* _FEATURE_RING_H_ */
@@ -0,0 +1,195 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+
+#include "InstancePool.h"
+#include "PluginFactory.h"
+
+using std::string;
+using std::vector;
+
+string
+PluginConfig::getKey() const
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "@%.9g/%lu/%lu", rate,
+             (unsigned long)stepSize, (unsigned long)blockSize);
+    string key = identifier + buf;
+    for (size_t i = 0; i < parameters.size(); ++i) {
+        snprintf(buf, sizeof(buf), "=%.9g", parameters[i].second);
+        key += " " + parameters[i].first + buf;
+    }
+    return key;
+}
+
+InstancePool::InstancePool(size_t maxIdle) :
+    m_maxIdle(maxIdle),
+    m_idleCount(0),
+    m_created(0),
+    m_reused(0)
+{
+    pthread_mutex_init(&m_mutex, 0);
+}
+
+InstancePool::~InstancePool()
+{
+    for (IdleMap::iterator i = m_idle.begin(); i != m_idle.end(); ++i) {
+        for (size_t j = 0; j < i->second.size(); ++j) {
+            delete i->second[j].plugin;
+        }
+    }
+    pthread_mutex_destroy(&m_mutex);
+}
+
+bool
+InstancePool::acquire(const PluginConfig &config, PluginInstance &instance,
+                      string &error)
+{
+    string key = config.getKey();
+
+    pthread_mutex_lock(&m_mutex);
+    IdleMap::iterator i = m_idle.find(key);
+    if (i != m_idle.end() && !i->second.empty()) {
+        instance = i->second.back();
+        i->second.pop_back();
+        --m_idleCount;
+        ++m_reused;
+        pthread_mutex_unlock(&m_mutex);
+        return true;
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    // created outside the lock, so that a slow initialise does not hold
+    // up requests served from the pool
+    if (!create(config, instance, error)) return false;
+
+    pthread_mutex_lock(&m_mutex);
+    ++m_created;
+    pthread_mutex_unlock(&m_mutex);
+    return true;
+}
+
+void
+InstancePool::release(const PluginConfig &config,
+                      const PluginInstance &instance)
+{
+    instance.plugin->reset();
+
+    string key = config.getKey();
+
+    pthread_mutex_lock(&m_mutex);
+    vector<PluginInstance> &idle = m_idle[key];
+    if (idle.size() < m_maxIdle) {
+        idle.push_back(instance);
+        ++m_idleCount;
+        pthread_mutex_unlock(&m_mutex);
+        return;
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    delete instance.plugin;
+}
+
+unsigned long
+InstancePool::getCreatedCount() const
+{
+    pthread_mutex_lock(&m_mutex);
+    unsigned long n = m_created;
+    pthread_mutex_unlock(&m_mutex);
+    return n;
+}
+
+unsigned long
+InstancePool::getReusedCount() const
+{
+    pthread_mutex_lock(&m_mutex);
+    unsigned long n = m_reused;
+    pthread_mutex_unlock(&m_mutex);
+    return n;
+}
+
+size_t
+InstancePool::getIdleCount() const
+{
+    pthread_mutex_lock(&m_mutex);
+    size_t n = m_idleCount;
+    pthread_mutex_unlock(&m_mutex);
+    return n;
+}
+
+bool
+InstancePool::create(const PluginConfig &config, PluginInstance &instance,
+                     string &error)
+{
+    Vamp::Plugin *plugin = createPlugin(config.identifier, config.rate);
+    if (!plugin) {
+        error = "no plugin " + config.identifier;
+        return false;
+    }
+
+    Vamp::Plugin::ParameterList params = plugin->getParameterDescriptors();
+    for (size_t i = 0; i < config.parameters.size(); ++i) {
+        bool found = false;
+        for (size_t j = 0; j < params.size(); ++j) {
+            if (params[j].identifier == config.parameters[i].first) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            error = "no parameter " + config.parameters[i].first + " in " +
+                config.identifier;
+            delete plugin;
+            return false;
+        }
+        plugin->setParameter(config.parameters[i].first,
+                             config.parameters[i].second);
+    }
+
+    size_t step = config.stepSize;
+    size_t block = config.blockSize;
+    if (block == 0) block = plugin->getPreferredBlockSize();
+    if (block == 0) block = 1024;
+    if (step == 0) step = plugin->getPreferredStepSize();
+    if (step == 0) step = block;
+
+    if (!plugin->initialise(1, step, block)) {
+        error = config.identifier + " failed to initialise";
+        delete plugin;
+        return false;
+    }
+
+    Vamp::Plugin::OutputList outputs = plugin->getOutputDescriptors();
+    instance.outputs.clear();
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        instance.outputs.push_back(outputs[i].identifier);
+    }
+
+    instance.plugin = plugin;
+    instance.stepSize = step;
+    instance.blockSize = block;
+    return true;
+}
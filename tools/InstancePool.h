@@ -0,0 +1,101 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _INSTANCE_POOL_H_
+#define _INSTANCE_POOL_H_
+
+#include <vamp-sdk/Plugin.h>
+#include <pthread.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** What an instance is configured with, and so what it can be reused
+  for: a step or block size of 0 stands for the plugin's preference */
+struct PluginConfig {
+    PluginConfig() : rate(0), stepSize(0), blockSize(0) { }
+    std::string identifier;
+    float rate;
+    size_t stepSize;
+    size_t blockSize;
+    std::vector<std::pair<std::string, float> > parameters;
+
+    /** a string identifying the configuration, parameters in order */
+    std::string getKey() const;
+};
+
+/** An initialised plugin, with the sizes it was initialised with */
+struct PluginInstance {
+    PluginInstance() : plugin(0), stepSize(0), blockSize(0) { }
+    Vamp::Plugin *plugin;
+    size_t stepSize;
+    size_t blockSize;
+    std::vector<std::string> outputs;
+};
+
+/** Pools of initialised plugin instances, shared by several threads
+
+  acquire() hands out an idle instance of the configuration, which
+  release() has reset, or creates and initialises a new one; at most
+  maxIdle instances per configuration are kept. */
+class InstancePool
+{
+public:
+    InstancePool(size_t maxIdle);
+    ~InstancePool();
+
+    /** get an instance for config, returning false and setting error
+      if it cannot be created */
+    bool acquire(const PluginConfig &config, PluginInstance &instance,
+                 std::string &error);
+
+    /** reset the instance and return it to the pool */
+    void release(const PluginConfig &config, const PluginInstance &instance);
+
+    unsigned long getCreatedCount() const;
+    unsigned long getReusedCount() const;
+    size_t getIdleCount() const;
+
+protected:
+    typedef std::map<std::string, std::vector<PluginInstance> > IdleMap;
+
+    size_t m_maxIdle;
+    IdleMap m_idle;
+    size_t m_idleCount;
+    unsigned long m_created;
+    unsigned long m_reused;
+    mutable pthread_mutex_t m_mutex;
+
+    static bool create(const PluginConfig &config, PluginInstance &instance,
+                       std::string &error);
+
+private:
+    InstancePool(const InstancePool &);
+    InstancePool &operator=(const InstancePool &);
+};
+
+#endif /* _INSTANCE_POOL_H_ */
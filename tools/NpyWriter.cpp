@@ -0,0 +1,153 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include "NpyWriter.h"
+
+#include <stdint.h>
+#include <string.h>
+
+static const size_t headerSize = 128;
+static const size_t bufferRows = 256;
+
+NpyWriter::NpyWriter() :
+    m_file(0),
+    m_bins(0),
+    m_rows(0),
+    m_swap(false),
+    m_buffer(0)
+{
+    uint32_t word = 1;
+    unsigned char first;
+    memcpy(&first, &word, 1);
+    m_swap = (first != 1);
+}
+
+NpyWriter::~NpyWriter()
+{
+    if (m_file) close();
+}
+
+bool
+NpyWriter::open(const std::string &path, size_t bins)
+{
+    if (m_file) close();
+
+    m_file = fopen(path.c_str(), "wb");
+    if (!m_file) {
+        perror(path.c_str());
+        return false;
+    }
+    setvbuf(m_file, 0, _IOFBF, 1 << 20);
+
+    m_path = path;
+    m_bins = bins;
+    m_rows = 0;
+    if (m_swap) m_buffer = new float[bufferRows * bins];
+
+    return writeHeader();
+}
+
+bool
+NpyWriter::writeHeader()
+{
+    char dict[headerSize];
+    int n = snprintf(dict, sizeof(dict),
+                     "{'descr': '<f4', 'fortran_order': False, "
+                     "'shape': (%lu, %lu), }",
+                     (unsigned long)m_rows, (unsigned long)m_bins);
+    if (n < 0 || (size_t)n + 11 > headerSize) return false;
+
+    // magic, version 1.0, header length, then the dictionary padded
+    // with spaces and ending in a newline
+    unsigned char head[headerSize];
+    memset(head, ' ', headerSize);
+    memcpy(head, "\x93NUMPY\x01\x00", 8);
+    head[8] = (headerSize - 10) & 0xff;
+    head[9] = (headerSize - 10) >> 8;
+    memcpy(head + 10, dict, n);
+    head[headerSize - 1] = '\n';
+
+    if (fwrite(head, 1, headerSize, m_file) != headerSize) {
+        perror(m_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+static void
+swapWords(const float *in, float *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t w;
+        memcpy(&w, &in[i], 4);
+        w = (w >> 24) | ((w >> 8) & 0xff00) |
+            ((w << 8) & 0xff0000) | (w << 24);
+        memcpy(&out[i], &w, 4);
+    }
+}
+
+bool
+NpyWriter::write(const float *values, size_t rows)
+{
+    if (!m_file) return false;
+
+    if (!m_swap) {
+        if (fwrite(values, sizeof(float) * m_bins, rows, m_file) != rows) {
+            perror(m_path.c_str());
+            return false;
+        }
+    } else {
+        for (size_t done = 0; done < rows; done += bufferRows) {
+            size_t n = rows - done < bufferRows ? rows - done : bufferRows;
+            swapWords(values + done * m_bins, m_buffer, n * m_bins);
+            if (fwrite(m_buffer, sizeof(float) * m_bins, n, m_file) != n) {
+                perror(m_path.c_str());
+                return false;
+            }
+        }
+    }
+
+    m_rows += rows;
+    return true;
+}
+
+bool
+NpyWriter::close()
+{
+    if (!m_file) return false;
+
+    bool ok = (fseek(m_file, 0, SEEK_SET) == 0 && writeHeader());
+    if (fclose(m_file) != 0) {
+        perror(m_path.c_str());
+        ok = false;
+    }
+    m_file = 0;
+
+    delete[] m_buffer;
+    m_buffer = 0;
+
+    return ok;
+}
@@ -0,0 +1,73 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef _NPY_WRITER_H_
+#define _NPY_WRITER_H_
+
+#include <stdio.h>
+
+#include <string>
+
+/** Writer of a matrix of float32 values, one row at a time, to a numpy
+  .npy file (format version 1.0, little-endian, C order)
+
+  The number of rows is only known at the end, so the header is written
+  with room for any row count and filled in by close(). It is padded
+  to 128 bytes, which leaves the data 64-byte aligned for readers that
+  map the file, as numpy.load(path, mmap_mode='r') does. */
+class NpyWriter
+{
+public:
+    NpyWriter();
+    ~NpyWriter();
+
+    /** create or truncate path for rows of bins values */
+    bool open(const std::string &path, size_t bins);
+
+    /** append rows, each of bins values */
+    bool write(const float *values, size_t rows);
+
+    /** write the final row count into the header and close the file */
+    bool close();
+
+    size_t getBinCount() const { return m_bins; }
+    size_t getRowCount() const { return m_rows; }
+
+private:
+    FILE *m_file;
+    std::string m_path;
+    size_t m_bins;
+    size_t m_rows;
+    bool m_swap;
+    float *m_buffer;
+
+    bool writeHeader();
+
+    NpyWriter(const NpyWriter &);
+    NpyWriter &operator=(const NpyWriter &);
+};
+
+#endif /* _NPY_WRITER_H_ */
@@ -0,0 +1,51 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "PluginFactory.h"
+
+#include "plugins/Onset.h"
+#include "plugins/Pitch.h"
+#include "plugins/Notes.h"
+#include "plugins/Tempo.h"
+#include "plugins/Silence.h"
+#include "plugins/Mfcc.h"
+#include "plugins/MelEnergy.h"
+#include "plugins/SpecDesc.h"
+#include "plugins/Segments.h"
+
+Vamp::Plugin *
+createPlugin(const std::string &identifier, float rate)
+{
+    if (identifier == "aubioonset") return new Onset(rate);
+    if (identifier == "aubiopitch") return new Pitch(rate);
+    if (identifier == "aubionotes") return new Notes(rate);
+    if (identifier == "aubiotempo") return new Tempo(rate);
+    if (identifier == "aubiosilence") return new Silence(rate);
+    if (identifier == "aubiomfcc") return new Mfcc(rate);
+    if (identifier == "aubiomelenergy") return new MelEnergy(rate);
+    if (identifier == "aubiospecdesc") return new SpecDesc(rate);
+    if (identifier == "aubiosegments") return new Segments(rate);
+    return 0;
+}
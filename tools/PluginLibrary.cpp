@@ -0,0 +1,59 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "PluginLibrary.h"
+
+bool
+openLibrary(Library &lib, const char *path, const char *program)
+{
+    lib.path = path;
+    lib.handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!lib.handle) {
+        fprintf(stderr, "%s: %s\n", program, dlerror());
+        return false;
+    }
+    lib.fn = (VampGetPluginDescriptorFunction)
+        dlsym(lib.handle, "vampGetPluginDescriptor");
+    if (!lib.fn) {
+        fprintf(stderr, "%s: %s: no vampGetPluginDescriptor\n",
+                program, path);
+        return false;
+    }
+    return true;
+}
+
+const VampPluginDescriptor *
+findPlugin(const Library &lib, const char *identifier)
+{
+    for (unsigned int index = 0; ; ++index) {
+        const VampPluginDescriptor *d = lib.fn(VAMP_API_VERSION, index);
+        if (!d) return 0;
+        if (!strcmp(d->identifier, identifier)) return d;
+    }
+}
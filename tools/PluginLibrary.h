@@ -0,0 +1,48 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _PLUGIN_LIBRARY_H_
+#define _PLUGIN_LIBRARY_H_
+
+#include <vamp/vamp.h>
+
+#include <string>
+
+/** A plugin library opened with dlopen, and its descriptor function */
+struct Library {
+    std::string path;
+    void *handle;
+    VampGetPluginDescriptorFunction fn;
+};
+
+/** open the library at path, reporting errors on stderr prefixed by the
+  program name */
+bool openLibrary(Library &lib, const char *path, const char *program);
+
+/** find the descriptor of the plugin with the given identifier, or 0 */
+const VampPluginDescriptor *findPlugin(const Library &lib,
+                                       const char *identifier);
+
+#endif /* _PLUGIN_LIBRARY_H_ */
@@ -0,0 +1,146 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "SharedMemory.h"
+
+// descriptors passed with a single message
+static const int maxDescriptors = 8;
+
+int
+createSharedMemory(size_t size)
+{
+#if defined(__linux__) && defined(SYS_memfd_create)
+    // 1 is MFD_CLOEXEC, which older headers do not define
+    int fd = syscall(SYS_memfd_create, "vamp-aubio", 1);
+#else
+    // a named object, unlinked at once
+    static int counter = 0;
+    char name[64];
+    snprintf(name, sizeof(name), "/vamp-aubio-%ld-%d",
+             (long)getpid(), counter++);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0) shm_unlink(name);
+#endif
+    if (fd < 0) return -1;
+    if (ftruncate(fd, size) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool
+sendWithDescriptors(int socket, const char *data, size_t n,
+                    const int *fds, int count)
+{
+    if (n == 0 || count > maxDescriptors) return false;
+
+    char control[CMSG_SPACE(maxDescriptors * sizeof(int))];
+    memset(control, 0, sizeof(control));
+
+    struct iovec iov;
+    iov.iov_base = (void *)data;
+    iov.iov_len = n;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (count > 0) {
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(count * sizeof(int));
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(count * sizeof(int));
+        memcpy(CMSG_DATA(cmsg), fds, count * sizeof(int));
+    }
+
+    ssize_t sent;
+    do {
+        sent = sendmsg(socket, &msg, 0);
+    } while (sent < 0 && errno == EINTR);
+    if (sent <= 0) return false;
+
+    // the descriptors went with the first part
+    data += sent;
+    n -= sent;
+    while (n > 0) {
+        ssize_t w = write(socket, data, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        data += w;
+        n -= w;
+    }
+    return true;
+}
+
+ssize_t
+receiveWithDescriptors(int socket, char *data, size_t n,
+                       std::vector<int> &fds)
+{
+    char control[CMSG_SPACE(maxDescriptors * sizeof(int))];
+
+    struct iovec iov;
+    iov.iov_base = data;
+    iov.iov_len = n;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    int flags = 0;
+#ifdef MSG_CMSG_CLOEXEC
+    flags |= MSG_CMSG_CLOEXEC;
+#endif
+    ssize_t r = recvmsg(socket, &msg, flags);
+    if (r < 0) return r;
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+        int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (int i = 0; i < count; ++i) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+            fds.push_back(fd);
+        }
+    }
+    return r;
+}
@@ -0,0 +1,47 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _SHARED_MEMORY_H_
+#define _SHARED_MEMORY_H_
+
+#include <sys/types.h>
+
+#include <vector>
+
+/** Create an anonymous shared memory file of size bytes, a memfd on
+  Linux, returning its descriptor or -1 */
+int createSharedMemory(size_t size);
+
+/** Send n bytes on a Unix domain socket, with count file descriptors
+  attached to the first of them */
+bool sendWithDescriptors(int socket, const char *data, size_t n,
+                         const int *fds, int count);
+
+/** Receive up to n bytes from a Unix domain socket, appending any file
+  descriptors passed with them to fds; returns as read() does */
+ssize_t receiveWithDescriptors(int socket, char *data, size_t n,
+                               std::vector<int> &fds);
+
+#endif /* _SHARED_MEMORY_H_ */
@@ -0,0 +1,121 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _SPSC_RING_H_
+#define _SPSC_RING_H_
+
+#include <stddef.h>
+
+/** Lock-free ring buffer for one producer thread and one consumer thread
+
+  Reads and writes never block nor allocate, so the producer can be a
+  real-time capture thread. Each side only writes its own free-running
+  index, published with release stores and read with acquire loads
+  (gcc and clang atomic builtins). The capacity is rounded up to a
+  power of two.
+
+*/
+template <typename T>
+class SpscRing
+{
+public:
+    SpscRing(size_t capacity) :
+        m_writeIndex(0),
+        m_readIndex(0)
+    {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        m_buffer = new T[size];
+        m_mask = size - 1;
+    }
+
+    ~SpscRing() { delete[] m_buffer; }
+
+    size_t getCapacity() const { return m_mask + 1; }
+
+    /** number of items the consumer can read */
+    size_t getReadSpace() const {
+        return __atomic_load_n(&m_writeIndex, __ATOMIC_ACQUIRE) -
+            __atomic_load_n(&m_readIndex, __ATOMIC_RELAXED);
+    }
+
+    /** number of items the producer can write */
+    size_t getWriteSpace() const {
+        return getCapacity() -
+            (__atomic_load_n(&m_writeIndex, __ATOMIC_RELAXED) -
+             __atomic_load_n(&m_readIndex, __ATOMIC_ACQUIRE));
+    }
+
+    /** producer: write up to n items, returning the number written */
+    size_t write(const T *data, size_t n) {
+        size_t w = __atomic_load_n(&m_writeIndex, __ATOMIC_RELAXED);
+        size_t space = getWriteSpace();
+        if (n > space) n = space;
+        for (size_t i = 0; i < n; ++i) m_buffer[(w + i) & m_mask] = data[i];
+        __atomic_store_n(&m_writeIndex, w + n, __ATOMIC_RELEASE);
+        return n;
+    }
+
+    /** consumer: copy up to n items without consuming them, returning
+      the number copied */
+    size_t peek(T *data, size_t n) const {
+        size_t r = __atomic_load_n(&m_readIndex, __ATOMIC_RELAXED);
+        size_t avail = getReadSpace();
+        if (n > avail) n = avail;
+        for (size_t i = 0; i < n; ++i) data[i] = m_buffer[(r + i) & m_mask];
+        return n;
+    }
+
+    /** consumer: drop up to n items, returning the number dropped */
+    size_t skip(size_t n) {
+        size_t r = __atomic_load_n(&m_readIndex, __ATOMIC_RELAXED);
+        size_t avail = getReadSpace();
+        if (n > avail) n = avail;
+        __atomic_store_n(&m_readIndex, r + n, __ATOMIC_RELEASE);
+        return n;
+    }
+
+    /** consumer: read up to n items, returning the number read */
+    size_t read(T *data, size_t n) {
+        return skip(peek(data, n));
+    }
+
+protected:
+    T *m_buffer;
+    size_t m_mask;
+
+    // keep the two indices on separate cache lines
+    char m_pad0[64];
+    size_t m_writeIndex;
+    char m_pad1[64];
+    size_t m_readIndex;
+    char m_pad2[64];
+
+private:
+    SpscRing(const SpscRing &);
+    SpscRing &operator=(const SpscRing &);
+};
+
+#endif /* _SPSC_RING_H_ */
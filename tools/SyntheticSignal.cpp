@@ -0,0 +1,75 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <math.h>
+
+#include "SyntheticSignal.h"
+
+using std::vector;
+
+// Deterministic white noise, so that all runs see the same input
+static float
+noise(unsigned int &state)
+{
+    state = state * 1664525u + 1013904223u;
+    return (float)(state >> 8) / (float)(1u << 23) - 1.f;
+}
+
+void
+makeSignal(vector<float> &buf, float rate)
+{
+    const size_t n = buf.size();
+    const size_t notes = n * 4 / 10;
+    const size_t bursts = n * 6 / 10;
+    const size_t glide = n * 8 / 10;
+    const size_t beat = (size_t)(rate * 0.5); // 120 bpm
+    static const int scale[] = { 48, 52, 55, 60, 64, 67, 72, 69, 65, 62 };
+    unsigned int seed = 1;
+
+    for (size_t i = 0; i < n; ++i) {
+        float s = 0.f;
+        if (i < notes) {
+            size_t k = i / beat;
+            float t = (i % beat) / rate;
+            float f0 = 440.f * powf(2.f, (scale[k % 10] - 69) / 12.f);
+            for (int h = 1; h <= 4; ++h) {
+                s += sinf(2.f * M_PI * f0 * h * t) * expf(-6.f * t) / h;
+            }
+            if (t < 0.002f) s += 0.3f * noise(seed);
+            s *= 0.4f;
+        } else if (i < bursts) {
+            size_t k = (i - notes) / beat;
+            if (k % 2 == 0) s = 0.3f * noise(seed);
+        } else if (i < glide) {
+            float t = (i - bursts) / rate;
+            float f0 = 110.f * powf(2.f, 2.f * (i - bursts) / (float)(glide - bursts));
+            s = 0.5f * sinf(2.f * M_PI * f0 * t);
+        } else {
+            float t = (i - glide) / rate;
+            s = 0.5f * sinf(2.f * M_PI * 220.f * t) * expf(-20.f * t);
+        }
+        buf[i] = s;
+    }
+}
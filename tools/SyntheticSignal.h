@@ -0,0 +1,37 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef _SYNTHETIC_SIGNAL_H_
+#define _SYNTHETIC_SIGNAL_H_
+
+#include <vector>
+
+/** Fill buf with a deterministic signal exercising every plugin: plucked
+  notes at a steady tempo (onsets, beats, notes, pitch), noise bursts
+  separated by gaps (silence, spectral descriptors), a slow pitch glide,
+  and a long decaying tail ending in digital silence. */
+void makeSignal(std::vector<float> &buf, float rate);
+
+#endif /* _SYNTHETIC_SIGNAL_H_ */
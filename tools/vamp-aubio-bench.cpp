@@ -0,0 +1,424 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Synthetic workload runner for vamp-aubio.
+//
+// Loads one or two builds of the plugin library through the plain Vamp
+// C API and runs every plugin they contain over a generated signal.
+// The same run serves as the training workload of the profile-guided
+// build (see ./build_pgo.sh at the top of the tree) and, given two
+// libraries, reports the per-plugin speedup of the second one over the
+// first. With -j, it instead runs the plugins on several threads at
+// once, checking that every thread gets the same features and reporting
+// how throughput scales with the number of threads.
+
+#include <vamp/vamp.h>
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+#include "PluginLibrary.h"
+#include "SyntheticSignal.h"
+
+using std::string;
+using std::vector;
+
+static double
+now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct Setting {
+    string identifier;
+    float value;
+};
+
+// Modes of a plugin benchmarked on a row of their own, after the
+// plugin's row with the settings given on the command line
+struct Variant {
+    const char *plugin;
+    Setting setting;
+};
+
+static const Variant variants[] = {
+    { "aubionotes", { "offline", 1 } },
+};
+
+// Fold the features returned for all outputs into an FNV-1a hash
+static void
+hashFeatures(unsigned long &hash, const VampFeatureList *fl,
+             unsigned int outputs)
+{
+    for (unsigned int o = 0; o < outputs; ++o) {
+        for (unsigned int i = 0; i < fl[o].featureCount; ++i) {
+            const VampFeature &f = fl[o].features[i].v1;
+            int words[4] = { (int)o, f.hasTimestamp,
+                             f.hasTimestamp ? f.sec : 0,
+                             f.hasTimestamp ? f.nsec : 0 };
+            const unsigned char *bytes[2] = {
+                (const unsigned char *)words,
+                (const unsigned char *)f.values
+            };
+            size_t sizes[2] = { sizeof(words), f.valueCount * sizeof(float) };
+            for (int b = 0; b < 2; ++b) {
+                for (size_t j = 0; j < sizes[b]; ++j) {
+                    hash = (hash ^ bytes[b][j]) * 16777619UL;
+                }
+            }
+        }
+    }
+}
+
+// Run one plugin over the whole signal, returning the time spent in
+// initialise, process and getRemainingFeatures, or -1 on failure.
+// Settings apply to the plugins having a parameter of that identifier.
+// If hash is given, the features returned are folded into it.
+static double
+runPlugin(const VampPluginDescriptor *d, const vector<float> &signal,
+          float rate, const vector<Setting> &settings,
+          unsigned long *hash = 0)
+{
+    VampPluginHandle h = d->instantiate(d, rate);
+    if (!h) return -1;
+
+    for (size_t s = 0; s < settings.size(); ++s) {
+        for (unsigned int p = 0; p < d->parameterCount; ++p) {
+            if (settings[s].identifier == d->parameters[p]->identifier) {
+                d->setParameter(h, p, settings[s].value);
+            }
+        }
+    }
+
+    unsigned int step = d->getPreferredStepSize(h);
+    unsigned int block = d->getPreferredBlockSize(h);
+    if (block == 0) block = 1024;
+    if (step == 0) step = block;
+
+    vector<float> in(block, 0.f);
+    const float *inputs[1] = { &in[0] };
+    size_t features = 0;
+
+    double start = now();
+
+    if (!d->initialise(h, 1, step, block)) {
+        d->cleanup(h);
+        return -1;
+    }
+
+    unsigned int outputs = d->getOutputCount(h);
+
+    for (size_t pos = 0; pos < signal.size(); pos += step) {
+        size_t avail = signal.size() - pos;
+        if (avail > block) avail = block;
+        memcpy(&in[0], &signal[pos], avail * sizeof(float));
+        if (avail < block) {
+            memset(&in[avail], 0, (block - avail) * sizeof(float));
+        }
+        long sec = pos / (long)rate;
+        long nsec = (long)((pos - sec * rate) / rate * 1e9);
+        VampFeatureList *fl = d->process(h, inputs, sec, nsec);
+        if (fl) {
+            for (unsigned int o = 0; o < outputs; ++o) {
+                features += fl[o].featureCount;
+            }
+            if (hash) hashFeatures(*hash, fl, outputs);
+            d->releaseFeatureSet(fl);
+        }
+    }
+
+    VampFeatureList *fl = d->getRemainingFeatures(h);
+    if (fl) {
+        for (unsigned int o = 0; o < outputs; ++o) {
+            features += fl[o].featureCount;
+        }
+        if (hash) hashFeatures(*hash, fl, outputs);
+        d->releaseFeatureSet(fl);
+    }
+
+    double elapsed = now() - start;
+
+    d->cleanup(h);
+
+    if (features == 0) {
+        fprintf(stderr, "vamp-aubio-bench: %s returned no features\n",
+                d->identifier);
+    }
+    return elapsed;
+}
+
+// One thread of a stress run: every selected plugin, each instantiated
+// by the thread itself, one after the other
+struct StressJob {
+    const vector<const VampPluginDescriptor *> *plugins;
+    const vector<float> *signal;
+    float rate;
+    const vector<Setting> *settings;
+    vector<unsigned long> hashes;
+    bool failed;
+};
+
+static void *
+runStressJob(void *arg)
+{
+    StressJob *job = (StressJob *)arg;
+    job->hashes.clear();
+    job->failed = false;
+    for (size_t p = 0; p < job->plugins->size(); ++p) {
+        const VampPluginDescriptor *d = (*job->plugins)[p];
+        unsigned long hash = 2166136261UL;
+        if (runPlugin(d, *job->signal, job->rate, *job->settings, &hash) < 0) {
+            fprintf(stderr, "vamp-aubio-bench: %s failed to run\n",
+                    d->identifier);
+            job->failed = true;
+        }
+        job->hashes.push_back(hash);
+    }
+    return 0;
+}
+
+// Run the plugins on 1, 2, 4... up to maxThreads threads at once.
+// Instances are created, reset and run concurrently, so running the
+// library built with -fsanitize=thread also checks it for data races.
+static int
+runStress(const Library &lib, const char *only, const vector<float> &signal,
+          float rate, const vector<Setting> &settings, int maxThreads)
+{
+    float duration = signal.size() / rate;
+    vector<unsigned long> reference;
+    double single = 0;
+
+    // the SDK's adapters fill their descriptors in on first use, so get
+    // them all before starting any thread
+    vector<const VampPluginDescriptor *> plugins;
+    for (unsigned int index = 0; ; ++index) {
+        const VampPluginDescriptor *d = lib.fn(VAMP_API_VERSION, index);
+        if (!d) break;
+        if (only && strcmp(only, d->identifier)) continue;
+        plugins.push_back(d);
+    }
+
+    printf("%-8s  %10s %8s  %8s\n", "threads", "seconds", "x rt", "scaling");
+
+    for (int threads = 1; ; threads *= 2) {
+        if (threads > maxThreads) threads = maxThreads;
+
+        vector<StressJob> jobs(threads);
+        vector<pthread_t> ids(threads);
+        double start = now();
+        for (int t = 0; t < threads; ++t) {
+            StressJob &job = jobs[t];
+            job.plugins = &plugins;
+            job.signal = &signal;
+            job.rate = rate;
+            job.settings = &settings;
+            if (pthread_create(&ids[t], 0, runStressJob, &job)) {
+                fprintf(stderr, "vamp-aubio-bench: cannot create thread\n");
+                return 1;
+            }
+        }
+        for (int t = 0; t < threads; ++t) pthread_join(ids[t], 0);
+        double elapsed = now() - start;
+
+        for (int t = 0; t < threads; ++t) {
+            if (jobs[t].failed) return 1;
+            if (reference.empty()) reference = jobs[t].hashes;
+            for (size_t p = 0; p < reference.size(); ++p) {
+                if (jobs[t].hashes[p] == reference[p]) continue;
+                fprintf(stderr, "vamp-aubio-bench: %s returned different "
+                        "features on %d threads\n",
+                        plugins[p]->identifier, threads);
+                return 1;
+            }
+        }
+
+        double throughput = threads * duration / elapsed;
+        if (threads == 1) single = throughput;
+        printf("%-8d  %10.4f %8.1f  %7.2fx\n", threads, elapsed,
+               throughput, throughput / single);
+
+        if (threads == maxThreads) break;
+    }
+
+    return 0;
+}
+
+static void
+usage()
+{
+    fprintf(stderr,
+            "usage: vamp-aubio-bench [-d seconds] [-r rate] [-n repeats] "
+            "[-p plugin] [-s parameter=value]... library [optimised-library]\n"
+            "       vamp-aubio-bench -j threads [-d seconds] [-r rate] "
+            "[-p plugin] [-s parameter=value]... library\n"
+            "\n"
+            "Run every plugin in library over a synthetic signal. If a second\n"
+            "library is given, report its speedup over the first one. Each -s\n"
+            "sets a parameter of the plugins that have it. Some plugins have\n"
+            "extra rows for their other modes, such as aubionotes offline=1.\n"
+            "With -j, run them on up to threads threads at once, checking that\n"
+            "each thread gets the same features, and report the scaling of the\n"
+            "throughput.\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    float duration = 60;
+    float rate = 44100;
+    int repeats = 3;
+    int threads = 0;
+    const char *only = 0;
+    vector<Setting> settings;
+    vector<Library> libs;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+            duration = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            rate = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            repeats = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+            if (threads < 1) {
+                usage();
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+            only = argv[++i];
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            const char *arg = argv[++i];
+            const char *eq = strchr(arg, '=');
+            if (!eq || eq == arg) {
+                usage();
+                return 2;
+            }
+            Setting setting;
+            setting.identifier = string(arg, eq - arg);
+            setting.value = atof(eq + 1);
+            settings.push_back(setting);
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 2;
+        } else {
+            Library lib;
+            if (!openLibrary(lib, argv[i], "vamp-aubio-bench")) return 1;
+            libs.push_back(lib);
+        }
+    }
+
+    if (libs.empty() || libs.size() > 2 || duration <= 0 || rate <= 0 ||
+        repeats < 1 || (threads && libs.size() > 1)) {
+        usage();
+        return 2;
+    }
+
+    vector<float> signal((size_t)(duration * rate));
+    makeSignal(signal, rate);
+
+    if (threads) {
+        int result = runStress(libs[0], only, signal, rate, settings, threads);
+        dlclose(libs[0].handle);
+        return result;
+    }
+
+    printf("%-16s", "plugin");
+    for (size_t l = 0; l < libs.size(); ++l) printf("  %10s %8s", "seconds", "x rt");
+    if (libs.size() == 2) printf("  %8s", "speedup");
+    printf("\n");
+
+    double total[2] = { 0, 0 };
+
+    for (unsigned int index = 0; ; ++index) {
+        const VampPluginDescriptor *d = libs[0].fn(VAMP_API_VERSION, index);
+        if (!d) break;
+        if (only && strcmp(only, d->identifier)) continue;
+
+        vector<string> labels(1, d->identifier);
+        vector<vector<Setting> > rows(1, settings);
+        for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); ++v) {
+            if (strcmp(variants[v].plugin, d->identifier)) continue;
+            char label[64];
+            snprintf(label, sizeof(label), " %s=%g",
+                     variants[v].setting.identifier.c_str(),
+                     variants[v].setting.value);
+            labels.push_back(label);
+            rows.push_back(settings);
+            rows.back().push_back(variants[v].setting);
+        }
+
+        for (size_t row = 0; row < rows.size(); ++row) {
+
+            double best[2] = { -1, -1 };
+
+            for (size_t l = 0; l < libs.size(); ++l) {
+                const VampPluginDescriptor *ld = libs[l].fn(VAMP_API_VERSION, index);
+                if (!ld || strcmp(ld->identifier, d->identifier)) {
+                    fprintf(stderr, "vamp-aubio-bench: %s: no plugin %s at index %u\n",
+                            libs[l].path.c_str(), d->identifier, index);
+                    return 1;
+                }
+                for (int r = 0; r < repeats; ++r) {
+                    double t = runPlugin(ld, signal, rate, rows[row]);
+                    if (t < 0) {
+                        fprintf(stderr, "vamp-aubio-bench: %s failed to run\n",
+                                d->identifier);
+                        return 1;
+                    }
+                    if (best[l] < 0 || t < best[l]) best[l] = t;
+                }
+                // variants are extra work, not part of the total
+                if (row == 0) total[l] += best[l];
+            }
+
+            printf("%-16s", labels[row].c_str());
+            for (size_t l = 0; l < libs.size(); ++l) {
+                printf("  %10.4f %8.1f", best[l], duration / best[l]);
+            }
+            if (libs.size() == 2) printf("  %7.2fx", best[0] / best[1]);
+            printf("\n");
+        }
+    }
+
+    printf("%-16s", "total");
+    for (size_t l = 0; l < libs.size(); ++l) {
+        printf("  %10.4f %8s", total[l], "");
+    }
+    if (libs.size() == 2 && total[1] > 0) printf("  %7.2fx", total[0] / total[1]);
+    printf("\n");
+
+    for (size_t l = 0; l < libs.size(); ++l) dlclose(libs[l].handle);
+
+    return 0;
+}
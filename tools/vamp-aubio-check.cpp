@@ -0,0 +1,1634 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Reproducible checks of vamp-aubio, against the aubio it is built with.
+//
+// Each check runs plugins, linked in from the plugin sources, over the
+// synthetic signal of vamp-aubio-bench or over a signal of its own,
+// prints what it measures, and fails when a measurement falls outside
+// the bound stated next to it. They back the accuracy and speed claims
+// made for the optional modes of the plugins, so that those can be
+// repeated on every platform and with every version of aubio. With no
+// check named, all of them run:
+//
+//     $ ./build/vamp-aubio-check
+//     $ ./build/vamp-aubio-check -d 120 encoding
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "PluginFactory.h"
+#include "SyntheticSignal.h"
+#include "plugins/AubioLock.h"
+#include "plugins/Checkpoint.h"
+#include "plugins/DenormalGuard.h"
+#include "plugins/MagnitudeSpectrum.h"
+#include "plugins/PcmInput.h"
+#include "plugins/Resampler.h"
+
+using std::string;
+using std::vector;
+
+typedef vector<std::pair<string, float> > Settings;
+typedef Vamp::Plugin::FeatureSet FeatureSet;
+typedef Vamp::Plugin::FeatureList FeatureList;
+
+struct Options {
+    float rate;
+    vector<float> signal;
+};
+
+static double
+now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static Settings
+settings(const char *identifier, float value)
+{
+    Settings s;
+    s.push_back(std::make_pair(string(identifier), value));
+    return s;
+}
+
+static Settings
+settings(const char *identifier1, float value1,
+         const char *identifier2, float value2)
+{
+    Settings s = settings(identifier1, value1);
+    s.push_back(std::make_pair(string(identifier2), value2));
+    return s;
+}
+
+// Create and initialise a plugin with the given parameters, at its
+// preferred step and block sizes unless given, or return 0
+static Vamp::Plugin *
+makePlugin(const string &identifier, float rate, const Settings &settings,
+           size_t &step, size_t &block)
+{
+    Vamp::Plugin *plugin = createPlugin(identifier, rate);
+    if (!plugin) {
+        fprintf(stderr, "vamp-aubio-check: no plugin %s\n",
+                identifier.c_str());
+        return 0;
+    }
+    for (size_t i = 0; i < settings.size(); ++i) {
+        plugin->setParameter(settings[i].first, settings[i].second);
+    }
+    if (step == 0) step = plugin->getPreferredStepSize();
+    if (block == 0) block = plugin->getPreferredBlockSize();
+    if (step == 0) step = block;
+    if (!plugin->initialise(1, step, block)) {
+        fprintf(stderr, "vamp-aubio-check: cannot initialise %s\n",
+                identifier.c_str());
+        delete plugin;
+        return 0;
+    }
+    return plugin;
+}
+
+static void
+append(FeatureSet &all, const FeatureSet &fs)
+{
+    for (FeatureSet::const_iterator i = fs.begin(); i != fs.end(); ++i) {
+        FeatureList &list = all[i->first];
+        list.insert(list.end(), i->second.begin(), i->second.end());
+    }
+}
+
+// Run an initialised plugin over the signal, collecting all its
+// features, and return the time spent in process() and
+// getRemainingFeatures()
+static double
+runPlugin(Vamp::Plugin *plugin, const vector<float> &signal, float rate,
+          size_t step, size_t block, FeatureSet &features)
+{
+    vector<float> in(block, 0.f);
+    const float *inputs[1] = { &in[0] };
+    double elapsed = 0;
+
+    for (size_t pos = 0; pos < signal.size(); pos += step) {
+        size_t avail = signal.size() - pos;
+        if (avail > block) avail = block;
+        memcpy(&in[0], &signal[pos], avail * sizeof(float));
+        if (avail < block) {
+            memset(&in[avail], 0, (block - avail) * sizeof(float));
+        }
+        Vamp::RealTime timestamp =
+            Vamp::RealTime::frame2RealTime(pos, lrintf(rate));
+        double start = now();
+        FeatureSet fs = plugin->process(inputs, timestamp);
+        elapsed += now() - start;
+        append(features, fs);
+    }
+
+    double start = now();
+    FeatureSet fs = plugin->getRemainingFeatures();
+    elapsed += now() - start;
+    append(features, fs);
+
+    return elapsed;
+}
+
+// Create a plugin, run it over the signal and delete it; false if it
+// could not be created
+static bool
+runPlugin(const string &identifier, const Options &options,
+          const Settings &settings, FeatureSet &features,
+          double *elapsed = 0, size_t step = 0, size_t block = 0)
+{
+    Vamp::Plugin *plugin = makePlugin(identifier, options.rate, settings,
+                                      step, block);
+    if (!plugin) return false;
+    double t = runPlugin(plugin, options.signal, options.rate,
+                         step, block, features);
+    if (elapsed) *elapsed = t;
+    delete plugin;
+    return true;
+}
+
+// Run as above, but three times, giving the features of the first run
+// and the time of the fastest, so that a briefly busy machine does not
+// fail a bound on time
+static bool
+timePlugin(const string &identifier, const Options &options,
+           const Settings &settings, FeatureSet &features, double &fastest)
+{
+    for (int run = 0; run < 3; ++run) {
+        FeatureSet fs;
+        double t = 0;
+        if (!runPlugin(identifier, options, settings, fs, &t)) return false;
+        if (run == 0) {
+            features = fs;
+            fastest = t;
+        } else if (t < fastest) {
+            fastest = t;
+        }
+    }
+    return true;
+}
+
+// Compare a measurement with its bound, printing both
+static bool
+within(const char *what, double value, double bound)
+{
+    bool ok = (value <= bound);
+    printf("    %-40s %12.6g  (bound %.6g)%s\n", what, value, bound,
+           ok ? "" : "  FAILED");
+    return ok;
+}
+
+// The codes of an encoded output, as published in its description:
+// value = offset + code * scale, or 10^(offset + code * scale)
+struct Decoding {
+    bool log;
+    double offset;
+    double scale;
+};
+
+static bool
+parseDecoding(const string &description, Decoding &decoding)
+{
+    size_t pos = description.find("value = ");
+    if (pos == string::npos) return false;
+    const char *text = description.c_str() + pos + 8;
+    decoding.log = !strncmp(text, "10^(", 4);
+    if (decoding.log) text += 4;
+    char *end = 0;
+    decoding.offset = strtod(text, &end);
+    if (end == text || strncmp(end, " + code * ", 10)) return false;
+    text = end + 10;
+    decoding.scale = strtod(text, &end);
+    return end != text;
+}
+
+// Encodings of Mfcc and MelEnergy against full precision. Each value
+// within the encoded range must decode to within half a code of
+// itself: half a step for linear codes, a factor of 10^(scale/2) for
+// log codes, and half a unit in the last place of a half precision
+// float for float16. MFCCs take negative values, so they have no log
+// codes.
+static bool
+checkEncoding(const Options &options)
+{
+    static const char *plugins[] = { "aubiomfcc", "aubiomelenergy" };
+    static const int encodings[] = { 4, 6 };
+    static const char *names[] = {
+        "float32", "float16", "linear16", "linear8", "log16", "log8"
+    };
+    static const int bytes[] = { 4, 2, 2, 1, 2, 1 };
+    bool ok = true;
+
+    for (int p = 0; p < 2; ++p) {
+
+        FeatureSet reference;
+        if (!runPlugin(plugins[p], options, settings("enabledoutputs", 1),
+                       reference)) {
+            return false;
+        }
+        const FeatureList &full = reference[0];
+
+        for (int e = 1; e < encodings[p]; ++e) {
+
+            size_t step = 0, block = 0;
+            Vamp::Plugin *plugin = makePlugin
+                (plugins[p], options.rate,
+                 settings("enabledoutputs", 1, "encoding", e), step, block);
+            if (!plugin) return false;
+            string description = plugin->getOutputDescriptors()[0].description;
+            FeatureSet encoded;
+            runPlugin(plugin, options.signal, options.rate, step, block,
+                      encoded);
+            delete plugin;
+
+            const FeatureList &codes = encoded[0];
+            if (codes.size() != full.size()) {
+                printf("  %s %s: %lu frames, against %lu in full precision"
+                       "  FAILED\n", plugins[p], names[e],
+                       (unsigned long)codes.size(),
+                       (unsigned long)full.size());
+                ok = false;
+                continue;
+            }
+
+            Decoding decoding = { false, 0, 1 };
+            bool half = (e == 1);
+            if (!half && !parseDecoding(description, decoding)) {
+                printf("  %s %s: no decoding in \"%s\"  FAILED\n",
+                       plugins[p], names[e], description.c_str());
+                ok = false;
+                continue;
+            }
+            double levels = (e == 3 || e == 5) ? 255 : 65535;
+            double lowest = half ? -65504 : decoding.offset;
+            double highest = half ? 65504 :
+                decoding.offset + levels * decoding.scale;
+
+            // worst error over the values within range: absolute for
+            // linear codes, relative for the others. The encoder works
+            // in single precision, so codes are allowed a few units in
+            // the last place of the ends of the range on top of half a
+            // step.
+            double rounding = 4 * ldexp(1.0, -23) *
+                std::max(fabs(lowest), fabs(highest));
+            double bound = half ? ldexp(1.0, -11) :
+                decoding.log ? pow(10, decoding.scale / 2 + rounding) - 1 :
+                decoding.scale / 2 + rounding;
+            double worst = 0;
+            size_t values = 0, clamped = 0;
+
+            for (size_t f = 0; f < full.size(); ++f) {
+                for (size_t i = 0; i < full[f].values.size(); ++i) {
+                    double v = full[f].values[i];
+                    double code = codes[f].values[i];
+                    double error;
+                    ++values;
+                    if (half) {
+                        if (fabs(v) > highest) { ++clamped; continue; }
+                        // half floats below 2^-14 have a fixed spacing
+                        error = fabs(code - v) /
+                            std::max(fabs(v), 6.103515625e-05);
+                    } else if (decoding.log) {
+                        if (v <= pow(10, lowest) || v >= pow(10, highest)) {
+                            ++clamped;
+                            continue;
+                        }
+                        double d = pow(10, decoding.offset +
+                                       code * decoding.scale);
+                        error = fabs(d - v) / v;
+                    } else {
+                        if (v < lowest || v > highest) {
+                            ++clamped;
+                            continue;
+                        }
+                        double d = decoding.offset + code * decoding.scale;
+                        error = fabs(d - v);
+                    }
+                    if (error > worst) worst = error;
+                }
+            }
+
+            printf("  %s %s, %d of 4 bytes per value: %lu values, %lu "
+                   "outside the encoded range\n", plugins[p], names[e], bytes[e],
+                   (unsigned long)values, (unsigned long)clamped);
+            if (values == clamped) {
+                printf("    no value within the encoded range  FAILED\n");
+                ok = false;
+                continue;
+            }
+            ok = within(half || decoding.log ? "worst relative error" :
+                        "worst error", worst, bound) && ok;
+        }
+    }
+
+    return ok;
+}
+
+// Notes with lowlatency set, one provisional report per note. Each
+// provisional note must be resolved once, by a confirmed, corrected or
+// cancelled feature with its timestamp, and the confirmed and corrected
+// ones must be the notes of the notes output, in order, with the same
+// timestamps and pitches. Latency is measured from the start of a note
+// to the step whose process() call reports it, and is given beyond the
+// 5 steps it takes for the onset of the note to be reported at all: 4
+// steps of onset detection delay and the onset step itself. The notes
+// output waits for the median of 6 pitch frames, 5 steps more; the
+// provisional notes should take at most 2 steps in most cases.
+static bool
+checkNotes(const Options &options)
+{
+    size_t step = 0, block = 0;
+    Vamp::Plugin *plugin = makePlugin("aubionotes", options.rate,
+                                      settings("lowlatency", 1), step, block);
+    if (!plugin) return false;
+
+    vector<float> in(block, 0.f);
+    const float *inputs[1] = { &in[0] };
+    int rate = lrintf(options.rate);
+    size_t hops = (options.signal.size() + step - 1) / step;
+
+    // notes output, and the provisional notes output with the step at
+    // which each feature arrived
+    FeatureList notes;
+    FeatureList updates;
+    vector<size_t> arrivals;
+
+    for (size_t h = 0; h <= hops; ++h) {
+        FeatureSet fs;
+        if (h < hops) {
+            size_t pos = h * step;
+            size_t avail = options.signal.size() - pos;
+            if (avail > block) avail = block;
+            memcpy(&in[0], &options.signal[pos], avail * sizeof(float));
+            if (avail < block) {
+                memset(&in[avail], 0, (block - avail) * sizeof(float));
+            }
+            fs = plugin->process(inputs,
+                                 Vamp::RealTime::frame2RealTime(pos, rate));
+        } else {
+            fs = plugin->getRemainingFeatures();
+        }
+        notes.insert(notes.end(), fs[0].begin(), fs[0].end());
+        updates.insert(updates.end(), fs[1].begin(), fs[1].end());
+        arrivals.resize(updates.size(), h);
+    }
+    delete plugin;
+
+    bool ok = true;
+    bool open = false;
+    size_t early = 0, confirmed = 0, corrected = 0, cancelled = 0;
+    size_t matched = 0, unresolved = 0;
+    FeatureList finals;
+    vector<double> added;
+
+    for (size_t i = 0; i < updates.size(); ++i) {
+        const Vamp::Plugin::Feature &f = updates[i];
+        if (f.label == "provisional") {
+            if (open) ++unresolved;
+            open = true;
+            long start = Vamp::RealTime::realTime2Frame(f.timestamp, rate);
+            added.push_back((double)arrivals[i] - (double)start / step - 5);
+            bool paired = (i + 1 < updates.size() &&
+                           arrivals[i + 1] == arrivals[i] &&
+                           updates[i + 1].timestamp == f.timestamp);
+            if (!paired) ++early;
+            continue;
+        }
+        if (!open || f.timestamp != updates[i - 1].timestamp) {
+            printf("    %s feature at %s with no provisional note  FAILED\n",
+                   f.label.c_str(), f.timestamp.toString().c_str());
+            ok = false;
+        }
+        open = false;
+        if (f.label == "cancelled") {
+            ++cancelled;
+        } else {
+            if (f.label == "confirmed") ++confirmed;
+            else ++corrected;
+            finals.push_back(f);
+        }
+    }
+    if (open) ++unresolved;
+
+    for (size_t i = 0; i < finals.size() && i < notes.size(); ++i) {
+        if (finals[i].timestamp == notes[i].timestamp &&
+            finals[i].values[0] == notes[i].values[0]) {
+            ++matched;
+        }
+    }
+
+    printf("  %lu notes, %lu reported provisionally before their pitch "
+           "was final\n", (unsigned long)notes.size(), (unsigned long)early);
+    printf("  %lu confirmed, %lu corrected, %lu cancelled: %.1f%% of "
+           "provisional notes confirmed\n", (unsigned long)confirmed,
+           (unsigned long)corrected, (unsigned long)cancelled,
+           added.empty() ? 0.0 :
+           100.0 * confirmed / (confirmed + corrected + cancelled));
+
+    if (added.empty()) {
+        printf("    no notes found  FAILED\n");
+        return false;
+    }
+    std::sort(added.begin(), added.end());
+    double median = added[added.size() / 2];
+    printf("    %-40s %12.6g\n", "worst steps beyond onset", added.back());
+
+    ok = within("provisional notes unresolved", unresolved, 0) && ok;
+    ok = within("final notes missing from notes output",
+                std::max(finals.size(), notes.size()) - matched, 0) && ok;
+    ok = within("median steps beyond onset", median, 2) && ok;
+    return ok;
+}
+
+// Silence over square wave bursts separated by digital silence, with
+// the ends of the bursts falling at every position within a step.
+// Silence refines the time of each change with windows of 4 sixteenths
+// of a step or 64 samples, whichever is shorter, moved on by a quarter
+// of a window: a silence must be placed at most one move after the last
+// sample of the burst, and a sound at most one window before its first
+// sample.
+static bool
+checkSilence(const Options &options)
+{
+    size_t step = 0, block = 0;
+    Vamp::Plugin *plugin = makePlugin("aubiosilence", options.rate,
+                                      Settings(), step, block);
+    if (!plugin) return false;
+
+    vector<float> signal(options.signal.size(), 0.f);
+    vector<size_t> starts, ends;
+    size_t pos = step;
+    for (size_t k = 0; ; ++k) {
+        size_t length = 2 * step + (k * 97) % step;
+        size_t gap = 3 * step + (k * 61) % step;
+        if (pos + length + gap > signal.size()) break;
+        for (size_t i = 0; i < length; ++i) {
+            // a square wave, so that no sample is near zero and the
+            // bursts start and end exactly where they are placed
+            signal[pos + i] = ((i / 50) % 2) ? 0.5f : -0.5f;
+        }
+        starts.push_back(pos);
+        ends.push_back(pos + length);
+        pos += length + gap;
+    }
+
+    FeatureSet features;
+    runPlugin(plugin, signal, options.rate, step, block, features);
+    delete plugin;
+
+    size_t incr = std::min(size_t(16), step / 8);
+    int rate = lrintf(options.rate);
+    const FeatureList &changes = features[2];
+    size_t sounds = 0, silences = 0, wrongSide = 0;
+    double lateSilence = 0, earlySound = 0;
+
+    // the first feature is the initial state
+    for (size_t i = 1; i < changes.size(); ++i) {
+        long frame = Vamp::RealTime::realTime2Frame(changes[i].timestamp, rate);
+        bool sound = (changes[i].values[0] > 0.5);
+        const vector<size_t> &truth = sound ? starts : ends;
+        size_t &n = sound ? sounds : silences;
+        if (n >= truth.size()) {
+            ++n;
+            continue;
+        }
+        double error = frame - (double)truth[n];
+        ++n;
+        if (sound ? error > 0 : error < 0) {
+            ++wrongSide;
+        } else if (sound) {
+            earlySound = std::max(earlySound, -error);
+        } else {
+            lateSilence = std::max(lateSilence, error);
+        }
+    }
+
+    printf("  %lu bursts, %lu sound and %lu silence changes found\n",
+           (unsigned long)starts.size(), (unsigned long)sounds,
+           (unsigned long)silences);
+
+    bool ok = true;
+    ok = within("bursts missed or extra",
+                fabs((double)sounds - starts.size()) +
+                fabs((double)silences - ends.size()), 0) && ok;
+    ok = within("changes inside the sound", wrongSide, 0) && ok;
+    ok = within("worst samples silence placed late", lateSilence,
+                incr) && ok;
+    ok = within("worst samples sound placed early", earlySound,
+                incr * 4) && ok;
+    return ok;
+}
+
+// Pass the blocks starting at sample frames from up to but excluding
+// to through an initialised plugin, collecting its features
+static void
+processRange(Vamp::Plugin *plugin, const vector<float> &signal, float rate,
+             size_t step, size_t block, size_t from, size_t to,
+             FeatureSet &features)
+{
+    vector<float> in(block, 0.f);
+    const float *inputs[1] = { &in[0] };
+
+    for (size_t pos = from; pos < to && pos < signal.size(); pos += step) {
+        size_t avail = signal.size() - pos;
+        if (avail > block) avail = block;
+        memcpy(&in[0], &signal[pos], avail * sizeof(float));
+        if (avail < block) {
+            memset(&in[avail], 0, (block - avail) * sizeof(float));
+        }
+        append(features, plugin->process
+               (inputs, Vamp::RealTime::frame2RealTime(pos, lrintf(rate))));
+    }
+}
+
+// Number of features of a not found in b at the same place, with the
+// same times, values and label
+static size_t
+countDifferences(const FeatureSet &a, const FeatureSet &b, size_t &total)
+{
+    size_t differences = 0;
+    total = 0;
+    for (FeatureSet::const_iterator i = a.begin(); i != a.end(); ++i) {
+        FeatureSet::const_iterator j = b.find(i->first);
+        const FeatureList &fa = i->second;
+        size_t nb = (j == b.end()) ? 0 : j->second.size();
+        total += fa.size();
+        for (size_t k = 0; k < fa.size(); ++k) {
+            if (k >= nb) {
+                ++differences;
+                continue;
+            }
+            const Vamp::Plugin::Feature &fb = j->second[k];
+            if (fa[k].hasTimestamp != fb.hasTimestamp ||
+                (fa[k].hasTimestamp && fa[k].timestamp != fb.timestamp) ||
+                fa[k].hasDuration != fb.hasDuration ||
+                (fa[k].hasDuration && fa[k].duration != fb.duration) ||
+                fa[k].values != fb.values || fa[k].label != fb.label) {
+                ++differences;
+            }
+        }
+    }
+    for (FeatureSet::const_iterator j = b.begin(); j != b.end(); ++j) {
+        FeatureSet::const_iterator i = a.find(j->first);
+        size_t na = (i == a.end()) ? 0 : i->second.size();
+        if (j->second.size() > na) differences += j->second.size() - na;
+    }
+    return differences;
+}
+
+// Whether a plugin's state can be restored: not for the tempo tracker,
+// nor for the onset detection functions aubio whitens (see
+// Checkpoint.h)
+static bool
+isResumable(const string &identifier, const Vamp::Plugin *plugin)
+{
+    if (identifier == "aubiotempo") return false;
+    Vamp::Plugin::ParameterList params = plugin->getParameterDescriptors();
+    for (size_t i = 0; i < params.size(); ++i) {
+        if (params[i].identifier == "onsettype") {
+            OnsetType type = (OnsetType)lrintf(plugin->getParameter("onsettype"));
+            return isOnsetMemoryBounded(type);
+        }
+    }
+    return true;
+}
+
+// Every plugin, stopped after 1/7, 2/7... 6/7 of the input, saved,
+// restored into a new instance and run on to the end, against an
+// uninterrupted run; Mfcc and MelEnergy also with all their outputs,
+// and Notes also offline.
+// Every feature must be identical, and plugins that cannot be resumed
+// must refuse every state.
+static bool
+checkResume(const Options &options)
+{
+    vector<std::pair<string, Settings> > cases;
+    static const char *plugins[] = {
+        "aubioonset", "aubiopitch", "aubionotes", "aubiotempo",
+        "aubiosilence", "aubiomfcc", "aubiomelenergy", "aubiospecdesc",
+        "aubiosegments"
+    };
+    for (size_t p = 0; p < sizeof(plugins) / sizeof(plugins[0]); ++p) {
+        cases.push_back(std::make_pair(string(plugins[p]), Settings()));
+    }
+    cases.push_back(std::make_pair(string("aubioonset"),
+                                   settings("onsettype", OnsetComplex)));
+    cases.push_back(std::make_pair(string("aubioonset"),
+                                   settings("coarsethreshold", 6)));
+    cases.push_back(std::make_pair(string("aubionotes"),
+                                   settings("onsettype", OnsetHFC,
+                                            "lowlatency", 1)));
+    cases.push_back(std::make_pair(string("aubionotes"),
+                                   settings("onsettype", OnsetHFC,
+                                            "offline", 1)));
+    cases.push_back(std::make_pair(string("aubiomfcc"),
+                                   settings("enabledoutputs", 31)));
+    cases.push_back(std::make_pair(string("aubiomelenergy"),
+                                   settings("enabledoutputs", 31)));
+
+    bool ok = true;
+
+    for (size_t c = 0; c < cases.size(); ++c) {
+
+        const string &identifier = cases[c].first;
+        const Settings &params = cases[c].second;
+        string name = identifier;
+        for (size_t i = 0; i < params.size(); ++i) {
+            char buf[64];
+            snprintf(buf, sizeof(buf), " %s=%g", params[i].first.c_str(),
+                     params[i].second);
+            name += buf;
+        }
+
+        size_t step = 0, block = 0;
+        Vamp::Plugin *plugin = makePlugin(identifier, options.rate, params,
+                                          step, block);
+        if (!plugin) return false;
+        bool resumable = isResumable(identifier, plugin);
+        FeatureSet reference;
+        runPlugin(plugin, options.signal, options.rate, step, block,
+                  reference);
+        delete plugin;
+
+        size_t hops = (options.signal.size() + step - 1) / step;
+        size_t differences = 0, total = 0, refused = 0;
+
+        for (int k = 1; k < 7; ++k) {
+
+            size_t split = (hops * k / 7) * step;
+            FeatureSet features;
+
+            Vamp::Plugin *first = makePlugin(identifier, options.rate,
+                                             params, step, block);
+            if (!first) return false;
+            processRange(first, options.signal, options.rate, step, block,
+                         0, split, features);
+            string state = dynamic_cast<Checkpointable &>(*first).saveState();
+            delete first;
+
+            Vamp::Plugin *second = makePlugin(identifier, options.rate,
+                                              params, step, block);
+            if (!second) return false;
+            if (!dynamic_cast<Checkpointable &>(*second).restoreState(state)) {
+                ++refused;
+                delete second;
+                continue;
+            }
+            processRange(second, options.signal, options.rate, step, block,
+                         split, options.signal.size(), features);
+            append(features, second->getRemainingFeatures());
+            delete second;
+
+            size_t n = 0;
+            differences += countDifferences(reference, features, n);
+            total += n;
+        }
+
+        if (!resumable) {
+            printf("  %s: %lu of 6 states refused\n", name.c_str(),
+                   (unsigned long)refused);
+            ok = within("states accepted", 6 - refused, 0) && ok;
+            continue;
+        }
+        printf("  %s: %lu of %lu features differ over 6 resumes\n",
+               name.c_str(), (unsigned long)differences,
+               (unsigned long)total);
+        ok = within("states refused", refused, 0) && ok;
+        ok = within("features differing", differences, 0) && ok;
+    }
+
+    return ok;
+}
+
+// Interleaved little-endian PCM of the signal in format, channel c
+// taking it at a gain of 0.5 - 0.05 c, of alternating sign, so that no
+// two channels are alike and their mean stays within [-0.5, 0.5]
+static void
+encodePcm(const vector<float> &signal, PcmFormat format, size_t channels,
+          vector<unsigned char> &pcm)
+{
+    size_t bytes = getPcmSampleBytes(format);
+    pcm.resize(signal.size() * channels * bytes);
+    unsigned char *p = pcm.empty() ? 0 : &pcm[0];
+
+    for (size_t i = 0; i < signal.size(); ++i) {
+        double x = std::max(-1.f, std::min(signal[i], 1.f));
+        for (size_t c = 0; c < channels; ++c) {
+            double v = x * (c % 2 ? -1 : 1) * (0.5 - 0.05 * c);
+            unsigned long long w = 0;
+            switch (format) {
+            case PcmInt16:
+                w = (unsigned short)(short)lrint(v * 32768);
+                break;
+            case PcmInt24:
+                w = (unsigned int)lrint(v * 8388608) & 0xffffff;
+                break;
+            case PcmInt32:
+                w = (unsigned int)lrint(v * 2147483648.0);
+                break;
+            case PcmFloat32: {
+                float f = v;
+                unsigned int u;
+                memcpy(&u, &f, 4);
+                w = u;
+                break;
+            }
+            case PcmFloat64:
+                memcpy(&w, &v, 8);
+                break;
+            }
+            for (size_t b = 0; b < bytes; ++b) *p++ = (w >> (8 * b)) & 0xff;
+        }
+    }
+}
+
+// One PCM sample read a byte at a time, exactly, in double precision
+static double
+decodePcmSample(const unsigned char *p, PcmFormat format)
+{
+    unsigned long long w = 0;
+    for (size_t b = 0; b < getPcmSampleBytes(format); ++b) {
+        w |= (unsigned long long)p[b] << (8 * b);
+    }
+    switch (format) {
+    case PcmInt16: return (short)w / 32768.0;
+    case PcmInt24: return ((int)(unsigned int)(w << 8) >> 8) / 8388608.0;
+    case PcmInt32: return (int)(unsigned int)w / 2147483648.0;
+    case PcmFloat32: {
+        unsigned int u = w;
+        float f;
+        memcpy(&f, &u, 4);
+        return f;
+    }
+    case PcmFloat64: {
+        double d;
+        memcpy(&d, &w, 8);
+        return d;
+    }
+    }
+    return 0;
+}
+
+// Worst error of convertPcm() into T against an exact decoding and
+// mix-down, converting pieces of 1, 3, 512, 1021 and 4096 frames of
+// the pcm in turn, from one byte past an aligned address
+template <class T>
+static double
+convertError(const vector<unsigned char> &pcm, PcmFormat format,
+             size_t channels)
+{
+    static const size_t pieces[] = { 1, 3, 512, 1021, 4096 };
+    size_t frameBytes = getPcmSampleBytes(format) * channels;
+    size_t frames = pcm.size() / frameBytes;
+
+    vector<unsigned char> shifted(pcm.size() + 1);
+    if (!pcm.empty()) memcpy(&shifted[1], &pcm[0], pcm.size());
+    vector<T> out(frames);
+
+    for (size_t pos = 0, k = 0; pos < frames; ++k) {
+        size_t count = std::min(pieces[k % 5], frames - pos);
+        convertPcm(&shifted[1 + pos * frameBytes], format, channels, count,
+                   &out[pos]);
+        pos += count;
+    }
+
+    double worst = 0;
+    for (size_t i = 0; i < frames; ++i) {
+        const unsigned char *p = &pcm[i * frameBytes];
+        double sum = 0;
+        for (size_t c = 0; c < channels; ++c) {
+            sum += decodePcmSample(p + c * getPcmSampleBytes(format), format);
+        }
+        worst = std::max(worst, fabs(out[i] - sum / channels));
+    }
+    return worst;
+}
+
+// The PCM input path of the plugins. First convertPcm(), in float and
+// double, for every format, 1, 2, 3 and 6 channels, and pieces of any
+// length at any alignment, of the signal and of a full-scale ramp,
+// against a sample by sample decoding in double precision: the worst
+// error must be within half a float step at full scale, 2^-24, as the
+// channels are mixed down in float. Then every plugin
+// fed 16-bit stereo converted once per step through processInput(),
+// against process() given the same samples as floats: the features
+// must be identical. The conversion must take under 1% of real time.
+static bool
+checkPcm(const Options &options)
+{
+    static const PcmFormat formats[] = {
+        PcmInt16, PcmInt24, PcmInt32, PcmFloat32, PcmFloat64
+    };
+    static const char *formatNames[] = {
+        "int16", "int24", "int32", "float32", "float64"
+    };
+    static const size_t channelCounts[] = { 1, 2, 3, 6 };
+
+    bool ok = true;
+
+    vector<float> part(options.signal.begin(),
+                       options.signal.begin() +
+                       std::min(options.signal.size(), size_t(65539)));
+    for (int i = 0; i < 4096; ++i) part.push_back(i / 2048.f - 1.f);
+
+    for (int f = 0; f < 5; ++f) {
+        double worst = 0;
+        for (int c = 0; c < 4; ++c) {
+            vector<unsigned char> pcm;
+            encodePcm(part, formats[f], channelCounts[c], pcm);
+            worst = std::max(worst, convertError<float>
+                             (pcm, formats[f], channelCounts[c]));
+            worst = std::max(worst, convertError<double>
+                             (pcm, formats[f], channelCounts[c]));
+        }
+        printf("  %s: worst error %g over 1, 2, 3 and 6 channels\n",
+               formatNames[f], worst);
+        ok = within("worst error", worst, ldexp(1.0, -24)) && ok;
+    }
+
+    vector<unsigned char> pcm;
+    encodePcm(options.signal, PcmInt16, 2, pcm);
+    Options decoded;
+    decoded.rate = options.rate;
+    decoded.signal.resize(options.signal.size());
+    if (!decoded.signal.empty()) {
+        convertPcm(&pcm[0], PcmInt16, 2, pcm.size() / 4, &decoded.signal[0]);
+    }
+
+    static const char *plugins[] = {
+        "aubioonset", "aubiopitch", "aubionotes", "aubiotempo",
+        "aubiosilence", "aubiomfcc", "aubiomelenergy", "aubiospecdesc",
+        "aubiosegments"
+    };
+
+    for (size_t p = 0; p < sizeof(plugins) / sizeof(plugins[0]); ++p) {
+
+        FeatureSet reference;
+        if (!runPlugin(plugins[p], decoded, Settings(), reference)) {
+            return false;
+        }
+
+        size_t step = 0, block = 0;
+        Vamp::Plugin *plugin = makePlugin(plugins[p], options.rate,
+                                          Settings(), step, block);
+        if (!plugin) return false;
+        PcmInput *input = dynamic_cast<PcmInput *>(plugin);
+        if (!input) {
+            printf("  %s does not take converted input  FAILED\n",
+                   plugins[p]);
+            delete plugin;
+            ok = false;
+            continue;
+        }
+
+        FeatureSet features;
+        fvec_t *converted = new_fvec(step);
+        size_t frames = decoded.signal.size();
+        for (size_t pos = 0; pos < frames; pos += step) {
+            size_t count = std::min(step, frames - pos);
+            fvec_zeros(converted);
+            convertPcm(&pcm[pos * 4], PcmInt16, 2, count, converted->data);
+            append(features, input->processInput
+                   (converted, Vamp::RealTime::frame2RealTime
+                    (pos, lrintf(options.rate))));
+        }
+        append(features, plugin->getRemainingFeatures());
+        del_fvec(converted);
+        delete plugin;
+
+        size_t total = 0;
+        size_t differences = countDifferences(reference, features, total);
+        printf("  %s: %lu of %lu features differ\n", plugins[p],
+               (unsigned long)differences, (unsigned long)total);
+        ok = within("features differing", differences, 0) && ok;
+    }
+
+    vector<float> out(512);
+    size_t frames = options.signal.size();
+    double start = now();
+    for (size_t pos = 0; pos < frames; pos += 512) {
+        convertPcm(&pcm[pos * 4], PcmInt16, 2,
+                   std::min(size_t(512), frames - pos), &out[0]);
+    }
+    double elapsed = now() - start;
+    printf("  int16 stereo: %.2f ns per frame\n",
+           frames ? elapsed * 1e9 / frames : 0);
+    ok = within("share of real time",
+                elapsed / (frames / options.rate), 0.01) && ok;
+
+    return ok;
+}
+
+// Resample one second of a unit sine at frequency from sourceRate to
+// targetRate, in blocks of 1024 as the plugins do, and return its
+// amplitude and worst error against the ideal sine at the target rate,
+// away from the ends
+static double
+resampleSine(unsigned int sourceRate, unsigned int targetRate,
+             double frequency, double &error)
+{
+    Resampler resampler;
+    resampler.initialise(sourceRate, targetRate);
+
+    vector<smpl_t> in(sourceRate), out;
+    for (size_t i = 0; i < in.size(); ++i) {
+        in[i] = sin(2 * M_PI * frequency * i / sourceRate);
+    }
+    for (size_t pos = 0; pos < in.size(); pos += 1024) {
+        resampler.process(&in[pos], std::min(size_t(1024), in.size() - pos),
+                          out);
+    }
+    vector<smpl_t> zeros(resampler.getLatency() + 1, 0);
+    resampler.process(&zeros[0], zeros.size(), out);
+
+    size_t skip = targetRate / 10;
+    size_t end = std::min(out.size(), (size_t)targetRate - skip);
+    double power = 0;
+    error = 0;
+    for (size_t i = skip; i < end; ++i) {
+        double ideal = sin(2 * M_PI * frequency * i / targetRate);
+        error = std::max(error, fabs(out[i] - ideal));
+        power += out[i] * out[i];
+    }
+    return sqrt(2 * power / (end - skip));
+}
+
+// The resampler behind the analysisrate parameter, from the input rate
+// to 22050 and 16000 Hz and from 96 to 16 kHz. Up to 0.7 of the lower
+// Nyquist frequency, sines must come through within 1e-4 of their
+// ideal resampled selves; from 1.1 times it, they must be attenuated
+// by 80 dB, the design of its Kaiser window. Between the two lies the
+// transition band around the cutoff at 0.9. Its cost is the time it
+// takes over the signal, against the duration of the signal.
+static bool
+checkResampler(const Options &options)
+{
+    unsigned int rate = lrintf(options.rate);
+    vector<std::pair<unsigned int, unsigned int> > pairs;
+    if (rate > 22050) pairs.push_back(std::make_pair(rate, 22050u));
+    if (rate > 16000) pairs.push_back(std::make_pair(rate, 16000u));
+    if (rate != 96000) pairs.push_back(std::make_pair(96000u, 16000u));
+
+    bool ok = true;
+
+    for (size_t p = 0; p < pairs.size(); ++p) {
+
+        unsigned int source = pairs[p].first, target = pairs[p].second;
+        double nyquist = target / 2.0;
+        double passError = 0, stopGain = 0;
+
+        for (int k = 1; k <= 14; ++k) {
+            double error;
+            resampleSine(source, target, k * 0.05 * nyquist, error);
+            passError = std::max(passError, error);
+        }
+        for (int k = 55; k <= 100 && k * 0.02 * nyquist < source / 2.0; ++k) {
+            double error;
+            double gain = resampleSine(source, target, k * 0.02 * nyquist,
+                                       error);
+            stopGain = std::max(stopGain, gain);
+        }
+
+        Resampler resampler;
+        resampler.initialise(source, target);
+        vector<smpl_t> in(options.signal.size()), out;
+        for (size_t i = 0; i < in.size(); ++i) in[i] = options.signal[i];
+        out.reserve(in.size());
+        double start = now();
+        for (size_t pos = 0; pos < in.size(); pos += 1024) {
+            resampler.process(&in[pos],
+                              std::min(size_t(1024), in.size() - pos), out);
+        }
+        double elapsed = now() - start;
+
+        printf("  %u to %u Hz: %.1f ns per input sample\n", source, target,
+               elapsed * 1e9 / in.size());
+        ok = within("worst passband error", passError, 1e-4) && ok;
+        ok = within("worst stopband gain (dB)",
+                    20 * log10(std::max(stopGain, 1e-12)), -80) && ok;
+        ok = within("share of real time",
+                    elapsed / (in.size() / (double)source), 0.02) && ok;
+    }
+
+    return ok;
+}
+
+// Run aubiopitch with the given analysis rate over signal, returning
+// the timestamp in frames of each feature from frame from up to frame
+// to, and the step at which it came out, counting
+// getRemainingFeatures() as the step after the last
+static bool
+runPitchTimed(const vector<float> &signal, unsigned int rate,
+              float analysisRate, long from, long to, vector<long> &frames,
+              vector<size_t> &arrivals)
+{
+    size_t step = 512, block = 2048;
+    Vamp::Plugin *plugin = makePlugin("aubiopitch", rate,
+                                      settings("analysisrate", analysisRate),
+                                      step, block);
+    if (!plugin) return false;
+
+    vector<float> in(block, 0.f);
+    const float *inputs[1] = { &in[0] };
+    size_t hops = signal.size() / step;
+
+    for (size_t h = 0; h <= hops; ++h) {
+        FeatureSet fs;
+        if (h < hops) {
+            size_t avail = std::min(block, signal.size() - h * step);
+            std::fill(in.begin(), in.end(), 0.f);
+            memcpy(&in[0], &signal[h * step], avail * sizeof(float));
+            fs = plugin->process(inputs, Vamp::RealTime::frame2RealTime
+                                 (h * step, rate));
+        } else {
+            fs = plugin->getRemainingFeatures();
+        }
+        for (size_t i = 0; i < fs[0].size(); ++i) {
+            long frame = Vamp::RealTime::realTime2Frame(fs[0][i].timestamp,
+                                                        rate);
+            if (frame < from || frame >= to) continue;
+            frames.push_back(frame);
+            arrivals.push_back(h);
+        }
+    }
+
+    delete plugin;
+    return true;
+}
+
+// How the analysisrate resampling moves features in time, for the
+// pairs of rates of the resampler check, at steps of 512. First
+// ResampledInput on its own, fed a sine at 0.3 of the lower Nyquist
+// frequency: every host hop must come out as one analysis hop, with
+// the timestamp of that host hop, holding the sine at the times of
+// the host hop within 1e-4, and no later than the resampler's
+// lookahead of getLatency() input samples, rounded up to whole hops,
+// requires. Then aubiopitch on a 220 Hz tone, with and without the
+// resampling: the features must have the same timestamps, each at the
+// start of a host step, and come out no more steps later than that.
+// The first and last tenth of a second are left out there, as the
+// analysis blocks, of different lengths at the two rates, do not fill
+// with the tone at the same step. The latency is also reported in
+// milliseconds.
+static bool
+checkResamplerTiming(const Options &options)
+{
+    unsigned int rate = lrintf(options.rate);
+    vector<std::pair<unsigned int, unsigned int> > pairs;
+    if (rate > 22050) pairs.push_back(std::make_pair(rate, 22050u));
+    if (rate > 16000) pairs.push_back(std::make_pair(rate, 16000u));
+    if (rate != 96000) pairs.push_back(std::make_pair(96000u, 16000u));
+
+    const size_t step = 512;
+    bool ok = true;
+
+    for (size_t p = 0; p < pairs.size(); ++p) {
+
+        unsigned int source = pairs[p].first, target = pairs[p].second;
+
+        ResampledInput input;
+        input.initialise(source, target, step, 4 * step);
+        if (!input.isActive()) {
+            printf("  %u to %u Hz: no rate below %u Hz has a whole step, "
+                   "not resampled\n", source, target, source);
+            continue;
+        }
+        Resampler resampler;
+        resampler.initialise(source, lrintf(input.getRate()));
+        size_t lookahead = (resampler.getLatency() + step - 1) / step;
+
+        double frequency = 0.3 * target / 2.0;
+        size_t hops = 2 * source / step;
+        vector<smpl_t> buf(step);
+        fvec_t hop;
+        hop.data = &buf[0];
+        hop.length = step;
+
+        size_t out = 0, late = 0, wrongTimes = 0;
+        double error = 0;
+
+        for (size_t h = 0; h <= hops; ++h) {
+            if (h < hops) {
+                for (size_t i = 0; i < step; ++i) {
+                    buf[i] = sin(2 * M_PI * frequency * (h * step + i) / source);
+                }
+                input.push(&hop, Vamp::RealTime::frame2RealTime(h * step,
+                                                                source));
+            } else {
+                input.flush();
+            }
+            Vamp::RealTime timestamp;
+            while (const fvec_t *analysed = input.next(timestamp)) {
+                if (timestamp !=
+                    Vamp::RealTime::frame2RealTime(out * step, source)) {
+                    ++wrongTimes;
+                }
+                if (h < hops) late = std::max(late, h - out);
+                // away from the filter's run-in and the padding at the end
+                if (out > lookahead + 1 && out + lookahead + 2 < hops) {
+                    for (size_t i = 0; i < analysed->length; ++i) {
+                        double t = out * step / (double)source +
+                            i / (double)input.getRate();
+                        error = std::max(error, fabs(analysed->data[i] -
+                                                     sin(2 * M_PI * frequency * t)));
+                    }
+                }
+                ++out;
+            }
+        }
+
+        printf("  %u to %u Hz: analysis hops of %lu at %g Hz, %.1f ms late\n",
+               source, target, (unsigned long)input.getStepSize(),
+               input.getRate(), late * step * 1000.0 / source);
+        ok = within("hops missing or extra",
+                    out > hops ? out - hops : hops - out, 0) && ok;
+        ok = within("hops with other timestamps", wrongTimes, 0) && ok;
+        ok = within("worst error at host times", error, 1e-4) && ok;
+        ok = within("steps late", late, lookahead) && ok;
+
+        vector<float> tone(3 * source);
+        for (size_t i = 0; i < tone.size(); ++i) {
+            tone[i] = 0.5f * sinf(2.f * M_PI * 220.f * i / source);
+        }
+        vector<long> fullFrames, frames;
+        vector<size_t> fullArrivals, arrivals;
+        long from = source / 10, to = tone.size() - source / 10;
+        if (!runPitchTimed(tone, source, 0, from, to,
+                           fullFrames, fullArrivals) ||
+            !runPitchTimed(tone, source, target, from, to,
+                           frames, arrivals)) {
+            return false;
+        }
+
+        size_t offStep = 0, differing = 0, pitchLate = 0;
+        for (size_t i = 0; i < frames.size(); ++i) {
+            if (frames[i] % step) ++offStep;
+        }
+        // both lists are in order, so merge them
+        size_t i = 0, j = 0;
+        while (i < fullFrames.size() || j < frames.size()) {
+            if (j == frames.size() ||
+                (i < fullFrames.size() && fullFrames[i] < frames[j])) {
+                ++differing;
+                ++i;
+            } else if (i == fullFrames.size() || frames[j] < fullFrames[i]) {
+                ++differing;
+                ++j;
+            } else {
+                if (arrivals[j] > fullArrivals[i]) {
+                    pitchLate = std::max(pitchLate,
+                                         arrivals[j] - fullArrivals[i]);
+                }
+                ++i;
+                ++j;
+            }
+        }
+
+        printf("  aubiopitch at %u Hz, analysed at %g Hz: %lu features, "
+               "%.1f ms late\n", source, input.getRate(),
+               (unsigned long)frames.size(),
+               pitchLate * step * 1000.0 / source);
+        ok = within("features between steps", offStep, 0) && ok;
+        ok = within("features at other timestamps", differing, 0) && ok;
+        ok = within("steps late", pitchLate, lookahead) && ok;
+    }
+
+    return ok;
+}
+
+// Plucked notes, one every period seconds on average, over a quiet
+// noise floor
+static void
+makeNotes(vector<float> &buf, float rate, double period)
+{
+    static const int scale[] = { 48, 52, 55, 60, 64, 67, 72, 69, 65, 62 };
+    unsigned int seed = 1;
+    for (size_t i = 0; i < buf.size(); ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        buf[i] = 0.001f * ((float)(seed >> 8) / (float)(1u << 23) - 1.f);
+    }
+    for (size_t k = 0; ; ++k) {
+        size_t start = (size_t)((k + 0.3 * ((k * 7) % 11) / 11.0) *
+                                period * rate);
+        if (start >= buf.size()) break;
+        float f0 = 440.f * powf(2.f, (scale[k % 10] - 69) / 12.f);
+        size_t length = std::min(buf.size() - start, (size_t)(period * rate));
+        for (size_t i = 0; i < length; ++i) {
+            float t = i / rate;
+            float s = 0.f;
+            for (int h = 1; h <= 4; ++h) {
+                s += sinf(2.f * M_PI * f0 * h * t) * expf(-6.f * t) / h;
+            }
+            buf[start + i] += 0.4f * s;
+        }
+    }
+}
+
+// Onset's coarse pass against the full detector, on notes one every 2,
+// 0.5 and 0.15 seconds, at thresholds of 1, 3 and 6 dB. Onsets the
+// full run finds are missed when the screen does not flag them, and
+// must otherwise come out with the same timestamps; the coarse pass
+// must never find onsets of its own. At 3 dB, on notes one every 0.5
+// seconds or fewer, it must find all but 2% of them. The detector runs
+// for some 50 steps around each candidate, which is 0.3 seconds at
+// 44100 Hz but twice that at 22050, so time is bounded by how far apart
+// the notes are in samples: with 44100 or more between them the coarse
+// pass must take less time than the full run, and with 88200 or more
+// at most three quarters as much. The screen runs on every step, so
+// the saving depends on what the detection function costs against it.
+// Closer notes have their warm-ups overlap, and the time is only
+// reported.
+static bool
+checkCoarseOnsets(const Options &options)
+{
+    static const double periods[] = { 2, 0.5, 0.15 };
+    static const float thresholds[] = { 1, 3, 6 };
+    bool ok = true;
+
+    for (int p = 0; p < 3; ++p) {
+
+        Options notes;
+        notes.rate = options.rate;
+        notes.signal.resize(options.signal.size());
+        makeNotes(notes.signal, notes.rate, periods[p]);
+
+        FeatureSet reference;
+        double fullTime = 0;
+        if (!timePlugin("aubioonset", notes, settings("enabledoutputs", 1),
+                        reference, fullTime)) {
+            return false;
+        }
+        const FeatureList &full = reference[0];
+        printf("  one note every %g s: %lu onsets in a full run\n",
+               periods[p], (unsigned long)full.size());
+
+        for (int t = 0; t < 3; ++t) {
+
+            FeatureSet features;
+            double time = 0;
+            if (!timePlugin("aubioonset", notes,
+                            settings("enabledoutputs", 1,
+                                     "coarsethreshold", thresholds[t]),
+                            features, time)) {
+                return false;
+            }
+            const FeatureList &coarse = features[0];
+
+            // onsets are in order in both, so merge them
+            size_t i = 0, j = 0, matched = 0, missed = 0, extra = 0;
+            while (i < full.size() || j < coarse.size()) {
+                if (j == coarse.size() ||
+                    (i < full.size() && full[i].timestamp < coarse[j].timestamp)) {
+                    ++missed;
+                    ++i;
+                } else if (i == full.size() ||
+                           coarse[j].timestamp < full[i].timestamp) {
+                    ++extra;
+                    ++j;
+                } else {
+                    ++matched;
+                    ++i;
+                    ++j;
+                }
+            }
+
+            double share = full.empty() ? 0 : (double)missed / full.size();
+            printf("  %g dB: recall %.3f, %lu extra onsets, %.0f%% of the "
+                   "time of the full run\n", thresholds[t], 1 - share,
+                   (unsigned long)extra, fullTime > 0 ? 100 * time / fullTime : 0);
+            ok = within("onsets not in the full run", extra, 0) && ok;
+            double apart = periods[p] * options.rate;
+            if (periods[p] >= 0.5 && thresholds[t] == 3) {
+                ok = within("share of onsets missed", share, 0.02) && ok;
+            }
+            if (apart >= 44100 && thresholds[t] == 3) {
+                ok = within("time against the full run", time / fullTime,
+                            apart >= 88200 ? 0.75 : 1) && ok;
+            }
+        }
+    }
+
+    return ok;
+}
+
+// Pass the signal hop by hop through a phase vocoder or, when pvoc is
+// 0, a MagnitudeSpectrum, appending the norms of every hop to norms,
+// and return the time taken
+static double
+runSpectrum(aubio_pvoc_t *pvoc, MagnitudeSpectrum *spectrum,
+            const vector<float> &signal, size_t step, size_t block,
+            vector<smpl_t> &norms)
+{
+    fvec_t *in = new_fvec(step);
+    cvec_t *out = new_cvec(block);
+    size_t bins = block / 2 + 1;
+    double elapsed = 0;
+
+    for (size_t pos = 0; pos + step <= signal.size(); pos += step) {
+        for (size_t i = 0; i < step; ++i) in->data[i] = signal[pos + i];
+        double start = now();
+        if (pvoc) aubio_pvoc_do(pvoc, in, out);
+        else spectrum->process(in, out);
+        elapsed += now() - start;
+        norms.insert(norms.end(), out->norm, out->norm + bins);
+    }
+
+    del_cvec(out);
+    del_fvec(in);
+    return elapsed;
+}
+
+// MagnitudeSpectrum, used by Mfcc, MelEnergy, SpecDesc and Segments,
+// against the aubio_pvoc_do() it replaces, at block sizes from 512 to
+// 4096. The norms must be identical, as both take them from the same
+// aubio FFT of the same windowed frame; skipping the phases must make
+// each hop faster.
+static bool
+checkSpectrum(const Options &options)
+{
+    static const size_t sizes[][2] = {
+        { 512, 128 }, { 1024, 256 }, { 2048, 512 }, { 4096, 1024 },
+        { 1024, 1024 }, { 2048, 128 }
+    };
+    bool ok = true;
+
+    for (size_t c = 0; c < sizeof(sizes) / sizeof(sizes[0]); ++c) {
+
+        size_t block = sizes[c][0], step = sizes[c][1];
+        aubio_pvoc_t *pvoc;
+        MagnitudeSpectrum *spectrum;
+        {
+            AubioLock lock;
+            pvoc = new_aubio_pvoc(block, step);
+            spectrum = new MagnitudeSpectrum(block, step);
+        }
+
+        vector<smpl_t> full, magnitudes;
+        double fullTime = runSpectrum(pvoc, 0, options.signal, step, block,
+                                      full);
+        double time = runSpectrum(0, spectrum, options.signal, step, block,
+                                  magnitudes);
+
+        {
+            AubioLock lock;
+            del_aubio_pvoc(pvoc);
+            delete spectrum;
+        }
+
+        double worst = 0;
+        for (size_t i = 0; i < full.size(); ++i) {
+            worst = std::max(worst, (double)fabs(full[i] - magnitudes[i]));
+        }
+        size_t hops = full.size() / (block / 2 + 1);
+
+        printf("  block %lu, step %lu: %.2f us per hop with phases, %.2f "
+               "without, %.0f%% less\n", (unsigned long)block,
+               (unsigned long)step, fullTime * 1e6 / hops, time * 1e6 / hops,
+               100 * (1 - time / fullTime));
+        ok = within("worst difference in norm", worst, 0) && ok;
+        ok = within("time against aubio_pvoc_do", time / fullTime, 1) && ok;
+    }
+
+    return ok;
+}
+
+static double
+median(vector<double> values)
+{
+    if (values.empty()) return 0;
+    std::nth_element(values.begin(), values.begin() + values.size() / 2,
+                     values.end());
+    return values[values.size() / 2];
+}
+
+// Time each process() call of an initialised plugin over the signal,
+// sorting the times into hops whose input peaks above 1e-3 and hops
+// whose input is all below the smallest normal float
+static void
+timeHops(Vamp::Plugin *plugin, const vector<float> &signal, float rate,
+         size_t step, size_t block, vector<double> &sounding,
+         vector<double> &tail)
+{
+    vector<float> in(block, 0.f);
+    const float *inputs[1] = { &in[0] };
+
+    for (size_t pos = 0; pos < signal.size(); pos += step) {
+        size_t avail = std::min(block, signal.size() - pos);
+        memcpy(&in[0], &signal[pos], avail * sizeof(float));
+        if (avail < block) {
+            memset(&in[avail], 0, (block - avail) * sizeof(float));
+        }
+        float peak = 0.f;
+        for (size_t i = 0; i < block; ++i) peak = std::max(peak, fabsf(in[i]));
+        double start = now();
+        plugin->process(inputs, Vamp::RealTime::frame2RealTime(pos, lrintf(rate)));
+        double elapsed = now() - start;
+        if (peak > 1e-3f) sounding.push_back(elapsed);
+        else if (peak < FLT_MIN) tail.push_back(elapsed);
+    }
+    plugin->getRemainingFeatures();
+}
+
+// Every plugin with its DenormalGuard on and off. On notes over a
+// noise floor, which never come near denormals, the features must be
+// identical. On a tone decaying through the denormal range into a
+// second of digital silence, the median time per hop in the tail,
+// with the guard, must be at most twice that of the sounding part;
+// the time saved against running without it is reported.
+static bool
+checkDenormals(const Options &options)
+{
+    static const char *plugins[] = {
+        "aubioonset", "aubiopitch", "aubionotes", "aubiotempo",
+        "aubiosilence", "aubiomfcc", "aubiomelenergy", "aubiospecdesc",
+        "aubiosegments"
+    };
+
+    Options notes;
+    notes.rate = options.rate;
+    notes.signal.resize(options.signal.size());
+    makeNotes(notes.signal, notes.rate, 0.5);
+
+    vector<float> decay((size_t)(6 * options.rate), 0.f);
+    for (size_t i = 0; i < (size_t)(5 * options.rate); ++i) {
+        float t = i / options.rate;
+        decay[i] = 0.5f * sinf(2.f * M_PI * 220.f * t) * expf(-20.f * t);
+    }
+
+    bool ok = true;
+
+    for (size_t p = 0; p < sizeof(plugins) / sizeof(plugins[0]); ++p) {
+
+        FeatureSet guarded, unguarded;
+        vector<double> sounding[2], tail[2];
+
+        for (int on = 0; on < 2; ++on) {
+            DenormalGuard::setEnabled(on);
+            if (!runPlugin(plugins[p], notes, Settings(),
+                           on ? guarded : unguarded)) {
+                DenormalGuard::setEnabled(true);
+                return false;
+            }
+            size_t step = 0, block = 0;
+            Vamp::Plugin *plugin = makePlugin(plugins[p], options.rate,
+                                              Settings(), step, block);
+            if (!plugin) {
+                DenormalGuard::setEnabled(true);
+                return false;
+            }
+            timeHops(plugin, decay, options.rate, step, block,
+                     sounding[on], tail[on]);
+            delete plugin;
+        }
+        DenormalGuard::setEnabled(true);
+
+        size_t total = 0;
+        size_t differences = countDifferences(unguarded, guarded, total);
+        double sound = median(sounding[1]);
+        double off = median(tail[0]), on = median(tail[1]);
+
+        printf("  %s: median us per hop %.2f sounding, %.2f in the tail, "
+               "%.2f there without the guard\n", plugins[p], sound * 1e6,
+               on * 1e6, off * 1e6);
+        ok = within("features differing on notes", differences, 0) && ok;
+        ok = within("tail against sounding time",
+                    sound > 0 ? on / sound : 0, 2) && ok;
+    }
+
+    return ok;
+}
+
+struct Check {
+    const char *name;
+    const char *description;
+    bool (*run)(const Options &);
+};
+
+static const Check checks[] = {
+    { "encoding", "Mfcc and MelEnergy encoded outputs against full precision",
+      checkEncoding },
+    { "notes", "Notes provisional output latency and agreement",
+      checkNotes },
+    { "silence", "Silence change times over square wave bursts",
+      checkSilence },
+    { "resume", "Plugins resumed from saved states against uninterrupted runs",
+      checkResume },
+    { "pcm", "Plugins fed converted PCM against float input",
+      checkPcm },
+    { "resampler", "Resampler passband, stopband and cost",
+      checkResampler },
+    { "resampler-timing", "Resampler latency and timestamps of resampled hops",
+      checkResamplerTiming },
+    { "coarse-onsets", "Onset coarse pass against the full detector",
+      checkCoarseOnsets },
+    { "spectrum", "Magnitude spectra against aubio_pvoc_do",
+      checkSpectrum },
+    { "denormals", "Plugins over denormal tails with and without the guard",
+      checkDenormals },
+};
+
+static const size_t checkCount = sizeof(checks) / sizeof(checks[0]);
+
+static void
+usage()
+{
+    fprintf(stderr,
+            "usage: vamp-aubio-check [-d seconds] [-r rate] [check]...\n"
+            "\n"
+            "Run the given checks, or all of them, over a synthetic signal\n"
+            "of the given duration (60) and rate (44100), and report their\n"
+            "measurements. The checks are:\n\n");
+    for (size_t c = 0; c < checkCount; ++c) {
+        fprintf(stderr, "  %-14s %s\n", checks[c].name, checks[c].description);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    float duration = 60;
+    Options options;
+    options.rate = 44100;
+
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; ++i) {
+        if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+            duration = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            options.rate = atof(argv[++i]);
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    if (duration <= 0 || options.rate <= 0) {
+        usage();
+        return 2;
+    }
+
+    vector<const Check *> selected;
+    for (; i < argc; ++i) {
+        size_t c = 0;
+        while (c < checkCount && strcmp(checks[c].name, argv[i])) ++c;
+        if (c == checkCount) {
+            usage();
+            return 2;
+        }
+        selected.push_back(&checks[c]);
+    }
+    if (selected.empty()) {
+        for (size_t c = 0; c < checkCount; ++c) selected.push_back(&checks[c]);
+    }
+
+    options.signal.resize((size_t)(duration * options.rate));
+    makeSignal(options.signal, options.rate);
+
+    int failed = 0;
+    for (size_t c = 0; c < selected.size(); ++c) {
+        printf("%s: %s\n", selected[c]->name, selected[c]->description);
+        bool ok = selected[c]->run(options);
+        printf("%s: %s\n\n", selected[c]->name, ok ? "ok" : "FAILED");
+        if (!ok) ++failed;
+    }
+
+    if (failed) {
+        fprintf(stderr, "vamp-aubio-check: %d of %lu checks failed\n",
+                failed, (unsigned long)selected.size());
+        return 1;
+    }
+    return 0;
+}
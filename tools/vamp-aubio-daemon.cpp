@@ -0,0 +1,891 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+// Analysis daemon for vamp-aubio.
+//
+// Serves analysis requests on a Unix domain socket, running the plugins
+// linked in from the plugin sources on a set of worker threads. Plugin
+// instances stay initialised between requests, in pools keyed by their
+// configuration, and are reset rather than created again.
+//
+// A client sends one or more requests on a connection, each a line of
+// text, followed for "analyse" by the audio as native-endian 32-bit
+// floats:
+//
+//   analyse <plugin> <rate> <step> <block> <frames> [<param>=<value>]...
+//   analyse-shm <plugin> <rate> <step> <block> <frames> [<param>=<value>]...
+//   stats
+//
+// A step or block of 0 selects the plugin's preferred size. The reply
+// to analyse is a line per feature, then a status line:
+//
+//   <output> <time> <duration or -> <count> <value>... [<label>]
+//   ok <features> <microseconds>
+//
+// analyse-shm passes two file descriptors with its line instead of
+// sending the audio: a shared memory file holding the audio, which the
+// plugins read in place, and one holding a FeatureRing created by the
+// client, which the features are written to as they are found. Its
+// reply is the status line alone, sent once every feature is in the
+// ring; the client has to keep reading the ring meanwhile.
+//
+// The reply to stats is "<name> <value>" lines, also ending with "ok".
+// On error the reply is "error <message>" and the connection is closed.
+//
+// With -c, features are also kept in a FeatureCache on disk, and
+// requests for audio and settings seen before are answered from it.
+
+#include <vamp-sdk/Plugin.h>
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <deque>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "FeatureCache.h"
+#include "FeatureRing.h"
+#include "InstancePool.h"
+#include "SharedMemory.h"
+
+using std::string;
+using std::vector;
+
+static const size_t maxLineLength = 4096;
+static const size_t maxFrames = (size_t)1 << 27;
+
+// how long the feature ring may stay full before a request fails
+static const double ringTimeout = 10;
+
+static double
+now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Request latencies, in buckets doubling from 0.25 ms, the last one
+// holding everything above 4 s
+class LatencyStats
+{
+public:
+    enum { Buckets = 16 };
+
+    LatencyStats() : m_requests(0), m_errors(0), m_active(0) {
+        for (int i = 0; i < Buckets; ++i) m_counts[i] = 0;
+        pthread_mutex_init(&m_mutex, 0);
+    }
+    ~LatencyStats() {
+        pthread_mutex_destroy(&m_mutex);
+    }
+
+    static double getBucketLimit(int bucket) {
+        return 0.25 * (1 << bucket);
+    }
+
+    void started() {
+        pthread_mutex_lock(&m_mutex);
+        ++m_active;
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    void finished(double seconds, bool ok) {
+        double ms = seconds * 1000;
+        int bucket = 0;
+        while (bucket < Buckets - 1 && ms > getBucketLimit(bucket)) ++bucket;
+        pthread_mutex_lock(&m_mutex);
+        --m_active;
+        ++m_requests;
+        if (!ok) ++m_errors;
+        ++m_counts[bucket];
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    // upper limit in ms of the bucket holding the given fraction of
+    // requests, or -1 if above the last limit
+    static double percentile(const unsigned long *counts,
+                             unsigned long total, double fraction) {
+        unsigned long target = (unsigned long)ceil(total * fraction);
+        unsigned long sum = 0;
+        for (int i = 0; i < Buckets - 1; ++i) {
+            sum += counts[i];
+            if (sum >= target) return getBucketLimit(i);
+        }
+        return -1;
+    }
+
+    void report(string &out) {
+        unsigned long counts[Buckets];
+        pthread_mutex_lock(&m_mutex);
+        unsigned long requests = m_requests;
+        unsigned long errors = m_errors;
+        int active = m_active;
+        for (int i = 0; i < Buckets; ++i) counts[i] = m_counts[i];
+        pthread_mutex_unlock(&m_mutex);
+
+        char buf[128];
+        snprintf(buf, sizeof(buf), "requests %lu\nerrors %lu\nactive %d\n",
+                 requests, errors, active);
+        out += buf;
+        for (int i = 0; i < Buckets; ++i) {
+            if (i < Buckets - 1) {
+                snprintf(buf, sizeof(buf), "latency_le_ms %g %lu\n",
+                         getBucketLimit(i), counts[i]);
+            } else {
+                snprintf(buf, sizeof(buf), "latency_le_ms inf %lu\n",
+                         counts[i]);
+            }
+            out += buf;
+        }
+        if (requests) {
+            snprintf(buf, sizeof(buf), "p50_ms %g\np99_ms %g\n",
+                     percentile(counts, requests, 0.5),
+                     percentile(counts, requests, 0.99));
+            out += buf;
+        }
+    }
+
+private:
+    unsigned long m_requests;
+    unsigned long m_errors;
+    int m_active;
+    unsigned long m_counts[Buckets];
+    pthread_mutex_t m_mutex;
+};
+
+// Connections accepted and waiting for a worker
+class ConnectionQueue
+{
+public:
+    ConnectionQueue() {
+        pthread_mutex_init(&m_mutex, 0);
+        pthread_cond_init(&m_cond, 0);
+    }
+    ~ConnectionQueue() {
+        pthread_cond_destroy(&m_cond);
+        pthread_mutex_destroy(&m_mutex);
+    }
+
+    void push(int fd) {
+        pthread_mutex_lock(&m_mutex);
+        m_fds.push_back(fd);
+        pthread_cond_signal(&m_cond);
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    int pop() {
+        pthread_mutex_lock(&m_mutex);
+        while (m_fds.empty()) pthread_cond_wait(&m_cond, &m_mutex);
+        int fd = m_fds.front();
+        m_fds.pop_front();
+        pthread_mutex_unlock(&m_mutex);
+        return fd;
+    }
+
+    size_t getDepth() {
+        pthread_mutex_lock(&m_mutex);
+        size_t n = m_fds.size();
+        pthread_mutex_unlock(&m_mutex);
+        return n;
+    }
+
+private:
+    std::deque<int> m_fds;
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_cond;
+};
+
+struct Server {
+    Server(size_t maxIdle) : pool(maxIdle), cache(0) { }
+    InstancePool pool;
+    ConnectionQueue queue;
+    LatencyStats stats;
+    FeatureCache *cache;
+};
+
+// Buffered reading of request lines and the audio following them, and
+// of the file descriptors passed with them
+class Reader
+{
+public:
+    Reader(int fd) : m_fd(fd), m_buffer(65536), m_pos(0), m_len(0) { }
+    ~Reader() {
+        for (size_t i = 0; i < m_fds.size(); ++i) close(m_fds[i]);
+    }
+
+    // the earliest descriptor received and not taken yet, or -1
+    int takeDescriptor() {
+        if (m_fds.empty()) return -1;
+        int fd = m_fds.front();
+        m_fds.erase(m_fds.begin());
+        return fd;
+    }
+
+    // false on end of stream, error or overlong line
+    bool readLine(string &line) {
+        line.clear();
+        while (true) {
+            while (m_pos < m_len) {
+                char c = m_buffer[m_pos++];
+                if (c == '\n') return true;
+                line += c;
+                if (line.size() > maxLineLength) return false;
+            }
+            if (!fill()) return false;
+        }
+    }
+
+    bool readExact(char *out, size_t n) {
+        size_t buffered = std::min(n, m_len - m_pos);
+        memcpy(out, &m_buffer[m_pos], buffered);
+        m_pos += buffered;
+        out += buffered;
+        n -= buffered;
+        while (n > 0) {
+            ssize_t r = receiveWithDescriptors(m_fd, out, n, m_fds);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) return false;
+            out += r;
+            n -= r;
+        }
+        return true;
+    }
+
+private:
+    bool fill() {
+        while (true) {
+            ssize_t r = receiveWithDescriptors(m_fd, &m_buffer[0],
+                                               m_buffer.size(), m_fds);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) return false;
+            m_pos = 0;
+            m_len = r;
+            return true;
+        }
+    }
+
+    int m_fd;
+    vector<char> m_buffer;
+    size_t m_pos;
+    size_t m_len;
+    vector<int> m_fds;
+};
+
+static bool
+writeAll(int fd, const string &s)
+{
+    const char *p = s.data();
+    size_t n = s.size();
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= w;
+    }
+    return true;
+}
+
+static void
+appendTime(string &out, int sec, int nsec)
+{
+    char buf[32];
+    bool negative = sec < 0 || nsec < 0;
+    snprintf(buf, sizeof(buf), "%s%d.%09d", negative ? "-" : "",
+             abs(sec), abs(nsec));
+    out += buf;
+}
+
+// Where the features of a request go, with their times resolved
+class FeatureSink
+{
+public:
+    virtual ~FeatureSink() { }
+    virtual bool add(const RingFeature &f) = 0;
+};
+
+// Features as lines of text, for the reply on the socket
+class TextSink : public FeatureSink
+{
+public:
+    TextSink(string &out, const vector<string> &outputs) :
+        m_out(out), m_outputs(outputs) { }
+
+    bool add(const RingFeature &f) {
+        char buf[32];
+        if (f.output < m_outputs.size()) m_out += m_outputs[f.output];
+        else m_out += '?';
+        m_out += ' ';
+        appendTime(m_out, f.sec, f.nsec);
+        m_out += ' ';
+        if (f.hasDuration) appendTime(m_out, f.durationSec, f.durationNsec);
+        else m_out += '-';
+        snprintf(buf, sizeof(buf), " %lu", (unsigned long)f.values.size());
+        m_out += buf;
+        for (size_t k = 0; k < f.values.size(); ++k) {
+            snprintf(buf, sizeof(buf), " %.9g", f.values[k]);
+            m_out += buf;
+        }
+        if (!f.label.empty()) {
+            string label = f.label;
+            std::replace(label.begin(), label.end(), '\n', ' ');
+            m_out += ' ';
+            m_out += label;
+        }
+        m_out += '\n';
+        return true;
+    }
+
+private:
+    string &m_out;
+    const vector<string> &m_outputs;
+};
+
+// Features as records in a ring shared with the client, waiting for it
+// to make room when the ring is full
+class RingSink : public FeatureSink
+{
+public:
+    RingSink(FeatureRing &ring, string &error) :
+        m_ring(ring), m_error(error) { }
+
+    bool add(const RingFeature &f) {
+        if (FeatureRing::getRecordSize(f) > m_ring.getCapacity()) {
+            m_error = "feature too large for the ring";
+            return false;
+        }
+        if (m_ring.write(f)) return true;
+
+        struct timespec ts;
+        ts.tv_sec = 0;
+        ts.tv_nsec = 50000;
+        double deadline = now() + ringTimeout;
+        while (!m_ring.write(f)) {
+            if (now() > deadline) {
+                m_error = "feature ring not read";
+                return false;
+            }
+            nanosleep(&ts, 0);
+        }
+        return true;
+    }
+
+private:
+    FeatureRing &m_ring;
+    string &m_error;
+};
+
+// Features passed on to another sink and kept, for the cache
+class RecordingSink : public FeatureSink
+{
+public:
+    RecordingSink(FeatureSink &sink, vector<RingFeature> &features) :
+        m_sink(sink), m_features(features) { }
+
+    bool add(const RingFeature &f) {
+        m_features.push_back(f);
+        return m_sink.add(f);
+    }
+
+private:
+    FeatureSink &m_sink;
+    vector<RingFeature> &m_features;
+};
+
+static bool
+addFeatures(FeatureSink &sink, const PluginInstance &instance,
+            const Vamp::Plugin::FeatureSet &fs,
+            const Vamp::RealTime &blockTime, size_t &count)
+{
+    RingFeature record;
+    for (Vamp::Plugin::FeatureSet::const_iterator i = fs.begin();
+         i != fs.end(); ++i) {
+        if (i->first < 0 || i->first >= (int)instance.outputs.size()) continue;
+        const Vamp::Plugin::FeatureList &fl = i->second;
+        for (size_t j = 0; j < fl.size(); ++j) {
+            const Vamp::Plugin::Feature &f = fl[j];
+            const Vamp::RealTime &t = f.hasTimestamp ? f.timestamp : blockTime;
+            record.output = i->first;
+            record.sec = t.sec;
+            record.nsec = t.nsec;
+            record.hasDuration = f.hasDuration;
+            record.durationSec = f.hasDuration ? f.duration.sec : 0;
+            record.durationNsec = f.hasDuration ? f.duration.nsec : 0;
+            record.values = f.values;
+            record.label = f.label;
+            if (!sink.add(record)) return false;
+            ++count;
+        }
+    }
+    return true;
+}
+
+// Run an instance over the audio, reading whole blocks in place and
+// copying only the zero-padded last ones
+static bool
+analyse(const PluginInstance &instance, float rate,
+        const float *samples, size_t frames, FeatureSink &sink, size_t &count)
+{
+    size_t step = instance.stepSize;
+    size_t block = instance.blockSize;
+    vector<float> in(block, 0.f);
+    const float *inputs[1];
+    count = 0;
+
+    for (size_t pos = 0; pos < frames; pos += step) {
+        if (frames - pos >= block) {
+            inputs[0] = samples + pos;
+        } else {
+            size_t avail = frames - pos;
+            memcpy(&in[0], samples + pos, avail * sizeof(float));
+            memset(&in[avail], 0, (block - avail) * sizeof(float));
+            inputs[0] = &in[0];
+        }
+        Vamp::RealTime t = Vamp::RealTime::frame2RealTime(pos, lrintf(rate));
+        if (!addFeatures(sink, instance,
+                         instance.plugin->process(inputs, t), t, count)) {
+            return false;
+        }
+    }
+
+    Vamp::RealTime end = Vamp::RealTime::frame2RealTime(frames, lrintf(rate));
+    return addFeatures(sink, instance,
+                       instance.plugin->getRemainingFeatures(), end, count);
+}
+
+// Answer from the cache if it holds the features, or analyse and keep
+// them there
+static bool
+analyseCached(FeatureCache *cache, const PluginInstance &instance,
+              float rate, const float *samples, size_t frames,
+              FeatureSink &sink, size_t &count)
+{
+    if (!cache) return analyse(instance, rate, samples, frames, sink, count);
+
+    FeatureCache::Key key = cache->makeKey
+        (instance.plugin, rate, instance.stepSize, instance.blockSize,
+         samples, frames);
+
+    vector<RingFeature> features;
+    if (cache->lookup(key, features)) {
+        for (count = 0; count < features.size(); ++count) {
+            if (!sink.add(features[count])) return false;
+        }
+        return true;
+    }
+
+    RecordingSink recorder(sink, features);
+    if (!analyse(instance, rate, samples, frames, recorder, count)) {
+        return false;
+    }
+    if (!cache->store(key, features)) {
+        fprintf(stderr, "vamp-aubio-daemon: cannot write %s\n",
+                key.path.c_str());
+    }
+    return true;
+}
+
+// A read-only mapping of the audio and a writable one of the feature
+// ring passed with an analyse-shm request, unmapped and closed when
+// done with
+class SharedRequest
+{
+public:
+    SharedRequest() : m_audioFd(-1), m_ringFd(-1), m_audio(MAP_FAILED),
+                      m_audioSize(0), m_ring(MAP_FAILED), m_ringSize(0) { }
+    ~SharedRequest() {
+        if (m_audio != MAP_FAILED) munmap(m_audio, m_audioSize);
+        if (m_ring != MAP_FAILED) munmap(m_ring, m_ringSize);
+        if (m_audioFd >= 0) close(m_audioFd);
+        if (m_ringFd >= 0) close(m_ringFd);
+    }
+
+    bool map(Reader &reader, size_t frames, string &error) {
+        m_audioFd = reader.takeDescriptor();
+        m_ringFd = reader.takeDescriptor();
+        if (m_ringFd < 0) {
+            error = "analyse-shm needs the audio and ring descriptors";
+            return false;
+        }
+        struct stat st;
+        m_audioSize = frames * sizeof(float);
+        if (fstat(m_audioFd, &st) < 0 || (size_t)st.st_size < m_audioSize) {
+            error = "shared audio shorter than the frame count";
+            return false;
+        }
+        if (m_audioSize > 0) {
+            m_audio = mmap(0, m_audioSize, PROT_READ, MAP_SHARED,
+                           m_audioFd, 0);
+            if (m_audio == MAP_FAILED) {
+                error = "cannot map the shared audio";
+                return false;
+            }
+            madvise(m_audio, m_audioSize, MADV_SEQUENTIAL);
+        }
+        if (fstat(m_ringFd, &st) < 0 || st.st_size <= 0) {
+            error = "bad feature ring";
+            return false;
+        }
+        m_ringSize = st.st_size;
+        m_ring = mmap(0, m_ringSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      m_ringFd, 0);
+        if (m_ring == MAP_FAILED) {
+            error = "cannot map the feature ring";
+            return false;
+        }
+        return true;
+    }
+
+    const float *getAudio() const {
+        return m_audio == MAP_FAILED ? 0 : (const float *)m_audio;
+    }
+    void *getRing() const { return m_ring; }
+    size_t getRingSize() const { return m_ringSize; }
+
+private:
+    int m_audioFd;
+    int m_ringFd;
+    void *m_audio;
+    size_t m_audioSize;
+    void *m_ring;
+    size_t m_ringSize;
+};
+
+// Parse the arguments of an analyse request
+static bool
+parseConfig(std::istringstream &args, PluginConfig &config, size_t &frames,
+            string &error)
+{
+    long step = -1, block = -1;
+    long n = -1;
+    if (!(args >> config.identifier >> config.rate >> step >> block >> n) ||
+        config.rate <= 0 || step < 0 || block < 0 || n < 0) {
+        error = "usage: analyse <plugin> <rate> <step> <block> <frames> "
+            "[<param>=<value>]...";
+        return false;
+    }
+    if ((size_t)n > maxFrames) {
+        error = "too many frames";
+        return false;
+    }
+    config.stepSize = step;
+    config.blockSize = block;
+    frames = n;
+
+    string setting;
+    while (args >> setting) {
+        size_t eq = setting.find('=');
+        if (eq == string::npos || eq == 0) {
+            error = "bad parameter setting " + setting;
+            return false;
+        }
+        config.parameters.push_back
+            (std::make_pair(setting.substr(0, eq),
+                            (float)atof(setting.c_str() + eq + 1)));
+    }
+
+    // the same settings in any order share a pool
+    std::sort(config.parameters.begin(), config.parameters.end());
+    return true;
+}
+
+// Serve the requests of one connection, returning when it is closed
+static void
+serve(Server &server, int fd)
+{
+    Reader reader(fd);
+    string line;
+    vector<float> audio;
+
+    while (reader.readLine(line)) {
+        std::istringstream args(line);
+        string command;
+        args >> command;
+
+        string out;
+        bool ok = true;
+
+        if (command == "stats") {
+            char buf[128];
+            snprintf(buf, sizeof(buf),
+                     "queued %lu\nidle_instances %lu\ncreated %lu\n"
+                     "reused %lu\n",
+                     (unsigned long)server.queue.getDepth(),
+                     (unsigned long)server.pool.getIdleCount(),
+                     server.pool.getCreatedCount(),
+                     server.pool.getReusedCount());
+            out = buf;
+            if (server.cache) {
+                snprintf(buf, sizeof(buf), "cache_hits %lu\ncache_misses %lu\n",
+                         server.cache->getHitCount(),
+                         server.cache->getMissCount());
+                out += buf;
+            }
+            server.stats.report(out);
+            out += "ok\n";
+            if (!writeAll(fd, out)) return;
+            continue;
+        }
+
+        bool shared = command == "analyse-shm";
+        if (command != "analyse" && !shared) {
+            writeAll(fd, "error unknown request " + command + "\n");
+            return;
+        }
+
+        double start = now();
+        server.stats.started();
+
+        PluginConfig config;
+        size_t frames = 0;
+        string error;
+        PluginInstance instance;
+
+        SharedRequest request;
+        const float *samples = 0;
+
+        ok = parseConfig(args, config, frames, error);
+        if (ok && shared) {
+            ok = request.map(reader, frames, error);
+            samples = request.getAudio();
+        } else if (ok) {
+            audio.resize(frames);
+            if (frames > 0 &&
+                !reader.readExact((char *)&audio[0], frames * sizeof(float))) {
+                server.stats.finished(now() - start, false);
+                return;
+            }
+            samples = frames ? &audio[0] : 0;
+        }
+        if (ok) {
+            ok = server.pool.acquire(config, instance, error);
+        }
+
+        size_t count = 0;
+        FeatureRing ring(request.getRing(), request.getRingSize(), false);
+        RingSink ringSink(ring, error);
+        TextSink textSink(out, instance.outputs);
+        if (ok && shared && !ring.isValid()) {
+            error = "bad feature ring";
+            ok = false;
+        }
+        if (ok) {
+            FeatureSink &sink = shared ? (FeatureSink &)ringSink : textSink;
+            ok = analyseCached(server.cache, instance, config.rate,
+                               samples, frames, sink, count);
+        }
+
+        if (ok) {
+            char buf[64];
+            snprintf(buf, sizeof(buf), "ok %lu %ld\n", (unsigned long)count,
+                     lrint((now() - start) * 1e6));
+            out += buf;
+        } else {
+            out = "error " + error + "\n";
+        }
+
+        bool written = writeAll(fd, out);
+        server.stats.finished(now() - start, ok);
+
+        // reset off the request's critical path
+        if (instance.plugin) server.pool.release(config, instance);
+
+        if (!ok || !written) return;
+    }
+}
+
+static void *
+runWorker(void *arg)
+{
+    Server *server = (Server *)arg;
+    while (true) {
+        int fd = server->queue.pop();
+        serve(*server, fd);
+        close(fd);
+    }
+    return 0;
+}
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void
+handleSignal(int)
+{
+    interrupted = 1;
+}
+
+static void
+usage()
+{
+    fprintf(stderr,
+            "usage: vamp-aubio-daemon [-s socket] [-t threads] [-i idle] "
+            "[-c cache-dir] [-w plugin@rate]...\n"
+            "\n"
+            "Serve analysis requests on a Unix domain socket, with threads\n"
+            "workers, keeping up to idle initialised instances of each plugin\n"
+            "configuration. Each -w creates that many instances of a plugin,\n"
+            "with its default settings, before accepting requests. With -c,\n"
+            "features are cached in cache-dir.\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    const char *path = "/tmp/vamp-aubio.sock";
+    int threads = 4;
+    int idle = -1;
+    const char *cacheDir = 0;
+    vector<PluginConfig> warm;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            path = argv[++i];
+        } else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+            idle = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+            cacheDir = argv[++i];
+        } else if (!strcmp(argv[i], "-w") && i + 1 < argc) {
+            string spec = argv[++i];
+            size_t at = spec.find('@');
+            PluginConfig config;
+            config.identifier = spec.substr(0, at);
+            config.rate = at == string::npos ? 44100 :
+                atof(spec.c_str() + at + 1);
+            if (config.rate <= 0) {
+                usage();
+                return 2;
+            }
+            warm.push_back(config);
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    if (threads < 1) {
+        usage();
+        return 2;
+    }
+    if (idle < 0) idle = threads;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "vamp-aubio-daemon: socket path too long\n");
+        return 1;
+    }
+    strcpy(addr.sun_path, path);
+
+    Server server(idle);
+
+    if (cacheDir) {
+        if (access(cacheDir, W_OK) < 0) {
+            fprintf(stderr, "vamp-aubio-daemon: cannot write to %s\n",
+                    cacheDir);
+            return 1;
+        }
+        server.cache = new FeatureCache(cacheDir);
+    }
+
+    for (size_t w = 0; w < warm.size(); ++w) {
+        vector<PluginInstance> instances(threads);
+        for (int t = 0; t < threads; ++t) {
+            string error;
+            if (!server.pool.acquire(warm[w], instances[t], error)) {
+                fprintf(stderr, "vamp-aubio-daemon: %s\n", error.c_str());
+                return 1;
+            }
+        }
+        for (int t = 0; t < threads; ++t) {
+            server.pool.release(warm[w], instances[t]);
+        }
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("vamp-aubio-daemon: socket");
+        return 1;
+    }
+    unlink(path);
+    if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listener, 64) < 0) {
+        perror("vamp-aubio-daemon: bind");
+        return 1;
+    }
+
+    // no SA_RESTART, so that accept returns on SIGINT and SIGTERM
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handleSignal;
+    sigaction(SIGINT, &sa, 0);
+    sigaction(SIGTERM, &sa, 0);
+    signal(SIGPIPE, SIG_IGN);
+
+    for (int t = 0; t < threads; ++t) {
+        pthread_t id;
+        if (pthread_create(&id, 0, runWorker, &server)) {
+            fprintf(stderr, "vamp-aubio-daemon: cannot create thread\n");
+            return 1;
+        }
+        pthread_detach(id);
+    }
+
+    fprintf(stderr, "vamp-aubio-daemon: listening on %s\n", path);
+
+    while (!interrupted) {
+        int fd = accept(listener, 0, 0);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            perror("vamp-aubio-daemon: accept");
+            break;
+        }
+        server.queue.push(fd);
+    }
+
+    close(listener);
+    unlink(path);
+
+    // workers may still be serving, so leave without destroying the
+    // instances under them
+    _exit(0);
+}
@@ -0,0 +1,450 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+// Offline feature extraction for vamp-aubio, to numpy files.
+//
+// Runs one or more plugins, linked in from the plugin sources, over a
+// WAV file or a file of raw little-endian float32 samples, read through
+// a memory mapping and mixed down to mono, and writes each of their
+// dense outputs (one sample per step, with a fixed bin count) as a
+// float32 matrix of one row per step, to <dir>/<plugin>-<output>.npy.
+// The plugins all run at the same step size, and each step of the
+// input is converted once and handed to all of them. Steps
+// for which the plugin returns no value are filled with NaN. A JSON
+// file of the same name, ending in .json, describes the matrix: sample
+// rate, step and block sizes, output name and unit, bin names and the
+// parameters used. In Python:
+//
+//     m = numpy.load('aubiomfcc-mfcc.npy', mmap_mode='r')
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "AudioFileSource.h"
+#include "InstancePool.h"
+#include "NpyWriter.h"
+#include "PluginFactory.h"
+#include "plugins/PcmInput.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+struct DenseOutput {
+    DenseOutput() : index(0), nextRow(0), reordered(false) { }
+    int index;
+    Vamp::Plugin::OutputDescriptor descriptor;
+    string path;
+    NpyWriter writer;
+    size_t nextRow;
+    bool reordered;
+    vector<float> row;
+};
+
+struct PluginRun {
+    PluginRun() : input(0) { }
+    PluginConfig config;
+    PluginInstance instance;
+    PcmInput *input;
+    map<int, DenseOutput *> dense;
+};
+
+static string
+quote(const string &s)
+{
+    string q = "\"";
+    for (size_t i = 0; i < s.size(); ++i) {
+        unsigned char c = s[i];
+        if (c == '"' || c == '\\') {
+            q += '\\';
+            q += c;
+        } else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            q += buf;
+        } else {
+            q += c;
+        }
+    }
+    return q + "\"";
+}
+
+static bool
+writeMetadata(const string &path, const PluginInstance &instance,
+              const PluginConfig &config, const DenseOutput &output)
+{
+    FILE *f = fopen(path.c_str(), "w");
+    if (!f) {
+        perror(path.c_str());
+        return false;
+    }
+
+    const Vamp::Plugin::OutputDescriptor &d = output.descriptor;
+    Vamp::Plugin *plugin = instance.plugin;
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"plugin\": %s,\n", quote(plugin->getIdentifier()).c_str());
+    fprintf(f, "  \"pluginVersion\": %d,\n", plugin->getPluginVersion());
+    fprintf(f, "  \"output\": %s,\n", quote(d.identifier).c_str());
+    fprintf(f, "  \"name\": %s,\n", quote(d.name).c_str());
+    fprintf(f, "  \"unit\": %s,\n", quote(d.unit).c_str());
+    fprintf(f, "  \"sampleRate\": %.9g,\n", config.rate);
+    fprintf(f, "  \"stepSize\": %lu,\n", (unsigned long)instance.stepSize);
+    fprintf(f, "  \"blockSize\": %lu,\n", (unsigned long)instance.blockSize);
+    fprintf(f, "  \"rows\": %lu,\n",
+            (unsigned long)output.writer.getRowCount());
+    fprintf(f, "  \"bins\": %lu,\n", (unsigned long)d.binCount);
+    fprintf(f, "  \"binNames\": [");
+    for (size_t i = 0; i < d.binCount; ++i) {
+        string name = i < d.binNames.size() ? d.binNames[i] : string();
+        fprintf(f, "%s%s", i > 0 ? ", " : "", quote(name).c_str());
+    }
+    fprintf(f, "],\n");
+    fprintf(f, "  \"parameters\": {");
+    Vamp::Plugin::ParameterList params = plugin->getParameterDescriptors();
+    for (size_t i = 0; i < params.size(); ++i) {
+        fprintf(f, "%s\n    %s: %.9g", i > 0 ? "," : "",
+                quote(params[i].identifier).c_str(),
+                plugin->getParameter(params[i].identifier));
+    }
+    fprintf(f, "%s}\n}\n", params.empty() ? "" : "\n  ");
+
+    if (fclose(f) != 0) {
+        perror(path.c_str());
+        return false;
+    }
+    return true;
+}
+
+static bool
+fillTo(DenseOutput &output, size_t row)
+{
+    if (output.nextRow >= row) return true;
+    vector<float> gap((row - output.nextRow) * output.descriptor.binCount, NAN);
+    if (!output.writer.write(&gap[0], row - output.nextRow)) return false;
+    output.nextRow = row;
+    return true;
+}
+
+// Write the features of one output, returned by the call to process()
+// for the given step, or by getRemainingFeatures() if step is that of
+// the end of the input. Features with a timestamp go to the row of
+// their step, others to the row of the current one, or after the
+// last row written.
+static bool
+writeFeatures(DenseOutput &output, const Vamp::Plugin::FeatureList &features,
+              size_t step, float rate, size_t stepSize)
+{
+    size_t bins = output.descriptor.binCount;
+
+    for (size_t i = 0; i < features.size(); ++i) {
+        const Vamp::Plugin::Feature &f = features[i];
+
+        size_t row = step;
+        if (f.hasTimestamp) {
+            long frame = Vamp::RealTime::realTime2Frame(f.timestamp,
+                                                        lrintf(rate));
+            row = frame < 0 ? 0 : ((size_t)frame + stepSize / 2) / stepSize;
+        }
+        if (row < output.nextRow) {
+            if (!output.reordered && f.hasTimestamp) {
+                fprintf(stderr, "vamp-aubio-extract: output %s has "
+                        "features out of order, appending them\n",
+                        output.descriptor.identifier.c_str());
+                output.reordered = true;
+            }
+            row = output.nextRow;
+        }
+        if (!fillTo(output, row)) return false;
+
+        for (size_t b = 0; b < bins; ++b) {
+            output.row[b] = b < f.values.size() ? f.values[b] : NAN;
+        }
+        if (!output.writer.write(&output.row[0], 1)) return false;
+        ++output.nextRow;
+    }
+    return true;
+}
+
+// Give config those of the parameters that its plugin has, returning
+// false if there is no such plugin, and mark the parameters used
+static bool
+selectParameters(PluginConfig &config,
+                 const vector<std::pair<string, float> > &parameters,
+                 vector<bool> &used)
+{
+    Vamp::Plugin *plugin = createPlugin(config.identifier, config.rate);
+    if (!plugin) return false;
+
+    Vamp::Plugin::ParameterList params = plugin->getParameterDescriptors();
+    for (size_t i = 0; i < parameters.size(); ++i) {
+        for (size_t j = 0; j < params.size(); ++j) {
+            if (params[j].identifier == parameters[i].first) {
+                config.parameters.push_back(parameters[i]);
+                used[i] = true;
+                break;
+            }
+        }
+    }
+
+    delete plugin;
+    return true;
+}
+
+static bool
+openOutputs(PluginRun &run, const string &dir)
+{
+    Vamp::Plugin::OutputList outputs =
+        run.instance.plugin->getOutputDescriptors();
+    for (size_t o = 0; o < outputs.size(); ++o) {
+        const Vamp::Plugin::OutputDescriptor &d = outputs[o];
+        if (d.sampleType != Vamp::Plugin::OutputDescriptor::OneSamplePerStep ||
+            !d.hasFixedBinCount || d.binCount == 0) {
+            continue;
+        }
+        DenseOutput *output = new DenseOutput;
+        output->index = o;
+        output->descriptor = d;
+        output->path = dir + "/" + run.config.identifier + "-" + d.identifier;
+        output->row.resize(d.binCount);
+        run.dense[o] = output;
+        if (!output->writer.open(output->path + ".npy", d.binCount)) {
+            return false;
+        }
+    }
+    if (run.dense.empty()) {
+        fprintf(stderr, "vamp-aubio-extract: %s has no dense outputs\n",
+                run.config.identifier.c_str());
+        return false;
+    }
+    return true;
+}
+
+static bool
+writeFeatureSet(PluginRun &run, const Vamp::Plugin::FeatureSet &fs,
+                size_t step)
+{
+    for (Vamp::Plugin::FeatureSet::const_iterator fi = fs.begin();
+         fi != fs.end(); ++fi) {
+        if (run.dense.find(fi->first) == run.dense.end()) continue;
+        if (!writeFeatures(*run.dense[fi->first], fi->second, step,
+                           run.config.rate, run.instance.stepSize)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool
+closeOutputs(PluginRun &run, size_t steps, bool ok)
+{
+    for (map<int, DenseOutput *>::iterator di = run.dense.begin();
+         di != run.dense.end(); ++di) {
+        DenseOutput *output = di->second;
+        if (ok) ok = fillTo(*output, steps);
+        if (!output->writer.close()) ok = false;
+        if (ok) ok = writeMetadata(output->path + ".json", run.instance,
+                                   run.config, *output);
+        if (ok) {
+            fprintf(stderr, "%s.npy: %lu x %lu\n", output->path.c_str(),
+                    (unsigned long)output->writer.getRowCount(),
+                    (unsigned long)output->writer.getBinCount());
+        }
+        delete output;
+    }
+    run.dense.clear();
+    return ok;
+}
+
+static void
+usage()
+{
+    fprintf(stderr,
+            "usage: vamp-aubio-extract [-r rate] [-c channels] [-s step] "
+            "[-b block] [-p param=value]... [-o dir] plugin[,plugin]... "
+            "input\n"
+            "\n"
+            "Run the plugins over input, a WAV file or a file of float32\n"
+            "samples at the given rate (44100) in the given number of\n"
+            "channels (1), and write each of their dense outputs to\n"
+            "dir/plugin-output.npy, with its description in a .json file\n"
+            "of the same name. The plugins run at the step size of the\n"
+            "first one unless one is given, and parameters apply to those\n"
+            "of the plugins that have them.\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    vector<std::pair<string, float> > parameters;
+    size_t stepSize = 0;
+    size_t blockSize = 0;
+    float rawRate = 44100;
+    int rawChannels = 1;
+    string dir = ".";
+
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; ++i) {
+        if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            rawRate = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+            rawChannels = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            stepSize = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            blockSize = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+            string spec = argv[++i];
+            size_t eq = spec.find('=');
+            if (eq == string::npos) {
+                usage();
+                return 2;
+            }
+            parameters.push_back(std::make_pair
+                                 (spec.substr(0, eq),
+                                  (float)atof(spec.c_str() + eq + 1)));
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            dir = argv[++i];
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    if (argc - i != 2 || rawRate <= 0 || rawChannels < 1) {
+        usage();
+        return 2;
+    }
+
+    vector<string> identifiers;
+    string list = argv[i];
+    for (size_t start = 0; start <= list.size(); ) {
+        size_t comma = list.find(',', start);
+        if (comma == string::npos) comma = list.size();
+        identifiers.push_back(list.substr(start, comma - start));
+        start = comma + 1;
+    }
+
+    AudioFileSource source;
+    string error;
+    if (!source.open(argv[i + 1], rawRate, rawChannels, error)) {
+        fprintf(stderr, "vamp-aubio-extract: %s\n", error.c_str());
+        return 1;
+    }
+
+    InstancePool pool(0);
+    vector<PluginRun> runs(identifiers.size());
+    vector<bool> used(parameters.size(), false);
+    bool ok = true;
+
+    for (size_t r = 0; ok && r < runs.size(); ++r) {
+        PluginRun &run = runs[r];
+        run.config.identifier = identifiers[r];
+        run.config.rate = source.getSampleRate();
+        run.config.stepSize = (r == 0 ? stepSize : runs[0].instance.stepSize);
+        run.config.blockSize = blockSize;
+        if (!selectParameters(run.config, parameters, used)) {
+            fprintf(stderr, "vamp-aubio-extract: no plugin %s\n",
+                    identifiers[r].c_str());
+            ok = false;
+        } else if (!pool.acquire(run.config, run.instance, error)) {
+            fprintf(stderr, "vamp-aubio-extract: %s\n", error.c_str());
+            ok = false;
+        } else if (!(run.input = dynamic_cast<PcmInput *>
+                     (run.instance.plugin))) {
+            fprintf(stderr, "vamp-aubio-extract: %s does not take "
+                    "converted input\n", identifiers[r].c_str());
+            ok = false;
+        } else {
+            ok = openOutputs(run, dir);
+        }
+    }
+    for (size_t p = 0; ok && p < parameters.size(); ++p) {
+        if (!used[p]) {
+            fprintf(stderr, "vamp-aubio-extract: no plugin has parameter "
+                    "%s\n", parameters[p].first.c_str());
+            ok = false;
+        }
+    }
+
+    size_t step = ok ? runs[0].instance.stepSize : 0;
+    size_t steps = 0;
+
+    if (ok) {
+        // The source converts and mixes down each step once, and all
+        // the plugins read it from there: in place when aubio samples
+        // are floats, from a single copy otherwise
+        fvec_t *copy = 0;
+        fvec_t view;
+        view.length = step;
+        if (sizeof(smpl_t) != sizeof(float)) copy = new_fvec(step);
+
+        const float *samples;
+        size_t pos = 0;
+        long rate = lrintf(source.getSampleRate());
+
+        source.start(step, step);
+        while (ok && (samples = source.next(pos)) != 0) {
+            const fvec_t *input = &view;
+            if (copy) {
+                convertPcm(samples, PcmFloat32, 1, step, copy->data);
+                input = copy;
+            } else {
+                view.data = (smpl_t *)samples;
+            }
+            Vamp::RealTime timestamp =
+                Vamp::RealTime::frame2RealTime(pos, rate);
+            for (size_t r = 0; ok && r < runs.size(); ++r) {
+                ok = writeFeatureSet
+                    (runs[r], runs[r].input->processInput(input, timestamp),
+                     steps);
+            }
+            ++steps;
+        }
+
+        if (copy) del_fvec(copy);
+
+        for (size_t r = 0; ok && r < runs.size(); ++r) {
+            ok = writeFeatureSet
+                (runs[r], runs[r].instance.plugin->getRemainingFeatures(),
+                 steps);
+        }
+    }
+
+    for (size_t r = 0; r < runs.size(); ++r) {
+        if (!closeOutputs(runs[r], steps, ok)) ok = false;
+        if (runs[r].instance.plugin) {
+            pool.release(runs[r].config, runs[r].instance);
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,237 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+// Live analysis driver for vamp-aubio.
+//
+// Runs one plugin behind a CaptureFrontEnd, feeding it the synthetic
+// signal in capture periods of varying size at the pace of a sound
+// card, and reports the features received, the overruns and how long
+// after the end of its block each feature arrived.
+
+#include <vamp/vamp.h>
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+#include "CaptureFrontEnd.h"
+#include "PluginLibrary.h"
+#include "SyntheticSignal.h"
+
+using std::string;
+using std::vector;
+
+static double
+now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void
+sleepUntil(double t)
+{
+    double d = t - now();
+    if (d <= 0) return;
+    struct timespec ts;
+    ts.tv_sec = (time_t)d;
+    ts.tv_nsec = (long)((d - ts.tv_sec) * 1e9);
+    nanosleep(&ts, 0);
+}
+
+struct Stats {
+    Stats() : count(0), timed(0), latency(0), maxLatency(0) { }
+    string name;
+    unsigned long count;
+    unsigned long timed;
+    double latency;
+    double maxLatency;
+};
+
+static void
+usage()
+{
+    fprintf(stderr,
+            "usage: vamp-aubio-live [-d seconds] [-r rate] [-c period] "
+            "[-x speed] [-q queue] [-s parameter=value]... library plugin\n"
+            "\n"
+            "Run plugin from library on a worker thread, feeding it a synthetic\n"
+            "signal in capture periods of about period frames, speed times\n"
+            "faster than real time, through a ring of queue periods.\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    float duration = 20;
+    float rate = 44100;
+    int period = 256;
+    float speed = 1;
+    int queue = 16;
+    vector<std::pair<string, float> > settings;
+    const char *path = 0;
+    const char *identifier = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+            duration = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            rate = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+            period = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-x") && i + 1 < argc) {
+            speed = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-q") && i + 1 < argc) {
+            queue = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            const char *arg = argv[++i];
+            const char *eq = strchr(arg, '=');
+            if (!eq || eq == arg) {
+                usage();
+                return 2;
+            }
+            settings.push_back(std::make_pair(string(arg, eq - arg),
+                                              (float)atof(eq + 1)));
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 2;
+        } else if (!path) {
+            path = argv[i];
+        } else if (!identifier) {
+            identifier = argv[i];
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    if (!identifier || duration <= 0 || rate <= 0 || period < 1 ||
+        speed <= 0 || queue < 2) {
+        usage();
+        return 2;
+    }
+
+    Library lib;
+    if (!openLibrary(lib, path, "vamp-aubio-live")) return 1;
+
+    const VampPluginDescriptor *d = findPlugin(lib, identifier);
+    if (!d) {
+        fprintf(stderr, "vamp-aubio-live: %s: no plugin %s\n",
+                path, identifier);
+        return 1;
+    }
+
+    VampPluginHandle h = d->instantiate(d, rate);
+    if (!h) {
+        fprintf(stderr, "vamp-aubio-live: cannot instantiate %s\n", identifier);
+        return 1;
+    }
+    for (size_t s = 0; s < settings.size(); ++s) {
+        for (unsigned int p = 0; p < d->parameterCount; ++p) {
+            if (settings[s].first == d->parameters[p]->identifier) {
+                d->setParameter(h, p, settings[s].second);
+            }
+        }
+    }
+
+    unsigned int step = d->getPreferredStepSize(h);
+    unsigned int block = d->getPreferredBlockSize(h);
+    if (block == 0) block = 1024;
+    if (step == 0) step = block;
+
+    vector<float> signal((size_t)(duration * rate));
+    makeSignal(signal, rate);
+
+    vector<Stats> stats;
+    {
+        CaptureFrontEnd frontEnd(d, h, rate, step, block,
+                                 (size_t)queue * period + block, 4096);
+        if (!frontEnd.start()) return 1;
+
+        stats.resize(d->getOutputCount(h));
+        for (size_t o = 0; o < stats.size(); ++o) {
+            VampOutputDescriptor *od = d->getOutputDescriptor(h, o);
+            if (!od) continue;
+            stats[o].name = od->identifier;
+            d->releaseOutputDescriptor(od);
+        }
+
+        double start = now();
+        size_t pos = 0;
+
+        // capture periods jitter around the nominal size, as with
+        // drivers that deliver whatever the hardware has
+        srand(1);
+        while (pos < signal.size()) {
+            size_t n = period / 2 + rand() % (period + 1);
+            if (n > signal.size() - pos) n = signal.size() - pos;
+            sleepUntil(start + (pos + n) / rate / speed);
+            frontEnd.push(&signal[pos], n);
+            pos += n;
+
+            while (LiveFeature *f = frontEnd.popFeature()) {
+                Stats &s = stats[f->output];
+                double due = start + (f->frame + block) / rate / speed;
+                double late = now() - due;
+                s.latency += late;
+                if (late > s.maxLatency) s.maxLatency = late;
+                ++s.count;
+                ++s.timed;
+                delete f;
+            }
+        }
+
+        frontEnd.stop();
+
+        while (LiveFeature *f = frontEnd.popFeature()) {
+            ++stats[f->output].count;
+            delete f;
+        }
+
+        printf("%s: step %u, block %u, %lu blocks, "
+               "%lu frames and %lu features dropped\n",
+               identifier, step, block, frontEnd.getProcessedBlocks(),
+               frontEnd.getDroppedFrames(), frontEnd.getDroppedFeatures());
+    }
+
+    // features arriving after stop() are counted but not timed
+    printf("%-24s %10s %12s %12s\n", "output", "features",
+           "mean ms", "max ms");
+    for (size_t o = 0; o < stats.size(); ++o) {
+        const Stats &s = stats[o];
+        printf("%-24s %10lu %12.2f %12.2f\n", s.name.c_str(), s.count,
+               s.timed ? s.latency / s.timed * 1000 : 0.0,
+               s.maxLatency * 1000);
+    }
+
+    dlclose(lib.handle);
+    return 0;
+}
@@ -0,0 +1,329 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Vamp feature extraction plugins using Paul Brossier's Aubio library.
+
+    Copyright (C) 2006-2015 Paul Brossier <piem@aubio.org>
+
+    This file is part of vamp-aubio-plugins.
+
+    vamp-aubio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    vamp-aubio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with aubio.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+// Client for vamp-aubio-daemon.
+//
+// Sends a synthetic clip to the daemon for analysis a number of times
+// over one connection, and reports the latency of the requests as seen
+// by the client. With -m, the clip is written once to shared memory,
+// which the daemon reads in place, and features come back through a
+// shared FeatureRing.
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "FeatureRing.h"
+#include "SharedMemory.h"
+#include "SyntheticSignal.h"
+
+using std::string;
+using std::vector;
+
+static double
+now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool
+writeAll(int fd, const char *p, size_t n)
+{
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= w;
+    }
+    return true;
+}
+
+// Read a reply up to its "ok" or "error" line, returning that line
+static bool
+readReply(int fd, string &reply, string &status)
+{
+    reply.clear();
+    size_t lineStart = 0;
+    char buf[65536];
+    while (true) {
+        ssize_t r = read(fd, buf, sizeof(buf));
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        reply.append(buf, r);
+        size_t nl;
+        while ((nl = reply.find('\n', lineStart)) != string::npos) {
+            string line = reply.substr(lineStart, nl - lineStart);
+            lineStart = nl + 1;
+            if (line.compare(0, 3, "ok ") == 0 || line == "ok" ||
+                line.compare(0, 6, "error ") == 0) {
+                status = line;
+                return true;
+            }
+        }
+    }
+}
+
+static void
+printFeature(const RingFeature &f)
+{
+    printf("%u %d.%09d ", f.output, f.sec, f.nsec);
+    if (f.hasDuration) printf("%d.%09d", f.durationSec, f.durationNsec);
+    else printf("-");
+    printf(" %lu", (unsigned long)f.values.size());
+    for (size_t i = 0; i < f.values.size(); ++i) printf(" %.9g", f.values[i]);
+    if (!f.label.empty()) printf(" %s", f.label.c_str());
+    printf("\n");
+}
+
+// Take the features of a shared memory request from the ring until
+// the reply comes, then those left in the ring
+static bool
+readSharedReply(int fd, FeatureRing &ring, bool print, string &reply,
+                string &status, size_t &count)
+{
+    RingFeature f;
+    count = 0;
+    while (true) {
+        while (ring.read(f)) {
+            if (print) printFeature(f);
+            ++count;
+        }
+        struct pollfd p;
+        p.fd = fd;
+        p.events = POLLIN;
+        p.revents = 0;
+        if (poll(&p, 1, 1) > 0) break;
+    }
+    if (!readReply(fd, reply, status)) return false;
+    while (ring.read(f)) {
+        if (print) printFeature(f);
+        ++count;
+    }
+    return true;
+}
+
+static int
+connectTo(const char *path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void
+usage()
+{
+    fprintf(stderr,
+            "usage: vamp-aubio-request [-s socket] [-n requests] [-d seconds] "
+            "[-r rate] [-m] [-b ring-kb] [-v] [-S] plugin "
+            "[parameter=value]...\n"
+            "\n"
+            "Ask vamp-aubio-daemon to analyse a synthetic clip of the given\n"
+            "duration requests times, and report the latencies. -m passes the\n"
+            "clip in shared memory and gets the features through a shared\n"
+            "ring of ring-kb kilobytes. -v prints the first reply, -S the\n"
+            "daemon's statistics.\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    const char *path = "/tmp/vamp-aubio.sock";
+    int requests = 100;
+    float duration = 5;
+    float rate = 44100;
+    bool verbose = false;
+    bool stats = false;
+    bool shared = false;
+    int ringKb = 1024;
+    const char *identifier = 0;
+    string settings;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            path = argv[++i];
+        } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            requests = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+            duration = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            rate = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-m")) {
+            shared = true;
+        } else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            ringKb = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-v")) {
+            verbose = true;
+        } else if (!strcmp(argv[i], "-S")) {
+            stats = true;
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 2;
+        } else if (!identifier) {
+            identifier = argv[i];
+        } else if (strchr(argv[i], '=')) {
+            settings += " ";
+            settings += argv[i];
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    if (!identifier || requests < 0 || duration <= 0 || rate <= 0 ||
+        ringKb < 1) {
+        usage();
+        return 2;
+    }
+
+    int fd = connectTo(path);
+    if (fd < 0) {
+        fprintf(stderr, "vamp-aubio-request: cannot connect to %s: %s\n",
+                path, strerror(errno));
+        return 1;
+    }
+
+    vector<float> signal((size_t)(duration * rate));
+    makeSignal(signal, rate);
+
+    // with -m, the audio is decoded into a mapping once, and the same
+    // descriptors are passed with every request
+    int fds[2] = { -1, -1 };
+    void *ringBase = MAP_FAILED;
+    size_t ringSize = FeatureRing::getMappingSize((size_t)ringKb * 1024);
+    if (shared) {
+        size_t audioSize = signal.size() * sizeof(float);
+        fds[0] = createSharedMemory(audioSize);
+        fds[1] = createSharedMemory(ringSize);
+        if (fds[0] < 0 || fds[1] < 0) {
+            fprintf(stderr, "vamp-aubio-request: cannot create shared "
+                    "memory: %s\n", strerror(errno));
+            return 1;
+        }
+        void *audio = mmap(0, audioSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                           fds[0], 0);
+        ringBase = mmap(0, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                        fds[1], 0);
+        if (audio == MAP_FAILED || ringBase == MAP_FAILED) {
+            fprintf(stderr, "vamp-aubio-request: cannot map shared "
+                    "memory: %s\n", strerror(errno));
+            return 1;
+        }
+        memcpy(audio, &signal[0], audioSize);
+        munmap(audio, audioSize);
+    }
+    FeatureRing ring(shared ? ringBase : 0, shared ? ringSize : 0, shared);
+
+    char header[256];
+    snprintf(header, sizeof(header), "%s %s %.9g 0 0 %lu",
+             shared ? "analyse-shm" : "analyse", identifier, rate,
+             (unsigned long)signal.size());
+    string request = header + settings + "\n";
+
+    vector<double> latencies;
+    string reply, status;
+
+    for (int r = 0; r < requests; ++r) {
+        double start = now();
+        bool ok;
+        size_t received = 0;
+        if (shared) {
+            ok = sendWithDescriptors(fd, request.data(), request.size(),
+                                     fds, 2) &&
+                readSharedReply(fd, ring, verbose && r == 0, reply, status,
+                                received);
+        } else {
+            ok = writeAll(fd, request.data(), request.size()) &&
+                writeAll(fd, (const char *)&signal[0],
+                         signal.size() * sizeof(float)) &&
+                readReply(fd, reply, status);
+        }
+        if (!ok) {
+            fprintf(stderr, "vamp-aubio-request: connection lost\n");
+            return 1;
+        }
+        latencies.push_back(now() - start);
+        if (verbose && r == 0) fputs(reply.c_str(), stdout);
+        if (status.compare(0, 3, "ok ") != 0) {
+            fprintf(stderr, "vamp-aubio-request: %s\n", status.c_str());
+            return 1;
+        }
+        if (shared && received != strtoul(status.c_str() + 3, 0, 10)) {
+            fprintf(stderr, "vamp-aubio-request: %lu features in the ring "
+                    "for \"%s\"\n", (unsigned long)received, status.c_str());
+            return 1;
+        }
+    }
+
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        size_t n = latencies.size();
+        printf("%d requests of %g s: latency ms p50 %.2f p90 %.2f "
+               "p99 %.2f max %.2f\n", requests, duration,
+               latencies[(n - 1) / 2] * 1000,
+               latencies[(size_t)((n - 1) * 0.9)] * 1000,
+               latencies[(size_t)((n - 1) * 0.99)] * 1000,
+               latencies[n - 1] * 1000);
+    }
+
+    if (stats) {
+        if (!writeAll(fd, "stats\n", 6) || !readReply(fd, reply, status)) {
+            fprintf(stderr, "vamp-aubio-request: connection lost\n");
+            return 1;
+        }
+        fputs(reply.c_str(), stdout);
+    }
+
+    if (shared) {
+        munmap(ringBase, ringSize);
+        close(fds[0]);
+        close(fds[1]);
+    }
+    close(fd);
+    return 0;
+}